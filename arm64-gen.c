@@ -14,6 +14,23 @@
 // Number of registers available to allocator:
 #define NB_REGS 28 // x0-x18, x30, v0-v7
 
+// Switch tables are supported, see gen_jmptable():
+#define CONFIG_TCC_JMPTABLE
+
+// 'return f(...);' may jump to f, see gfunc_call():
+#define CONFIG_TCC_TAILCALL
+
+// __int128 in register pairs, see gen_opl():
+#define CONFIG_TCC_INT128
+
+// Branchless '?:' with csel, see gen_select():
+#define CONFIG_TCC_SELECT
+
+// __thread variables, see gen_tls_addr():
+#ifndef TCC_TARGET_MACHO
+#define CONFIG_TCC_TLS
+#endif
+
 #define TREG_R(x) (x) // x = 0..18
 #define TREG_R30  19
 #define TREG_F(x) (x + 20) // x = 0..7
@@ -26,9 +43,11 @@
 #define RC_F(x) (1 << (22 + (x))) // x = 0..7
 
 #define RC_IRET (RC_R(0)) // int return register class
+#define RC_IRE2 (RC_R(1)) // int 2nd return register class
 #define RC_FRET (RC_F(0)) // float return register class
 
 #define REG_IRET (TREG_R(0)) // int return register number
+#define REG_IRE2 (TREG_R(1)) // int 2nd return register number
 #define REG_FRET (TREG_F(0)) // float return register number
 
 #define PTR_SIZE 8
@@ -40,6 +59,9 @@
 
 #define CHAR_IS_UNSIGNED
 
+/* structs up to this size are copied and cleared inline */
+#define STRUCT_INLINE_MAX 128
+
 /* define if return values need to be extended explicitely
    at caller side (for interfacing with non-TCC compilers) */
 #define PROMOTE_RET
@@ -733,7 +755,15 @@ static void gen_bounds_epilog(TCCState *S)
 
 static int arm64_hfa_aux(CType *type, int *fsize, int num)
 {
-    if (is_float(type->t)) {
+    if (IS_VECTOR(type)) {
+        /* short vectors are passed like floats of their size (HVA) */
+        int n = type->ref->c;
+        if ((n != 8 && n != 16) || num >= 4 || (*fsize && *fsize != n))
+            return -1;
+        *fsize = n;
+        return num + 1;
+    }
+    else if (is_float(type->t)) {
         int a, n = type_size(type, &a);
         if (num >= 4 || (*fsize && *fsize != n))
             return -1;
@@ -1047,6 +1077,11 @@ ST_FUNC void gfunc_call(TCCState *S, int nb_args)
                 arm64_strv(S, arm64_type_size(S->vtop[0].type.t),
                            fltr(S->vtop[0].r), 31, a[i] - 32);
             }
+            else if ((S->vtop->type.t & VT_BTYPE) == VT_QLONG) {
+                gv(S, RC_INT);
+                arm64_strx(S, 3, intr(S, S->vtop[0].r), 31, a[i] - 32);
+                arm64_strx(S, 3, intr(S, S->vtop[0].r2), 31, a[i] - 24);
+            }
             else {
                 gv(S, RC_INT);
                 arm64_strx(S, arm64_type_size(S->vtop[0].type.t),
@@ -1070,6 +1105,17 @@ ST_FUNC void gfunc_call(TCCState *S, int nb_args)
                     arm64_ldrs(S, a[i] / 2, size);
                 }
             }
+            else if ((S->vtop->type.t & VT_BTYPE) == VT_QLONG) {
+                // load the register pair from memory
+                if (!(S->vtop->r & VT_LVAL)) {
+                    gv(S, RC_INT);
+                    save_reg(S, S->vtop->r);
+                }
+                S->vtop->type.t = VT_PTR;
+                gaddrof(S);
+                gv(S, RC_R(a[i] / 2));
+                arm64_ldrs(S, a[i] / 2, 16);
+            }
             else
                 gv(S, RC_R(a[i] / 2));
         }
@@ -1106,7 +1152,22 @@ ST_FUNC void gfunc_call(TCCState *S, int nb_args)
     }
 
     save_regs(S, 0);
-    arm64_gen_bl_or_b(S, 0);
+    if (S->tccgen_tail_call && !stack) {
+        // return f(...): release our frame and branch to f
+        int direct = (S->vtop->r & (VT_VALMASK | VT_LVAL)) == VT_CONST &&
+            (S->vtop->r & VT_SYM);
+        if (!direct)
+            o(S, 0xaa0003f0 | intr(S, gv(S, RC_R30)) << 16); // mov x16,x30
+        o(S, 0x910003bf); // mov sp,x29
+        o(S, 0xa8ce7bfd); // ldp x29,x30,[sp],#224
+        if (direct)
+            arm64_gen_bl_or_b(S, 1);
+        else
+            o(S, 0xd61f0200); // br x16
+        S->tccgen_tail_call = 2;
+    }
+    else
+        arm64_gen_bl_or_b(S, 0);
     --S->vtop;
     if (stack & 0xfff)
         o(S, 0x910003ff | (stack & 0xfff) << 10); // add sp,sp,#(n)
@@ -1262,6 +1323,39 @@ ST_FUNC void gen_va_start(TCCState *S)
     --S->vtop;
 }
 
+#ifdef CONFIG_TCC_TLS
+// Address of the thread-local variable on top of the stack: local-exec
+// for variables defined in an executable, else initial-exec.
+ST_FUNC void gen_tls_addr(TCCState *S)
+{
+    Sym *sym = S->vtop->sym;
+    ElfSym *esym = elfsym(S, sym);
+    int rr = get_reg(S, RC_INT);
+    uint32_t r = intr(S, rr);
+
+    if (S->output_type == TCC_OUTPUT_EXE && esym && esym->st_shndx) {
+        o(S, 0xd53bd040 | r); // mrs x(r),tpidr_el0
+        greloca(S, cur_text_section, sym, S->ind,
+                R_AARCH64_TLSLE_ADD_TPREL_HI12, 0);
+        o(S, 0x91400000 | r | r << 5); // add x(r),x(r),#:tprel_hi12:sym,lsl #12
+        greloca(S, cur_text_section, sym, S->ind,
+                R_AARCH64_TLSLE_ADD_TPREL_LO12_NC, 0);
+        o(S, 0x91000000 | r | r << 5); // add x(r),x(r),#:tprel_lo12_nc:sym
+    } else {
+        greloca(S, cur_text_section, sym, S->ind,
+                R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21, 0);
+        o(S, 0x90000000 | r); // adrp x(r),:gottprel:sym
+        greloca(S, cur_text_section, sym, S->ind,
+                R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC, 0);
+        o(S, 0xf9400000 | r | r << 5); // ldr x(r),[x(r),#:gottprel_lo12:sym]
+        o(S, 0xd53bd05e); // mrs x30,tpidr_el0
+        o(S, 0x8b1e0000 | r | r << 5); // add x(r),x(r),x30
+    }
+    S->vtop->r = rr;
+    S->vtop->sym = NULL;
+}
+#endif
+
 ST_FUNC void gen_va_arg(TCCState *S, CType *t)
 {
     int align, size = type_size(t, &align);
@@ -1283,13 +1377,17 @@ ST_FUNC void gen_va_arg(TCCState *S, CType *t)
         uint32_t n = size > 16 ? 8 : (size + 7) & -8;
         o(S, 0xb940181e | r0 << 5); // ldr w30,[x(r0),#24] // __gr_offs
         if (align == 16) {
-            assert(0); // this path untested but needed for __uint128_t
+            // __int128 and 16-byte aligned structs
             o(S, 0x11003fde); // add w30,w30,#15
             o(S, 0x121c6fde); // and w30,w30,#-16
         }
         o(S, 0x310003c0 | r1 | n << 10); // adds w(r1),w30,#(n)
-        o(S, 0x540000ad); // b.le .+20
+        o(S, 0x5400000d | (align == 16 ? 7 : 5) << 5); // b.le .+20 (.+28)
         o(S, 0xf9400000 | r1 | r0 << 5); // ldr x(r1),[x(r0)] // __stack
+        if (align == 16) {
+            o(S, 0x91003c00 | r1 | r1 << 5); // add x(r1),x(r1),#15
+            o(S, 0x927cec00 | r1 | r1 << 5); // and x(r1),x(r1),#-16
+        }
         o(S, 0x9100001e | r1 << 5 | n << 10); // add x30,x(r1),#(n)
         o(S, 0xf900001e | r0 << 5); // str x30,[x(r0)] // __stack
         o(S, 0x14000004); // b .+16
@@ -1532,6 +1630,21 @@ ST_FUNC int gjmp_cond(TCCState *S, int op, int t)
     return gjmp(S, t);
 }
 
+// Replace vtop[-1] (the value if false) and vtop (if true), both in
+// registers, by the one selected by the 0/1 register 'cond':
+ST_FUNC void gen_select(TCCState *S, SValue *cond)
+{
+    int bt = S->vtop->type.t & VT_BTYPE;
+    uint32_t ll = (bt == VT_PTR || bt == VT_LLONG);
+    uint32_t c = intr(S, cond->r);
+    uint32_t f = intr(S, S->vtop[-1].r);
+    uint32_t t = intr(S, S->vtop->r);
+
+    o(S, 0x7100001f | c << 5); // cmp w(c),#0
+    o(S, 0x1a801000 | ll << 31 | f | t << 5 | f << 16); // csel r(f),r(t),r(f),ne
+    --S->vtop;
+}
+
 static int arm64_iconst(uint64_t *val, SValue *sv)
 {
     if ((sv->r & (VT_VALMASK | VT_LVAL | VT_SYM)) != VT_CONST)
@@ -1600,6 +1713,24 @@ static int arm64_gen_opic(TCCState *S, int op, uint32_t l, int rev, uint64_t val
         return 1;
     }
 
+    case '*': {
+        /* (2^k + 1) << j by add with shifted register and lsl */
+        uint32_t n = 32 << l, j = 0, k = 0;
+        if (!val)
+            return 0;
+        while (!(val >> j & 1))
+            j++;
+        if (val >> j < 3 || ((val >> j) - 1) & ((val >> j) - 2))
+            return 0;
+        while (((uint64_t)1 << k) < (val >> j) - 1)
+            k++;
+        o(S, 0x0b000000 | l << 31 | x | a << 5 | a << 16 | k << 10); // add
+        if (j)
+            o(S, 0x53000000 | l << 31 | l << 22 | x | x << 5 |
+              (n - j) << 16 | (n - 1 - j) << 10); // lsl
+        return 1;
+    }
+
     case TOK_SAR:
     case TOK_SHL:
     case TOK_SHR: {
@@ -1746,6 +1877,24 @@ static void arm64_gen_opil(TCCState *S, int op, uint32_t l)
         o(S, 0x6b00001f | l << 31 | a << 5 | b << 16); // cmp
         o(S, 0x1a9f87e0 | x); // cset wA,ls
         break;
+    case TOK_ADDC1:
+        o(S, 0xab000000 | x | a << 5 | b << 16); // adds
+        break;
+    case TOK_ADDC2:
+        o(S, 0x9a000000 | x | a << 5 | b << 16); // adc
+        break;
+    case TOK_SUBC1:
+        o(S, 0xeb000000 | x | a << 5 | b << 16); // subs
+        break;
+    case TOK_SUBC2:
+        o(S, 0xda000000 | x | a << 5 | b << 16); // sbc
+        break;
+    case TOK_UMULH:
+        o(S, 0x9bc07c00 | x | a << 5 | b << 16); // umulh
+        break;
+    case TOK_SMULH:
+        o(S, 0x9b407c00 | x | a << 5 | b << 16); // smulh
+        break;
     case TOK_UMOD:
         // Use x30 for quotient:
         o(S, 0x1ac00800 | l << 31 | 30 | a << 5 | b << 16); // udiv
@@ -1763,12 +1912,119 @@ ST_FUNC void gen_opi(TCCState *S, int op)
     arm64_vset_VT_CMP(S, op);
 }
 
+// Full 128-bit product of two 64-bit words, for __int128:
+static void arm64_gen_umull(TCCState *S)
+{
+    uint32_t a, b, x, y;
+
+    gv2(S, RC_INT, RC_INT);
+    a = intr(S, S->vtop[-1].r);
+    b = intr(S, S->vtop[0].r);
+    vpushi(S, 0);
+    S->vtop->r = x = get_reg(S, RC_INT);
+    y = get_reg(S, RC_INT);
+    o(S, 0x9b007c00 | intr(S, x) | a << 5 | b << 16); // mul
+    o(S, 0x9bc07c00 | intr(S, y) | a << 5 | b << 16); // umulh
+    S->vtop -= 2;
+    S->vtop->r = x;
+    S->vtop->r2 = y;
+}
+
 ST_FUNC void gen_opl(TCCState *S, int op)
 {
+    if (op == TOK_UMULL) {
+        arm64_gen_umull(S);
+        return;
+    }
     arm64_gen_opil(S, op, 1);
     arm64_vset_VT_CMP(S, op);
 }
 
+/* GCC vector operations on 8 and 16 byte vectors, with NEON */
+static void arm64_vec_mov(TCCState *S, int store, int sz, int x, SValue *sv)
+{
+    int bas = 29;
+    uint64_t off = sv->c.i;
+
+    if ((sv->r & VT_VALMASK) != VT_LOCAL) {
+        vpushv(S, sv);
+        S->vtop->type.t = VT_PTR;
+        gaddrof(S);
+        gv(S, RC_R30);
+        bas = 30, off = 0;
+    }
+    if (store)
+        arm64_strv(S, sz, x, bas, off);
+    else
+        arm64_ldrv(S, sz, x, bas, off);
+    if (bas == 30)
+        vpop(S);
+}
+
+ST_FUNC int gen_opv(TCCState *S, int op, SValue *a, SValue *b, int d)
+{
+    int size = a->type.ref->c, t = VECTOR_ELEM(&a->type)->t;
+    int bt = t & VT_BTYPE, u = t & VT_UNSIGNED, sw = 0, inv = 0;
+    uint32_t q, sz, x;
+    SValue r;
+
+    if (size != 8 && size != 16)
+        return 0;
+    q = (uint32_t)(size == 16) << 30;
+    if (is_float(bt)) {
+        sz = (uint32_t)(bt == VT_DOUBLE) << 22;
+        if (sz && !q)
+            return 0;
+        switch (op) {
+        case '+': x = 0x0e20d400; break; // fadd
+        case '-': x = 0x0ea0d400; break; // fsub
+        case '*': x = 0x2e20dc00; break; // fmul
+        case '/': x = 0x2e20fc00; break; // fdiv
+        case TOK_NE: inv = 1; /* fall through */
+        case TOK_EQ: x = 0x0e20e400; break; // fcmeq
+        case TOK_LT: sw = 1; /* fall through */
+        case TOK_GT: x = 0x2ea0e400; break; // fcmgt
+        case TOK_LE: sw = 1; /* fall through */
+        case TOK_GE: x = 0x2e20e400; break; // fcmge
+        default: return 0;
+        }
+    } else {
+        sz = (bt == VT_BYTE ? 0 : bt == VT_SHORT ? 1 :
+              bt == VT_LLONG ? 3 : 2) << 22;
+        if (sz == 3 << 22 && !q)
+            return 0;
+        switch (op) {
+        case '+': x = 0x0e208400; break; // add
+        case '-': x = 0x2e208400; break; // sub
+        case '*':
+            if (sz == 3 << 22)
+                return 0;
+            x = 0x0e209c00; break; // mul
+        case '&': x = 0x0e201c00, sz = 0; break; // and
+        case '|': x = 0x0ea01c00, sz = 0; break; // orr
+        case '^': x = 0x2e201c00, sz = 0; break; // eor
+        case TOK_NE: inv = 1; /* fall through */
+        case TOK_EQ: x = 0x2e208c00; break; // cmeq
+        case TOK_LT: sw = 1; /* fall through */
+        case TOK_GT: x = u ? 0x2e203400 : 0x0e203400; break; // cmhi, cmgt
+        case TOK_LE: sw = 1; /* fall through */
+        case TOK_GE: x = u ? 0x2e203c00 : 0x0e203c00; break; // cmhs, cmge
+        default: return 0;
+        }
+    }
+
+    save_regs(S, 0);
+    arm64_vec_mov(S, 0, 3 + !!q, 0, sw ? b : a);
+    arm64_vec_mov(S, 0, 3 + !!q, 1, sw ? a : b);
+    o(S, x | q | sz | 1 << 16); // op v0, v0, v1
+    if (inv)
+        o(S, 0x2e205800 | q); // not v0, v0
+    r.r = VT_LOCAL | VT_LVAL;
+    r.c.i = d;
+    arm64_vec_mov(S, 1, 3 + !!q, 0, &r);
+    return 1;
+}
+
 ST_FUNC void gen_opf(TCCState *S, int op)
 {
     uint32_t x, a, b, dbl;
@@ -1886,6 +2142,138 @@ ST_FUNC void gen_cvt_csti(TCCState *S, int t)
         | r | r << 5); // [su]xt[bh] w(r),w(r)
 }
 
+/* __builtin_popcount, ctz, clz, ffs or bswap of vtop in place, see
+   builtin_bitop() */
+ST_FUNC int gen_bitop(TCCState *S, int op)
+{
+    int bt = S->vtop->type.t & VT_BTYPE;
+    uint32_t x = bt == VT_LLONG, r = intr(S, gv(S, RC_INT)), t;
+
+    switch (op) {
+    case TOK_builtin_popcount:
+        t = fltr(get_reg(S, RC_FLOAT));
+        o(S, (x ? 0x9e670000 : 0x1e270000) | r << 5 | t); // fmov d(t)/s(t),x(r)/w(r)
+        o(S, 0x0e205800 | t << 5 | t); // cnt v(t).8b,v(t).8b
+        o(S, 0x0e31b800 | t << 5 | t); // addv b(t),v(t).8b
+        o(S, 0x1e260000 | t << 5 | r); // fmov w(r),s(t)
+        break;
+    case TOK_builtin_ctz:
+        o(S, 0x5ac00000 | x << 31 | r << 5 | r); // rbit x(r),x(r)
+        /* fall through */
+    case TOK_builtin_clz:
+        o(S, 0x5ac01000 | x << 31 | r << 5 | r); // clz x(r),x(r)
+        break;
+    case TOK_builtin_ffs:
+        t = intr(S, get_reg(S, RC_INT));
+        o(S, 0x5ac00000 | x << 31 | r << 5 | t); // rbit x(t),x(r)
+        o(S, 0x5ac01000 | x << 31 | t << 5 | t); // clz x(t),x(t)
+        o(S, 0x7100001f | x << 31 | r << 5); // cmp x(r),#0
+        o(S, 0x1a8007e0 | t << 16 | r); // csinc w(r),wzr,w(t),eq
+        break;
+    default:
+        o(S, (x ? 0xdac00c00 : 0x5ac00800) | r << 5 | r); // rev x(r),x(r)
+        if (bt == VT_SHORT)
+            o(S, 0x53107c00 | r << 5 | r); // lsr w(r),w(r),#16
+        break;
+    }
+    return 1;
+}
+
+/* inline __atomic_xxx with load-acquire/store-release and exclusive
+   load/store loops, see parse_atomic() */
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo)
+{
+    uint32_t sz = size == 8 ? 3 : size >> 1, x = size == 8;
+    uint32_t acq = mo != 0 && mo != 3, rel = mo >= 3;
+    uint32_t p, e = 0, v, old, n, t;
+    int loop, r;
+
+    switch (op) {
+    case TOK___atomic_load:
+        if (!acq) {
+            indir(S);
+            gv(S, RC_INT);
+            return;
+        }
+        p = intr(S, gv(S, RC_INT));
+        o(S, 0x08dffc00 | sz << 30 | p << 5 | p); // ldar r(p),[x(p)]
+        return;
+    case TOK___atomic_store:
+        if (!rel) {
+            vswap(S);
+            indir(S);
+            vswap(S);
+            vstore(S);
+            vpop(S);
+            return;
+        }
+        gv2(S, RC_INT, RC_INT);
+        o(S, 0x089ffc00 | sz << 30 | intr(S, S->vtop[-1].r) << 5 |
+          intr(S, S->vtop->r)); // stlr r(v),[x(p)]
+        S->vtop -= 2;
+        return;
+    case TOK___atomic_compare_exchange:
+        /* twice, as loading one may spill the others */
+        for (loop = 0; loop < 6; loop++) {
+            vrotb(S, 3);
+            gv(S, RC_INT);
+        }
+        p = intr(S, S->vtop[-2].r);
+        e = intr(S, S->vtop[-1].r);
+        break;
+    default:
+        gv2(S, RC_INT, RC_INT);
+        p = intr(S, S->vtop[-1].r);
+        break;
+    }
+    v = intr(S, S->vtop->r);
+
+    vpushi(S, 0);
+    S->vtop->r = get_reg(S, RC_INT);
+    vpushi(S, 0);
+    S->vtop->r = get_reg(S, RC_INT);
+    old = intr(S, r = S->vtop[-1].r);
+    t = intr(S, S->vtop->r);
+    n = intr(S, get_reg(S, RC_INT));
+    S->vtop -= 2;
+
+    loop = S->ind;
+    o(S, 0x085f7c00 | acq << 15 | sz << 30 | p << 5 | old); // ld[a]xr r(old),[x(p)]
+    switch (op) {
+    case TOK___atomic_compare_exchange:
+        if (size < 4)
+            o(S, 0x6b20001f | (size == 2) << 13 | e << 16 | old << 5); // cmp w(old),w(e),uxt[bh]
+        else
+            o(S, 0x6b00001f | x << 31 | e << 16 | old << 5); // cmp r(old),r(e)
+        o(S, 0x54000061); // b.ne .+12
+        /* fall through */
+    case TOK___atomic_exchange:
+        n = v;
+        break;
+    default:
+        o(S, x << 31 | v << 16 | old << 5 | n |
+          (op == TOK___atomic_fetch_add ? 0x0b000000 :
+           op == TOK___atomic_fetch_sub ? 0x4b000000 :
+           op == TOK___atomic_fetch_or ? 0x2a000000 :
+           op == TOK___atomic_fetch_xor ? 0x4a000000 :
+           0x0a000000)); // add/sub/orr/eor/and r(n),r(old),r(v)
+        break;
+    }
+    o(S, 0x08007c00 | rel << 15 | sz << 30 | t << 16 | p << 5 | n); // st[l]xr w(t),r(n),[x(p)]
+    o(S, 0x35000000 | ((loop - S->ind) >> 2 & 0x7ffff) << 5 | t); // cbnz w(t),loop
+
+    if (op == TOK___atomic_compare_exchange) {
+        /* [p e d] -> [old ok] */
+        o(S, 0x1a9f17e0 | e); // cset w(e),eq
+        S->vtop -= 1;
+        S->vtop[-1].r = r;
+        S->vtop->type.t = VT_INT;
+        return;
+    }
+    S->vtop[-1].r = r;
+    --S->vtop;
+}
+
 ST_FUNC void gen_cvt_itof(TCCState *S, int t)
 {
     if (t == VT_LDOUBLE) {
@@ -2004,6 +2392,68 @@ ST_FUNC void ggoto(TCCState *S)
     --S->vtop;
 }
 
+// Jump through switch table of offsets relative to its start:
+ST_FUNC void gen_jmptable(TCCState *S, Sym *table)
+{
+    uint32_t r = intr(S, gv(S, RC_INT));
+    greloca(S, cur_text_section, table, S->ind, R_AARCH64_ADR_PREL_PG_HI21, 0);
+    o(S, 0x9000001e); // adrp x30,table
+    greloca(S, cur_text_section, table, S->ind, R_AARCH64_ADD_ABS_LO12_NC, 0);
+    o(S, 0x910003de); // add x30,x30,#:lo12:table
+    o(S, 0xb8a07bc0 | r | r << 16); // ldrsw x(r),[x30,x(r),lsl #2]
+    o(S, 0x8b0003c0 | r | r << 16); // add x(r),x30,x(r)
+    o(S, 0xd61f0000 | r << 5); // br x(r)
+    --S->vtop;
+}
+
+/* copy (clear if n == 1) 'size' bytes to the address at vtop[1 - n]
+   from the one at vtop, 16 bytes at a time with ldp/stp */
+static void arm64_gen_block(TCCState *S, int size, int n)
+{
+    uint32_t d, s = 0, t = 31, t2 = 31, off, sz, op;
+
+    save_regs_keep(S, n);
+    if (n == 2) {
+        gv2(S, RC_INT, RC_INT);
+        s = intr(S, S->vtop[0].r);
+        t = intr(S, get_reg(S, RC_INT));
+        t2 = 30;
+    } else
+        gv(S, RC_INT);
+    d = intr(S, S->vtop[1 - n].r);
+    for (off = 0, sz = 16; off < size; off += sz) {
+        while (size - off < sz)
+            sz >>= 1;
+        if (sz == 16) {
+            if (n == 2)
+                o(S, 0xa9400000 | off / 8 << 15 | t2 << 10 | s << 5 | t);
+                // ldp x(t),x30,[x(s),#off]
+            o(S, 0xa9000000 | off / 8 << 15 | t2 << 10 | d << 5 | t);
+            // stp x(t),x30,[x(d),#off]
+        } else {
+            op = sz == 8 ? 0xf9000000 : sz == 4 ? 0xb9000000 :
+                sz == 2 ? 0x79000000 : 0x39000000;
+            if (n == 2)
+                o(S, op | 0x400000 | off / sz << 10 | s << 5 | t);
+                // ldr(b|h|w|x) t,[x(s),#off]
+            o(S, op | off / sz << 10 | d << 5 | t); // str(b|h|w|x) t,[x(d),#off]
+        }
+    }
+    S->vtop -= n;
+}
+
+/* copy 'size' bytes from the address at vtop to the one at vtop[-1] */
+ST_FUNC void gen_struct_copy(TCCState *S, int size)
+{
+    arm64_gen_block(S, size, 2);
+}
+
+/* clear 'size' bytes at the address at vtop */
+ST_FUNC void gen_struct_clear(TCCState *S, int size)
+{
+    arm64_gen_block(S, size, 1);
+}
+
 ST_FUNC void gen_clear_cache(TCCState *S)
 {
     uint32_t beg, end, dsz, isz, p, lab1, b1;
@@ -4,10 +4,12 @@
 
 #define R_DATA_32  R_AARCH64_ABS32
 #define R_DATA_PTR R_AARCH64_ABS64
+#define R_DATA_PC32 R_AARCH64_PREL32
 #define R_JMP_SLOT R_AARCH64_JUMP_SLOT
 #define R_GLOB_DAT R_AARCH64_GLOB_DAT
 #define R_COPY     R_AARCH64_COPY
 #define R_RELATIVE R_AARCH64_RELATIVE
+#define R_TPOFF    R_AARCH64_TLS_TPREL64
 
 #define R_NUM      R_AARCH64_NUM
 
@@ -44,6 +46,10 @@ int code_reloc (int reloc_type)
         case R_AARCH64_LDST8_ABS_LO12_NC:
         case R_AARCH64_GLOB_DAT:
         case R_AARCH64_COPY:
+        case R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21:
+        case R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC:
+        case R_AARCH64_TLSLE_ADD_TPREL_HI12:
+        case R_AARCH64_TLSLE_ADD_TPREL_LO12_NC:
             return 0;
 
         case R_AARCH64_JUMP26:
@@ -75,6 +81,8 @@ int gotplt_entry_type (int reloc_type)
         case R_AARCH64_GLOB_DAT:
         case R_AARCH64_JUMP_SLOT:
         case R_AARCH64_COPY:
+        case R_AARCH64_TLSLE_ADD_TPREL_HI12:
+        case R_AARCH64_TLSLE_ADD_TPREL_LO12_NC:
             return NO_GOTPLT_ENTRY;
 
         case R_AARCH64_ABS32:
@@ -86,6 +94,10 @@ int gotplt_entry_type (int reloc_type)
         case R_AARCH64_ADR_GOT_PAGE:
         case R_AARCH64_LD64_GOT_LO12_NC:
             return ALWAYS_GOTPLT_ENTRY;
+
+        case R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21:
+        case R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC:
+            return TLS_GOT_ENTRY;
     }
     return -1;
 }
@@ -164,6 +176,20 @@ ST_FUNC void relocate_plt(TCCState *S)
     }
 }
 
+/* offset of a thread-local variable from the thread pointer tpidr_el0,
+   which points to a 16 byte TCB followed by the TLS block of the
+   executable */
+static uint64_t tpoff(TCCState *S, addr_t val)
+{
+    uint64_t off = val - S->tls_addr
+        + ((16 + S->tls_align - 1) & -(addr_t)S->tls_align);
+    if (S->output_type != TCC_OUTPUT_EXE)
+        tcc_error(S, "local-exec TLS relocation in a shared object");
+    if (off >> 24)
+        tcc_error(S, "TLS block of the executable too large");
+    return off;
+}
+
 void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t addr, addr_t val)
 {
     int sym_index = ELFW(R_SYM)(rel->r_info), esym_index;
@@ -274,7 +300,8 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t a
                             (uint32_t)(type == R_AARCH64_CALL26) << 31 |
                             ((val - addr) >> 2 & 0x3ffffff)));
             return;
-        case R_AARCH64_ADR_GOT_PAGE: {
+        case R_AARCH64_ADR_GOT_PAGE:
+        adr_got_page: {
             uint64_t off =
                 (((S->got->sh_addr +
                    get_sym_attr(S, sym_index, 0)->got_offset) >> 12) - (addr >> 12));
@@ -285,11 +312,33 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t a
             return;
         }
         case R_AARCH64_LD64_GOT_LO12_NC:
+        ld64_got_lo12:
             write32le(ptr,
                       ((read32le(ptr) & 0xfff803ff) |
                        ((S->got->sh_addr +
                          get_sym_attr(S, sym_index, 0)->got_offset) & 0xff8) << 7));
             return;
+        case R_AARCH64_TLSLE_ADD_TPREL_HI12:
+            write32le(ptr, read32le(ptr) | (tpoff(S, val) >> 12 & 0xfff) << 10);
+            return;
+        case R_AARCH64_TLSLE_ADD_TPREL_LO12_NC:
+            write32le(ptr, read32le(ptr) | (tpoff(S, val) & 0xfff) << 10);
+            return;
+        case R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21:
+            if (get_sym_attr(S, sym_index, 0)->got_offset)
+                goto adr_got_page;
+            /* variable of the executable, relax to local-exec:
+               adrp x(d),:gottprel:x -> movz x(d),#:tprel_g1:x,lsl #16 */
+            write32le(ptr, 0xd2a00000 | (read32le(ptr) & 0x1f) |
+                      (tpoff(S, val) >> 16 & 0xffff) << 5);
+            return;
+        case R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC:
+            if (get_sym_attr(S, sym_index, 0)->got_offset)
+                goto ld64_got_lo12;
+            /* ldr x(d),[x(d),#:gottprel_lo12:x] -> movk x(d),#:tprel_g0_nc:x */
+            write32le(ptr, 0xf2800000 | (read32le(ptr) & 0x1f) |
+                      (tpoff(S, val) & 0xffff) << 5);
+            return;
         case R_AARCH64_COPY:
             return;
         case R_AARCH64_GLOB_DAT:
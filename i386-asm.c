@@ -497,6 +497,47 @@ ST_FUNC void gen_expr64(TCCState *S, ExprValue *pe)
 }
 #endif
 
+/* SSE float and double operation of the i386 (-msse2) and x86_64 code
+   generators: vtop[-1] is in a xmm register, vtop in a xmm register or
+   in memory at 'fr'/'fc'.  'op' is '+', '-', '*', '/' or a compare,
+   where '<' and '<=' must be swapped to '>' and '>=' by the caller.
+   A compare leaves a VT_CMP with the op in cmp_r, see gen_sse_unordered(). */
+ST_FUNC void gen_sse_opf(TCCState *S, int op, int fr, int fc)
+{
+    int bt = S->vtop->type.t & VT_BTYPE, r = S->vtop[-1].r - TREG_XMM0, a;
+
+    if (op >= TOK_ULT && op <= TOK_GT) {
+        if (bt == VT_DOUBLE)
+            g(S, 0x66);
+        if (op == TOK_EQ || op == TOK_NE) {
+            o(S, 0x2e0f); /* ucomis[sd] */
+        } else {
+            o(S, 0x2f0f); /* comis[sd] */
+            op = op == TOK_GT ? TOK_UGT : TOK_UGE; /* seta, setae */
+        }
+    } else {
+        a = op == '-' ? 4 : op == '*' ? 1 : op == '/' ? 6 : 0;
+        o(S, 0x580ff2 + (bt == VT_FLOAT) + (a << 16)); /* adds[sd] ... */
+    }
+    if (fr & VT_LVAL)
+        gen_modrm(S, r, fr, S->vtop->sym, fc);
+    else
+        o(S, 0xc0 + (fr - TREG_XMM0) + r * 8);
+    S->vtop--;
+    if (op >= TOK_ULT && op <= TOK_GT) {
+        vset_VT_CMP(S, op | 0x100);
+        S->vtop->cmp_r = op;
+    }
+}
+
+/* The parity flag is set after a SSE compare 'cmp' if the operands were
+   unordered (NaN), which is false for everything except '!='.  Returns
+   the value of the test 'op' (cmp or its inverse) in that case. */
+ST_FUNC int gen_sse_unordered(int cmp, int op)
+{
+    return (op != cmp) ^ (cmp == TOK_NE);
+}
+
 /* XXX: unify with C code output ? */
 static void gen_disp32(TCCState *S, ExprValue *pe)
 {
@@ -21,7 +21,7 @@
 #ifdef TARGET_DEFS_ONLY
 
 /* number of available registers */
-#define NB_REGS         5
+#define NB_REGS         16
 #define NB_ASM_REGS     8
 #define CONFIG_TCC_ASM
 
@@ -35,6 +35,7 @@
 #define RC_ECX     0x0010
 #define RC_EDX     0x0020
 #define RC_EBX     0x0040
+#define RC_XMM     0x0080 /* scalar float/double with -msse2 */
 
 #define RC_IRET    RC_EAX /* function return: integer register */
 #define RC_IRE2    RC_EDX /* function return: second integer register */
@@ -47,7 +48,10 @@ enum {
     TREG_EDX,
     TREG_EBX,
     TREG_ST0,
-    TREG_ESP = 4
+    TREG_ESP = 4,
+    /* above the asm register numbers of %ebp, %esi and %edi */
+    TREG_XMM0 = 8,
+    TREG_XMM7 = 15
 };
 
 /* return registers for function */
@@ -95,6 +99,15 @@ ST_DATA const int reg_classes[NB_REGS] = {
     /* edx */ RC_INT | RC_EDX,
     /* ebx */ (RC_INT | RC_EBX) * USE_EBX,
     /* st0 */ RC_FLOAT | RC_ST0,
+    0, 0, 0,
+    /* xmm0 */ RC_XMM,
+    /* xmm1 */ RC_XMM,
+    /* xmm2 */ RC_XMM,
+    /* xmm3 */ RC_XMM,
+    /* xmm4 */ RC_XMM,
+    /* xmm5 */ RC_XMM,
+    /* xmm6 */ RC_XMM,
+    /* xmm7 */ RC_XMM,
 };
 
 #ifdef CONFIG_TCC_BCHECK
@@ -186,7 +199,7 @@ ST_FUNC void gen_addrpc32(TCCState *S, int r, Sym *sym, int c)
 
 /* generate a modrm reference. 'op_reg' contains the additional 3
    opcode bits */
-static void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c)
+ST_FUNC void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c)
 {
     op_reg = op_reg << 3;
     if ((r & VT_VALMASK) == VT_CONST) {
@@ -207,6 +220,24 @@ static void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c)
     }
 }
 
+/* move a float or double between %st(0) and the sse register 'r'
+   through the stack */
+static void gen_move_st0(TCCState *S, int r, int bt, int to_st0)
+{
+    int f = bt == VT_FLOAT;
+    o(S, 0x08ec83); /* sub $8, %esp */
+    if (to_st0) {
+        o(S, 0x110ff2 + f); /* movs[sd] %xmm, (%esp) */
+        o(S, 0x2404 + (r - TREG_XMM0) * 8);
+        o(S, f ? 0x2404d9 : 0x2404dd); /* fld[sl] (%esp) */
+    } else {
+        o(S, f ? 0x241cd9 : 0x241cdd); /* fstp[sl] (%esp) */
+        o(S, 0x100ff2 + f); /* movs[sd] (%esp), %xmm */
+        o(S, 0x2404 + (r - TREG_XMM0) * 8);
+    }
+    o(S, 0x08c483); /* add $8, %esp */
+}
+
 /* load 'r' from value 'sv' */
 ST_FUNC void load(TCCState *S, int r, SValue *sv)
 {
@@ -236,7 +267,11 @@ ST_FUNC void load(TCCState *S, int r, SValue *sv)
                 fr = get_reg(S, RC_INT);
             load(S, fr, &v1);
         }
-        if ((ft & VT_BTYPE) == VT_FLOAT) {
+        if (r >= TREG_XMM0) {
+            /* movss or movsd */
+            o(S, 0x100ff2 + ((ft & VT_BTYPE) == VT_FLOAT));
+            r -= TREG_XMM0;
+        } else if ((ft & VT_BTYPE) == VT_FLOAT) {
             o(S, 0xd9); /* flds */
             r = 0;
         } else if ((ft & VT_BTYPE) == VT_DOUBLE) {
@@ -270,6 +305,13 @@ ST_FUNC void load(TCCState *S, int r, SValue *sv)
                 o(S, 0xe8 + r); /* mov %ebp, r */
             }
         } else if (v == VT_CMP) {
+            if (fc & 0x100) {
+                /* sse compare: the result if unordered */
+                fc &= ~0x100;
+                o(S, 0xb0 + r); /* mov $0/1, %al */
+                g(S, gen_sse_unordered(sv->cmp_r, fc));
+                o(S, 0x037a); /* jp +3 */
+            }
             o(S, 0x0f); /* setxx %br */
             o(S, fc);
             o(S, 0xc0 + r);
@@ -280,6 +322,16 @@ ST_FUNC void load(TCCState *S, int r, SValue *sv)
             o(S, 0x05eb); /* jmp after */
             gsym(S, fc);
             oad(S, 0xb8 + r, t ^ 1); /* mov $0, r */
+        } else if (r >= TREG_XMM0) {
+            if (v == TREG_ST0) {
+                gen_move_st0(S, r, ft & VT_BTYPE, 0);
+            } else if (v != r) {
+                o(S, 0x280f); /* movaps v, r */
+                o(S, 0xc0 + (v - TREG_XMM0) + (r - TREG_XMM0) * 8);
+            }
+        } else if (v >= TREG_XMM0) {
+            /* to %st(0), e.g. for the return value */
+            gen_move_st0(S, v, ft & VT_BTYPE, 1);
         } else if (v != r) {
             o(S, 0x89);
             o(S, 0xc0 + r + v * 8); /* mov v, r */
@@ -303,7 +355,10 @@ ST_FUNC void store(TCCState *S, int r, SValue *v)
     ft &= ~(VT_VOLATILE | VT_CONSTANT);
     bt = ft & VT_BTYPE;
     /* XXX: incorrect if float reg to reg */
-    if (bt == VT_FLOAT) {
+    if (r >= TREG_XMM0) {
+        o(S, 0x110ff2 + (bt == VT_FLOAT)); /* movs[sd] */
+        r -= TREG_XMM0;
+    } else if (bt == VT_FLOAT) {
         o(S, 0xd9); /* fsts */
         r = 2;
     } else if (bt == VT_DOUBLE) {
@@ -437,13 +492,22 @@ ST_FUNC void gfunc_call(TCCState *S, int nb_args)
             vstore(S);
             args_size += size;
         } else if (is_float(S->vtop->type.t)) {
-            gv(S, RC_FLOAT); /* only one float register */
             if ((S->vtop->type.t & VT_BTYPE) == VT_FLOAT)
                 size = 4;
             else if ((S->vtop->type.t & VT_BTYPE) == VT_DOUBLE)
                 size = 8;
             else
                 size = 12;
+            if (size != 12 && S->sse2) {
+                r = gv(S, RC_XMM);
+                oad(S, 0xec81, size); /* sub $xxx, %esp */
+                o(S, 0x110ff2 + (size == 4)); /* movs[sd] %xmm, (%esp) */
+                o(S, 0x2404 + (r - TREG_XMM0) * 8);
+                args_size += size;
+                S->vtop--;
+                continue;
+            }
+            gv(S, RC_FLOAT); /* only one float register */
             oad(S, 0xec81, size); /* sub $xxx, %esp */
             if (size == 12)
                 o(S, 0x7cdb);
@@ -685,6 +749,17 @@ ST_FUNC int gjmp_append(TCCState *S, int n, int t)
 
 ST_FUNC int gjmp_cond(TCCState *S, int op, int t)
 {
+    if (op & 0x100) {
+        /* sse compare: if unordered (parity set), jump to 't' or skip
+           the test, depending on the result of 'op' then */
+        op &= ~0x100;
+        if (!gen_sse_unordered(S->vtop->cmp_r, op)) {
+            o(S, 0x067a); /* jp +6 */
+        } else {
+            g(S, 0x0f);
+            t = gjmp2(S, 0x8a, t); /* jp t */
+        }
+    }
     g(S, 0x0f);
     t = gjmp2(S, op - 16, t);
     return t;
@@ -826,6 +901,56 @@ ST_FUNC void gen_opi(TCCState *S, int op)
     }
 }
 
+/* float and double operations with -msse2. The first operand is
+   loaded to a xmm register, the second may stay in memory. */
+static void gen_opf_sse(TCCState *S, int op)
+{
+    int fc, r, fr;
+    int bt = S->vtop->type.t & VT_BTYPE;
+
+    if (op == TOK_NEG) { /* unary minus */
+        r = gv(S, RC_XMM) - TREG_XMM0;
+        fr = get_reg(S, RC_XMM) - TREG_XMM0;
+        o(S, 0x760f66); /* pcmpeqd %xmm1, %xmm1 */
+        o(S, 0xc0 + fr * 9);
+        o(S, bt == VT_FLOAT ? 0x720f66 : 0x730f66); /* psll[dq] $31/63 */
+        o(S, 0xf0 + fr);
+        g(S, bt == VT_FLOAT ? 31 : 63);
+        if (bt == VT_DOUBLE)
+            g(S, 0x66);
+        o(S, 0x570f); /* xorp[sd] %xmm1, %xmm0 */
+        o(S, 0xc0 + fr + r * 8);
+        return;
+    }
+
+    if (op == TOK_LT || op == TOK_LE) {
+        vswap(S);
+        op ^= TOK_LT ^ TOK_GT; /* a < b is b > a */
+    }
+    if (!(S->vtop->r & VT_LVAL))
+        gv(S, RC_XMM);
+    vswap(S);
+    gv(S, RC_XMM);
+    vswap(S);
+
+    /* if saved lvalue, then we must reload it */
+    fr = S->vtop->r;
+    fc = S->vtop->c.i;
+    if ((fr & VT_VALMASK) == VT_LLOCAL) {
+        SValue v1;
+        r = get_reg(S, RC_INT);
+        v1.type.t = VT_INT;
+        v1.r = VT_LOCAL | VT_LVAL;
+        v1.c.i = fc;
+        v1.sym = NULL;
+        load(S, r, &v1);
+        fr = r | VT_LVAL;
+        fc = 0;
+    }
+
+    gen_sse_opf(S, op, fr, fc);
+}
+
 /* generate a floating point operation 'v = t1 op t2' instruction. The
    two operands are guaranteed to have the same floating point type */
 /* XXX: need to use ST1 too */
@@ -833,6 +958,11 @@ ST_FUNC void gen_opf(TCCState *S, int op)
 {
     int a, ft, fc, swapped, r;
 
+    if (S->sse2 && (S->vtop->type.t & VT_BTYPE) != VT_LDOUBLE) {
+        gen_opf_sse(S, op);
+        return;
+    }
+
     if (op == TOK_NEG) { /* unary minus */
         gv(S, RC_FLOAT);
         o(S, 0xe0d9); /* fchs */
@@ -952,6 +1082,20 @@ ST_FUNC void gen_opf(TCCState *S, int op)
    and 'long long' cases. */
 ST_FUNC void gen_cvt_itof(TCCState *S, int t)
 {
+    int r, fr;
+
+    if (S->sse2 && (t & VT_BTYPE) != VT_LDOUBLE
+        && (S->vtop->type.t & VT_BTYPE) != VT_LLONG
+        && (S->vtop->type.t & (VT_BTYPE | VT_UNSIGNED))
+           != (VT_INT | VT_UNSIGNED)) {
+        /* int to float/double, the other cases use fild below */
+        r = gv(S, RC_INT);
+        fr = get_reg(S, RC_XMM);
+        o(S, 0x2a0ff2 + ((t & VT_BTYPE) == VT_FLOAT)); /* cvtsi2s[sd] */
+        o(S, 0xc0 + r + (fr - TREG_XMM0) * 8);
+        S->vtop->r = fr;
+        return;
+    }
     save_reg(S, TREG_ST0);
     gv(S, RC_INT);
     if ((S->vtop->type.t & VT_BTYPE) == VT_LLONG) {
@@ -984,6 +1128,16 @@ ST_FUNC void gen_cvt_itof(TCCState *S, int t)
 ST_FUNC void gen_cvt_ftoi(TCCState *S, int t)
 {
     int bt = S->vtop->type.t & VT_BTYPE;
+    int r, fr;
+
+    if (S->sse2 && bt != VT_LDOUBLE && t == VT_INT) {
+        fr = gv(S, RC_XMM) - TREG_XMM0;
+        r = get_reg(S, RC_INT);
+        o(S, 0x2c0ff2 + (bt == VT_FLOAT)); /* cvtts[sd]2si */
+        o(S, 0xc0 + fr + r * 8);
+        S->vtop->r = r;
+        return;
+    }
     if (bt == VT_FLOAT)
         vpush_helper_func(S, TOK___fixsfdi);
     else if (bt == VT_LDOUBLE)
@@ -1001,8 +1155,27 @@ ST_FUNC void gen_cvt_ftoi(TCCState *S, int t)
 /* convert from one floating point type to another */
 ST_FUNC void gen_cvt_ftof(TCCState *S, int t)
 {
-    /* all we have to do on i386 is to put the float in a register */
-    gv(S, RC_FLOAT);
+    int bt = S->vtop->type.t & VT_BTYPE;
+    int tbt = t & VT_BTYPE;
+    int r;
+
+    if (!S->sse2) {
+        /* all we have to do on i386 is to put the float in a register */
+        gv(S, RC_FLOAT);
+    } else if (tbt == VT_LDOUBLE) {
+        gv(S, RC_ST0);
+    } else if (bt == VT_LDOUBLE) {
+        /* rounded when moved from %st(0) */
+        gv(S, RC_ST0);
+        S->vtop->type.t = tbt;
+        gv(S, RC_XMM);
+    } else {
+        r = gv(S, RC_XMM) - TREG_XMM0;
+        if (bt != tbt) {
+            o(S, 0x5a0ff2 + (bt == VT_FLOAT)); /* cvts[sd]2s[ds] */
+            o(S, 0xc0 + r * 9);
+        }
+    }
 }
 
 /* char/short to int conversion */
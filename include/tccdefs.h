@@ -53,6 +53,9 @@
 #endif
     #define __SIZEOF_LONG_LONG__ 8
     #define __LONG_LONG_MAX__ 0x7fffffffffffffffLL
+#if (defined __x86_64__ && !defined _WIN32) || defined __aarch64__
+    #define __SIZEOF_INT128__ 16
+#endif
     #define __CHAR_BIT__ 8
     #define __ORDER_LITTLE_ENDIAN__ 1234
     #define __ORDER_BIG_ENDIAN__ 4321
@@ -90,8 +93,10 @@
     #define __NO_TLS 1
     #define __RUNETYPE_INTERNAL 1
 # if __SIZEOF_POINTER__ == 8
+    #ifndef __SIZEOF_INT128__
     /* FIXME, __int128_t is used by setjump */
     #define __int128_t struct { unsigned char _dummy[16] __attribute((aligned(16))); }
+    #endif
     #define __SIZEOF_SIZE_T__ 8
     #define __SIZEOF_PTRDIFF_T__ 8
 #else
@@ -177,11 +182,9 @@
         char *reg_save_area;
     } __builtin_va_list[1];
 
-    void *__va_arg(__builtin_va_list ap, int arg_type, int size, int align);
+    /* __builtin_va_arg(ap, t) is expanded inline by the compiler */
     #define __builtin_va_start(ap, last) \
        (*(ap) = *(__builtin_va_list)((char*)__builtin_frame_address(0) - 24))
-    #define __builtin_va_arg(ap, t)   \
-       (*(t *)(__va_arg(ap, __builtin_va_arg_types(t), sizeof(t), __alignof__(t))))
     #define __builtin_va_copy(dest, src) (*(dest) = *(src))
 
 #else /* _WIN64 */
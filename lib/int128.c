@@ -0,0 +1,284 @@
+/* TCC runtime library: __int128 helpers for 64 bit targets.
+
+   Division, variable shifts and floating point conversions of 128 bit
+   integers are not generated inline.  The helpers work on pairs of
+   64 bit words so that they do not depend on themselves.
+
+   This file is offered as-is, without any warranty.  */
+
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned long long UDItype;
+typedef __int128 TItype;
+typedef unsigned __int128 UTItype;
+
+#ifdef __aarch64__
+/* long double is IEEE quad */
+#define __floatuntixf __floatuntitf
+#define __floattixf __floattitf
+#define __fixunsxfti __fixunstfti
+#define __fixxfti __fixtfti
+#endif
+
+typedef union {
+    UTItype q;
+    struct { UDItype lo, hi; } s;
+} TIunion;
+
+#define TWO64 18446744073709551616.0
+
+static UTItype udivmodti4(UTItype a, UTItype b, UTItype *rp)
+{
+    TIunion n, d, q, r;
+    UDItype c;
+    int i;
+
+    n.q = a, d.q = b;
+    if (n.s.hi == 0 && d.s.hi == 0) {
+        q.s.lo = n.s.lo / d.s.lo, q.s.hi = 0;
+        r.s.lo = n.s.lo % d.s.lo, r.s.hi = 0;
+    } else {
+        /* restoring division, one bit at a time */
+        q.s.lo = q.s.hi = r.s.lo = r.s.hi = 0;
+        for (i = 127; i >= 0; i--) {
+            c = r.s.hi >> 63;
+            r.s.hi = r.s.hi << 1 | r.s.lo >> 63;
+            r.s.lo = r.s.lo << 1
+                | ((i >= 64 ? n.s.hi >> (i - 64) : n.s.lo >> i) & 1);
+            if (c || r.s.hi > d.s.hi
+                  || (r.s.hi == d.s.hi && r.s.lo >= d.s.lo)) {
+                r.s.hi = r.s.hi - d.s.hi - (r.s.lo < d.s.lo);
+                r.s.lo -= d.s.lo;
+                if (i >= 64)
+                    q.s.hi |= 1ULL << (i - 64);
+                else
+                    q.s.lo |= 1ULL << i;
+            }
+        }
+    }
+    if (rp)
+        *rp = r.q;
+    return q.q;
+}
+
+static UTItype negti(UTItype a)
+{
+    TIunion u;
+    u.q = a;
+    u.s.lo = -u.s.lo;
+    u.s.hi = -u.s.hi - (u.s.lo != 0);
+    return u.q;
+}
+
+static int signti(UTItype a)
+{
+    TIunion u;
+    u.q = a;
+    return u.s.hi >> 63;
+}
+
+UTItype __udivti3(UTItype a, UTItype b)
+{
+    return udivmodti4(a, b, 0);
+}
+
+UTItype __umodti3(UTItype a, UTItype b)
+{
+    UTItype r;
+    udivmodti4(a, b, &r);
+    return r;
+}
+
+TItype __divti3(TItype a, TItype b)
+{
+    int sa = signti(a), sb = signti(b);
+    UTItype q;
+    q = udivmodti4(sa ? negti(a) : a, sb ? negti(b) : b, 0);
+    return sa ^ sb ? negti(q) : q;
+}
+
+TItype __modti3(TItype a, TItype b)
+{
+    int sa = signti(a);
+    UTItype r;
+    udivmodti4(sa ? negti(a) : a, signti(b) ? negti(b) : b, &r);
+    return sa ? negti(r) : r;
+}
+
+UTItype __ashlti3(UTItype a, int b)
+{
+    TIunion u;
+    u.q = a;
+    b &= 127;
+    if (b >= 64) {
+        u.s.hi = u.s.lo << (b - 64);
+        u.s.lo = 0;
+    } else if (b) {
+        u.s.hi = u.s.hi << b | u.s.lo >> (64 - b);
+        u.s.lo <<= b;
+    }
+    return u.q;
+}
+
+UTItype __lshrti3(UTItype a, int b)
+{
+    TIunion u;
+    u.q = a;
+    b &= 127;
+    if (b >= 64) {
+        u.s.lo = u.s.hi >> (b - 64);
+        u.s.hi = 0;
+    } else if (b) {
+        u.s.lo = u.s.lo >> b | u.s.hi << (64 - b);
+        u.s.hi >>= b;
+    }
+    return u.q;
+}
+
+TItype __ashrti3(TItype a, int b)
+{
+    TIunion u;
+    UDItype s;
+    u.q = a;
+    s = -(u.s.hi >> 63);
+    b &= 127;
+    if (b >= 64) {
+        u.s.lo = (u.s.hi >> (b - 64)) | (b > 64 ? s << (128 - b) : 0);
+        u.s.hi = s;
+    } else if (b) {
+        u.s.lo = u.s.lo >> b | u.s.hi << (64 - b);
+        u.s.hi = u.s.hi >> b | s << (64 - b);
+    }
+    return u.q;
+}
+
+/* round 'a' to nearest even with 'bits' significant bits: m * 2^e */
+static UDItype roundti(UTItype a, int bits, int *e)
+{
+    TIunion u;
+    UDItype m, r, half = 1ULL << 63;
+    int s;
+
+    u.q = a;
+    *e = 0;
+    if (u.s.hi == 0 && (bits == 64 || u.s.lo >> bits == 0))
+        return u.s.lo; /* exact */
+    /* normalize, then take the top 'bits' bits; the rest and a sticky
+       bit for the lower word decide the rounding */
+    *e = 64;
+    if (u.s.hi == 0)
+        u.s.hi = u.s.lo, u.s.lo = 0, *e = 0;
+    for (s = 32; s; s >>= 1)
+        if (u.s.hi >> (64 - s) == 0) {
+            u.s.hi = u.s.hi << s | u.s.lo >> (64 - s);
+            u.s.lo <<= s;
+            *e -= s;
+        }
+    if (bits < 64)
+        m = u.s.hi >> (64 - bits), r = u.s.hi << bits | (u.s.lo != 0);
+    else
+        m = u.s.hi, r = u.s.lo;
+    *e += 64 - bits;
+    if (r > half || (r == half && (m & 1)))
+        if (++m == 0) /* bits == 64 */
+            m = half, *e += 1;
+    return m;
+}
+
+/* m * 2^e in type T, exact unless it overflows */
+#define FLOATTI(T, a, bits) \
+    int e; \
+    T x = roundti((a), (bits), &e); \
+    for (; e >= 32; e -= 32) \
+        x *= 4294967296.0; \
+    return x * (1ULL << e)
+
+float __floatuntisf(UTItype a)
+{
+    FLOATTI(float, a, 24);
+}
+
+double __floatuntidf(UTItype a)
+{
+    FLOATTI(double, a, 53);
+}
+
+long double __floatuntixf(UTItype a)
+{
+#ifdef __aarch64__
+    /* 113 bits: only the addition rounds */
+    TIunion u;
+    u.q = a;
+    return (long double)u.s.hi * TWO64 + u.s.lo;
+#else
+    FLOATTI(long double, a, 64);
+#endif
+}
+
+float __floattisf(TItype a)
+{
+    if (signti(a))
+        return -__floatuntisf(negti(a));
+    return __floatuntisf(a);
+}
+
+double __floattidf(TItype a)
+{
+    if (signti(a))
+        return -__floatuntidf(negti(a));
+    return __floatuntidf(a);
+}
+
+long double __floattixf(TItype a)
+{
+    if (signti(a))
+        return -__floatuntixf(negti(a));
+    return __floatuntixf(a);
+}
+
+/* the high word is the exact quotient, the remainder is exact too */
+#define FIXUNSTI(T, a) \
+    TIunion u; \
+    if (!((a) >= 1.0)) /* also NaN */ \
+        return 0; \
+    u.s.hi = (UDItype)((a) / TWO64); \
+    u.s.lo = (UDItype)((a) - (T)u.s.hi * TWO64); \
+    return u.q
+
+UTItype __fixunssfti(float a)
+{
+    FIXUNSTI(double, a);
+}
+
+UTItype __fixunsdfti(double a)
+{
+    FIXUNSTI(double, a);
+}
+
+UTItype __fixunsxfti(long double a)
+{
+    FIXUNSTI(long double, a);
+}
+
+TItype __fixsfti(float a)
+{
+    if (a < 0)
+        return negti(__fixunssfti(-a));
+    return __fixunssfti(a);
+}
+
+TItype __fixdfti(double a)
+{
+    if (a < 0)
+        return negti(__fixunsdfti(-a));
+    return __fixunsdfti(a);
+}
+
+TItype __fixxfti(long double a)
+{
+    if (a < 0)
+        return negti(__fixunsxfti(-a));
+    return __fixunsxfti(a);
+}
+
+#endif /* __SIZEOF_INT128__ */
@@ -873,6 +873,7 @@ LIBTCCAPI TCCState *tcc_new(void)
     s->warn_implicit_function_declaration = 1;
     s->warn_discarded_qualifiers = 1;
     s->ms_extensions = 1;
+    s->omit_frame_pointer = 1;
 
 #ifdef CHAR_IS_UNSIGNED
     s->char_is_unsigned = 1;
@@ -1458,6 +1459,17 @@ static int tcc_set_linker(TCCState *S, const char *option)
             copy_linker_arg(S, &S->rpath, p, ':');
         } else if (link_option(option, "enable-new-dtags", &p)) {
             S->enable_new_dtags = 1;
+        } else if (ret = link_option(option, "?gc-sections", &p), ret) {
+            S->gc_sections = ret > 0;
+        } else if (link_option(option, "icf=", &p)) {
+            if (!strcmp(p, "all"))
+                S->icf = 1;
+            else if (!strcmp(p, "none"))
+                S->icf = 0;
+            else
+                goto err;
+        } else if (link_option(option, "icf", &p)) {
+            S->icf = 1;
         } else if (link_option(option, "section-alignment=", &p)) {
             S->section_align = strtoul(p, &end, 16);
         } else if (link_option(option, "soname=", &p)) {
@@ -1552,6 +1564,8 @@ enum {
     TCC_OPTION_O,
     TCC_OPTION_mfloat_abi,
     TCC_OPTION_m,
+    TCC_OPTION_falign_functions,
+    TCC_OPTION_falign_loops,
     TCC_OPTION_f,
     TCC_OPTION_isystem,
     TCC_OPTION_iwithprefix,
@@ -1619,6 +1633,8 @@ static const TCCOption tcc_options[] = {
     { "mfloat-abi", TCC_OPTION_mfloat_abi, TCC_OPTION_HAS_ARG },
 #endif
     { "m", TCC_OPTION_m, TCC_OPTION_HAS_ARG | TCC_OPTION_NOSEP },
+    { "falign-functions=", TCC_OPTION_falign_functions, TCC_OPTION_HAS_ARG | TCC_OPTION_NOSEP },
+    { "falign-loops=", TCC_OPTION_falign_loops, TCC_OPTION_HAS_ARG | TCC_OPTION_NOSEP },
     { "f", TCC_OPTION_f, TCC_OPTION_HAS_ARG | TCC_OPTION_NOSEP },
     { "isystem", TCC_OPTION_isystem, TCC_OPTION_HAS_ARG },
     { "include", TCC_OPTION_include, TCC_OPTION_HAS_ARG },
@@ -1675,6 +1691,9 @@ static const FlagDef options_f[] = {
     { offsetof(TCCState, ms_extensions), 0, "ms-extensions" },
     { offsetof(TCCState, dollars_in_identifiers), 0, "dollars-in-identifiers" },
     { offsetof(TCCState, test_coverage), 0, "test-coverage" },
+    { offsetof(TCCState, function_sections), 0, "function-sections" },
+    { offsetof(TCCState, data_sections), 0, "data-sections" },
+    { offsetof(TCCState, omit_frame_pointer), 0, "omit-frame-pointer" },
     { 0, 0, NULL }
 };
 
@@ -1682,6 +1701,14 @@ static const FlagDef options_m[] = {
     { offsetof(TCCState, ms_bitfields), 0, "ms-bitfields" },
 #ifdef TCC_TARGET_X86_64
     { offsetof(TCCState, nosse), FD_INVERT, "sse" },
+    { offsetof(TCCState, popcnt), 0, "popcnt" },
+    { offsetof(TCCState, lzcnt), 0, "lzcnt" },
+#endif
+#ifdef TCC_TARGET_RISCV64
+    { offsetof(TCCState, zbb), 0, "zbb" },
+#endif
+#ifdef TCC_TARGET_I386
+    { offsetof(TCCState, sse2), 0, "sse2" },
 #endif
     { 0, 0, NULL }
 };
@@ -1960,6 +1987,18 @@ reparse:
             do ++S->verbose; while (*optarg++ == 'v');
             ++noaction;
             break;
+        case TCC_OPTION_falign_functions:
+        case TCC_OPTION_falign_loops:
+            x = atoi(optarg);
+            if (x < 0 || x > 4096)
+                tcc_error(S, "invalid alignment '%s'", optarg);
+            while (x & (x - 1)) /* like gcc, round up to a power of two */
+                x += x & -x;
+            if (popt->index == TCC_OPTION_falign_functions)
+                S->align_functions = x;
+            else
+                S->align_loops = x;
+            break;
         case TCC_OPTION_f:
             if (set_flag(S, options_f, optarg) < 0)
                 goto unsupported_option;
@@ -4,6 +4,8 @@
 #define NB_REGS 19 // x10-x17 aka a0-a7, f10-f17 aka fa0-fa7, xxx, ra, sp
 #define NB_ASM_REGS 32
 #define CONFIG_TCC_ASM
+#define CONFIG_TCC_JMPTABLE
+#define CONFIG_TCC_SELECT // branchless '?:', see gen_select()
 
 #define TREG_R(x) (x) // x = 0..7
 #define TREG_F(x) (x + 8) // x = 0..7
@@ -987,6 +989,22 @@ ST_FUNC int gjmp_cond(TCCState *S, int op, int t)
     return gjmp(S, t);
 }
 
+// Replace vtop[-1] (the value if false) and vtop (if true), both in
+// registers, by the one selected by the 0/1 register 'cond', with a
+// mask instead of a branch:
+ST_FUNC void gen_select(TCCState *S, SValue *cond)
+{
+    int c = ireg(cond->r);
+    int f = ireg(S->vtop[-1].r);
+    int t = ireg(S->vtop->r);
+
+    ER(S, 0x33, 0, c, 0, c, 0x20); // sub c, zero, c
+    ER(S, 0x33, 4, t, t, f, 0); // xor t, t, f
+    ER(S, 0x33, 7, t, t, c, 0); // and t, t, c
+    ER(S, 0x33, 4, f, f, t, 0); // xor f, f, t
+    --S->vtop;
+}
+
 ST_FUNC int gjmp_append(TCCState *S, int n, int t)
 {
     void *p;
@@ -1019,6 +1037,27 @@ static void gen_opil(TCCState *S, int op, int ll)
             ++S->vtop;
             vswap(S);
             switch (op) {
+                case '*': {
+                    /* (2^k +- 1) << j by shift and add/sub */
+                    int j = 0, k = 0, v, sub;
+                    if (fc < 3)
+                      break;
+                    while (!(fc >> j & 1))
+                      j++;
+                    v = fc >> j;
+                    sub = !(v & (v + 1));
+                    if (v == 1 || (!sub && ((v - 1) & (v - 2))))
+                      break;
+                    while ((1 << k) < (sub ? v + 1 : v - 1))
+                      k++;
+                    EI(S, 0x13 | ll, 1, 5, a, k); // slli t0, a, k
+                    ER(S, 0x33 | ll, 0, ireg(d), 5, a, sub ? 0x20 : 0); // add/sub d, t0, a
+                    if (j)
+                      EI(S, 0x13 | ll, 1, ireg(d), ireg(d), j); // slli d, d, j
+                    --S->vtop;
+                    S->vtop[0].r = d;
+                    return;
+                }
                 case '-':
                     if (fc <= -(1 << 11))
                       break;
@@ -1125,6 +1164,12 @@ static void gen_opil(TCCState *S, int op, int ll)
     case TOK_UMOD:
         ER(S, 0x33 | ll, 7, d, a, b, 1); // remu d, a, b
         break;
+    case TOK_UMULH:
+        ER(S, 0x33, 3, d, a, b, 1); // mulhu d, a, b
+        break;
+    case TOK_SMULH:
+        ER(S, 0x33, 1, d, a, b, 1); // mulh d, a, b
+        break;
     case TOK_PDIV:
     case TOK_UDIV:
         ER(S, 0x33 | ll, 5, d, a, b, 1); // divu d, a, b
@@ -1241,6 +1286,163 @@ ST_FUNC void gen_cvt_sxtw(TCCState *S)
        Let's try to not do anything here.  */
 }
 
+/* __builtin_popcount, ctz, clz, ffs or bswap of vtop in place with
+   the Zbb extension, see builtin_bitop() */
+ST_FUNC int gen_bitop(TCCState *S, int op)
+{
+    int bt = S->vtop->type.t & VT_BTYPE, w = bt != VT_LLONG, r, t;
+
+    if (!S->zbb)
+        return 0;
+    r = ireg(gv(S, RC_INT));
+    switch (op) {
+    case TOK_builtin_popcount:
+        EIu(S, 0x13 | w << 3, 1, r, r, 0x602); // cpop[w] r, r
+        break;
+    case TOK_builtin_ctz:
+        EIu(S, 0x13 | w << 3, 1, r, r, 0x601); // ctz[w] r, r
+        break;
+    case TOK_builtin_clz:
+        EIu(S, 0x13 | w << 3, 1, r, r, 0x600); // clz[w] r, r
+        break;
+    case TOK_builtin_ffs:
+        /* 32 or 64 - clz(x & -x) */
+        t = ireg(get_reg(S, RC_INT));
+        ER(S, 0x33, 0, t, 0, r, 0x20); // sub t, zero, r
+        ER(S, 0x33, 7, t, t, r, 0); // and t, t, r
+        EIu(S, 0x13 | w << 3, 1, t, t, 0x600); // clz[w] t, t
+        ER(S, 0x33, 0, r, 0, t, 0x20); // sub r, zero, t
+        EI(S, 0x13, 0, r, r, w ? 32 : 64); // addi r, r, 32/64
+        break;
+    default:
+        EIu(S, 0x13, 5, r, r, 0x6b8); // rev8 r, r
+        if (bt == VT_SHORT)
+            EI(S, 0x13, 5, r, r, 48); // srli r, r, 48
+        else if (w)
+            EIu(S, 0x13, 5, r, r, 0x420); // srai r, r, 32
+        break;
+    }
+    return 1;
+}
+
+static void EB(TCCState *S, uint32_t func3, uint32_t rs1, uint32_t rs2, int imm)
+{
+    o(S, 0x63 | func3 << 12 | rs1 << 15 | rs2 << 20 | (imm >> 11 & 1) << 7
+      | (imm >> 1 & 15) << 8 | (imm >> 5 & 63) << 25 | (imm >> 12 & 1) << 31);
+}
+
+/* inline __atomic_xxx with fences, AMOs and LR/SC loops, see
+   parse_atomic().  Bytes and halfwords are done on the aligned word
+   containing them, with t0 = shift, t1 = address, t2 = mask */
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo)
+{
+    int aq = mo != 0 && mo != 3, rl = mo >= 3, w = size == 8 ? 3 : 2;
+    int p, e = 0, v, c, f5, loop;
+
+    switch (op) {
+    case TOK___atomic_load:
+        if (mo == 5)
+            o(S, 0x0330000f); // fence rw,rw
+        indir(S);
+        gv(S, RC_INT);
+        if (aq)
+            o(S, 0x0230000f); // fence r,rw
+        return;
+    case TOK___atomic_store:
+        if (rl)
+            o(S, 0x0310000f); // fence rw,w
+        vswap(S);
+        indir(S);
+        vswap(S);
+        vstore(S);
+        vpop(S);
+        return;
+    case TOK___atomic_compare_exchange:
+        /* twice, as loading one may spill the others */
+        for (loop = 0; loop < 6; loop++) {
+            vrotb(S, 3);
+            gv(S, RC_INT);
+        }
+        p = ireg(S->vtop[-2].r);
+        e = ireg(S->vtop[-1].r);
+        break;
+    default:
+        gv2(S, RC_INT, RC_INT);
+        p = ireg(S->vtop[-1].r);
+        break;
+    }
+    v = ireg(S->vtop->r);
+
+    f5 = op == TOK___atomic_exchange ? 1 : op == TOK___atomic_fetch_or ? 8
+        : op == TOK___atomic_fetch_xor ? 4 : op == TOK___atomic_fetch_and ? 12
+        : 0;
+    if (op == TOK___atomic_fetch_sub)
+        ER(S, 0x33, 0, v, 0, v, 0x20); // neg v, v
+
+    if (size < 4) {
+        EI(S, 0x13, 7, 5, p, 3); // andi t0, p, 3
+        EI(S, 0x13, 1, 5, 5, 3); // slli t0, t0, 3
+        EI(S, 0x13, 7, 6, p, -4); // andi t1, p, -4
+        if (size == 1) {
+            EI(S, 0x13, 0, 7, 0, 255); // li t2, 0xff
+        } else {
+            o(S, 0x37 | 7 << 7 | 16 << 12); // lui t2, 16
+            EI(S, 0x1b, 0, 7, 7, -1); // addiw t2, t2, -1
+        }
+        ER(S, 0x33, 1, 7, 7, 5, 0); // sll t2, t2, t0
+        c = op == TOK___atomic_compare_exchange ? e : 28;
+        ER(S, 0x33, 1, c, c == e ? e : v, 5, 0); // sll c, e/v, t0
+        ER(S, 0x33, 7, c, c, 7, 0); // and c, c, t2
+        if (c == e) {
+            ER(S, 0x33, 1, v, v, 5, 0); // sll v, v, t0
+            ER(S, 0x33, 7, v, v, 7, 0); // and v, v, t2
+        }
+        loop = S->ind;
+        ER(S, 0x2f, 2, 29, 6, 0, 2 << 2 | aq << 1 | (mo == 5)); // lr.w t4, (t1)
+        if (c == e) {
+            ER(S, 0x33, 7, 30, 29, 7, 0); // and t5, t4, t2
+            EB(S, 1, 30, e, 28); // bne t5, e, 1f
+            ER(S, 0x33, 0, 30, v, 0, 0); // mv t5, v
+        } else if (f5 == 1) {
+            ER(S, 0x33, 0, 30, 28, 0, 0); // mv t5, t3
+        } else {
+            ER(S, 0x33, f5 == 8 ? 6 : f5 == 4 ? 4 : f5 == 12 ? 7 : 0,
+               30, 29, 28, 0); // add/or/xor/and t5, t4, t3
+        }
+        /* merge the result into the other bytes of the word */
+        ER(S, 0x33, 4, 30, 30, 29, 0); // xor t5, t5, t4
+        ER(S, 0x33, 7, 30, 30, 7, 0); // and t5, t5, t2
+        ER(S, 0x33, 4, 30, 30, 29, 0); // xor t5, t5, t4
+        ER(S, 0x2f, 2, 31, 6, 30, 3 << 2 | rl); // sc.w t6, t5, (t1)
+        EB(S, 1, 31, 0, loop - S->ind); // bnez t6, loop
+        if (c == e) { /* 1: */
+            ER(S, 0x33, 7, 30, 29, 7, 0); // and t5, t4, t2
+            ER(S, 0x33, 4, 30, 30, e, 0); // xor t5, t5, e
+            EI(S, 0x13, 3, e, 30, 1); // seqz e, t5
+        }
+        ER(S, 0x33, 5, p, 29, 5, 0); // srl p, t4, t0
+    } else if (op == TOK___atomic_compare_exchange) {
+        c = e;
+        if (w == 2)
+            EI(S, 0x1b, 0, c = 7, e, 0); // sext.w t2, e
+        loop = S->ind;
+        ER(S, 0x2f, w, 5, p, 0, 2 << 2 | aq << 1 | (mo == 5)); // lr.w/d t0, (p)
+        EB(S, 1, 5, c, 12); // bne t0, c, 1f
+        ER(S, 0x2f, w, 6, p, v, 3 << 2 | rl); // sc.w/d t1, v, (p)
+        EB(S, 1, 6, 0, loop - S->ind); // bnez t1, loop
+        /* 1: */
+        ER(S, 0x33, 4, 6, 5, c, 0); // xor t1, t0, c
+        EI(S, 0x13, 3, e, 6, 1); // seqz e, t1
+        EI(S, 0x13, 0, p, 5, 0); // mv p, t0
+    } else {
+        ER(S, 0x2f, w, p, p, v, f5 << 2 | aq << 1 | rl); // amo<op>.w/d p, v, (p)
+    }
+
+    --S->vtop;
+    if (op == TOK___atomic_compare_exchange)
+        S->vtop->type.t = VT_INT; /* [p e d] -> [old ok] */
+}
+
 ST_FUNC void gen_cvt_itof(TCCState *S, int t)
 {
     int rr = ireg(gv(S, RC_INT)), dr;
@@ -1373,6 +1575,25 @@ ST_FUNC void ggoto(TCCState *S)
     S->vtop--;
 }
 
+// Jump through switch table of offsets relative to its start:
+ST_FUNC void gen_jmptable(TCCState *S, Sym *table)
+{
+    Sym label = {0};
+    int r = ireg(gv(S, RC_INT));
+    greloca(S, cur_text_section, table, S->ind, R_RISCV_PCREL_HI20, 0);
+    label.type.t = VT_VOID | VT_STATIC;
+    put_extern_sym(S, &label, cur_text_section, S->ind, 0);
+    o(S, 0x17 | (5 << 7));           // auipc t0, %pcrel_hi(table)
+    greloca(S, cur_text_section, &label, S->ind, R_RISCV_PCREL_LO12_I, 0);
+    EI(S, 0x13, 0, 5, 5, 0);         // addi t0, t0, %pcrel_lo(table)
+    EI(S, 0x13, 1, r, r, 2);         // slli r, r, 2
+    ER(S, 0x33, 0, r, r, 5, 0);      // add r, r, t0
+    EI(S, 0x03, 2, r, r, 0);         // lw r, 0(r)
+    ER(S, 0x33, 0, r, r, 5, 0);      // add r, r, t0
+    EI(S, 0x67, 0, 0, r, 0);         // jalr x0, 0(r)
+    S->vtop--;
+}
+
 ST_FUNC void gen_vla_sp_save(TCCState *S, int addr)
 {
     ES(S, 0x23, 3, 8, 2, addr); // sd sp, fc(s0)
@@ -4,6 +4,7 @@
 
 #define R_DATA_32  R_RISCV_32
 #define R_DATA_PTR R_RISCV_64
+#define R_DATA_PC32 R_RISCV_32_PCREL
 #define R_JMP_SLOT R_RISCV_JUMP_SLOT
 #define R_GLOB_DAT R_RISCV_64
 #define R_COPY     R_RISCV_COPY
@@ -339,6 +340,8 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr,
         return;
 
     case R_RISCV_32_PCREL:
+        write32le(ptr, val - addr);
+        return;
     case R_RISCV_COPY:
         /* XXX */
         return;
@@ -89,7 +89,8 @@ static const char help2[] =
     "  -P -P1                        with -E: no/alternative #line output\n"
     "  -dD -dM                       with -E: output #define directives\n"
     "  -pthread                      same as -D_REENTRANT and -lpthread\n"
-    "  -On                           same as -D__OPTIMIZE__ for n > 0\n"
+    "  -On                           same as -D__OPTIMIZE__ for n > 0, and use\n"
+    "                                registers for local variables (x86_64)\n"
     "  -Wp,-opt                      same as -opt\n"
     "  -include file                 include 'file' above each input file\n"
     "  -isystem dir                  add 'dir' to system include path\n"
@@ -114,6 +115,9 @@ static const char help2[] =
     "  ms-extensions                 allow anonymous struct in struct\n"
     "  dollars-in-identifiers        allow '$' in C symbols\n"
     "  test-coverage                 create code coverage code\n"
+    "  function-sections             put each function in its own section\n"
+    "  data-sections                 put each variable in its own section\n"
+    "  omit-frame-pointer            no frame in small leaf functions (-O)\n"
     "-m... target specific options:\n"
     "  ms-bitfields                  use MSVC bitfield layout\n"
 #ifdef TCC_TARGET_ARM
@@ -129,6 +133,8 @@ static const char help2[] =
     "  -export-dynamic               same as -rdynamic\n"
     "  -image-base= -Ttext=          set base address of executable\n"
     "  -section-alignment=           set section alignment in executable\n"
+    "  -[no-]gc-sections             remove unreferenced sections\n"
+    "  -icf=all|none                 fold identical static functions\n"
 #ifdef TCC_TARGET_PE
     "  -file-alignment=              set PE file alignment\n"
     "  -stack=                       set PE stack reserve\n"
@@ -42,6 +42,7 @@
 #ifndef _WIN32
 # include <unistd.h>
 # include <sys/time.h>
+# include <sys/stat.h>
 # ifndef CONFIG_TCC_STATIC
 #  include <dlfcn.h>
 # endif
@@ -505,6 +506,9 @@ typedef union CValue {
         int size;
     } str;
     int tab[LDOUBLE_SIZE/4];
+#ifdef CONFIG_TCC_INT128
+    uint64_t q[2]; /* __int128: low and high word */
+#endif
 } CValue;
 
 /* value on stack */
@@ -535,7 +539,9 @@ struct SymAttr {
     nodecorate  : 1,
     dllimport   : 1,
     addrtaken   : 1,
-    xxxx        : 3; /* not used */
+    fieldidx    : 1, /* struct: use a FieldIndex for member lookup */
+    vector      : 1, /* struct: GCC vector type, see vector_type() */
+    tls         : 1; /* __thread or _Thread_local variable */
 };
 
 /* function attributes or temporary attributes for parsing */
@@ -548,7 +554,9 @@ struct FuncAttr {
     func_dtor   : 1, /* attribute((destructor)) */
     func_args   : 8, /* PE __stdcall args */
     func_alwinl : 1, /* always_inline */
-    xxxx        : 15;
+    func_cold   : 1, /* attribute((cold)) */
+    func_hot    : 1, /* attribute((hot)) */
+    xxxx        : 13;
 };
 
 /* symbol management */
@@ -673,7 +681,9 @@ typedef struct TokenString {
     int lastlen;
     int allocated_len;
     int last_line_num;
+    int last_pack; /* #pragma pack and -mms-bitfields state */
     int save_line_num;
+    int save_pack;
     /* used to chain token-strings with begin/end_macro() */
     struct TokenString *prev;
     const int *prev_ptr;
@@ -689,25 +699,51 @@ typedef struct AttributeDef {
     int alias_target; /* token */
     int asm_label; /* associated asm label */
     char attr_mode; /* __attribute__((__mode__(...))) */
+    int vector_size; /* __attribute__((vector_size(N))) */
 } AttributeDef;
 
 /* inline functions */
 typedef struct InlineFunc {
     TokenString *func_str;
     Sym *sym;
+    int inline_ok; /* 0: not yet scanned, 1: call sites may inline it, -1: not */
     char filename[1];
 } InlineFunc;
 
+/* member lookup index for structs with many members, maps member
+   tokens (including those of anonymous sub-structs) to their Sym and
+   cumulative offset, see find_field() */
+typedef struct FieldIndex {
+    struct FieldIndex *next; /* next index in same hash bucket */
+    Sym *type; /* struct/union symbol (type->ref) */
+    int mask; /* number of slots - 1 */
+    struct FieldSlot { int v, cumofs; Sym *f; } slots[1];
+} FieldIndex;
+
+#define FIELD_INDEX_MIN 16 /* members needed for a struct to get an index */
+
+/* use count of an identifier in the function being compiled, used to
+   pick register variables with -O1 (-1 if its address is taken) */
+typedef struct RegvarCand {
+    int v, weight;
+} RegvarCand;
+
 /* include file cache, used to find files faster and also to eliminate
-   inclusion if the include file is protected by #ifndef ... #endif */
+   inclusion if the include file is protected by #ifndef ... #endif.
+   There is one entry per path spelling; entries which reach the same
+   file (same dev/inode) are aliases of the first one seen, which holds
+   the guard state for all of them. */
 typedef struct CachedInclude {
     int ifndef_macro;
     int once;
-    int hash_next; /* -1 if none */
+    struct CachedInclude *file; /* entry holding the guard state */
+    unsigned long long dev, ino; /* file identity, 0/0 if unknown */
+    int hash_next; /* next entry with same path hash, 0 if none */
+    int id_next; /* next entry with same identity hash, 0 if none */
     char filename[1]; /* path specified in #include */
 } CachedInclude;
 
-#define CACHED_INCLUDES_HASH_SIZE 32
+#define CACHED_INCLUDES_HASH_SIZE 32 /* initial size, grows as needed */
 
 #ifdef CONFIG_TCC_ASM
 typedef struct ExprValue {
@@ -766,6 +802,7 @@ typedef struct scope_t {
     struct { Sym *s; int n; } cl;
     int *bsym, *csym;
     Sym *lstk, *llstk;
+    int regvars; /* register variables live on scope entry */
 } scope_t;
 
 typedef struct switch_t {
@@ -780,6 +817,15 @@ typedef struct switch_t {
     SValue sv;
 } switch_t;
 
+/* an unlikely statement, compiled at the end of its compound statement */
+typedef struct cold_t {
+    struct cold_t *prev;
+    TokenString *str; /* its tokens */
+    int jmp, join; /* jumps to it, where to continue after it */
+    scope_t *scope, sc; /* enclosing scope and its state at the 'if' */
+    Sym *lstk; /* local symbols visible from it */
+} cold_t;
+
 #define MAX_TEMP_LOCAL_VARIABLE_NUMBER 8
 /*list of temporary local variables on the stack in current function. */
 typedef struct temp_local_variable_t {
@@ -827,6 +873,8 @@ struct TCCState {
     unsigned char optimize; /* only to #define __OPTIMIZE__ */
     unsigned char option_pthread; /* -pthread option */
     unsigned char enable_new_dtags; /* -Wl,--enable-new-dtags */
+    unsigned char gc_sections; /* -Wl,--gc-sections */
+    unsigned char icf; /* -Wl,--icf: fold identical function sections */
     unsigned int  cversion; /* supported C ISO version, 199901 (the default), 201112, ... */
 
     /* C language options */
@@ -835,6 +883,11 @@ struct TCCState {
     unsigned char ms_extensions; /* allow nested named struct w/o identifier behave like unnamed */
     unsigned char dollars_in_identifiers;  /* allows '$' char in identifiers */
     unsigned char ms_bitfields; /* if true, emulate MS algorithm for aligning bitfields */
+    unsigned char function_sections; /* -ffunction-sections: a section per function */
+    unsigned char data_sections; /* -fdata-sections: a section per variable */
+    unsigned char omit_frame_pointer; /* -fomit-frame-pointer, done with -O */
+    unsigned short align_functions; /* -falign-functions=N, a power of two */
+    unsigned short align_loops; /* -falign-loops=N, a power of two */
 
     /* warning switches */
     unsigned char warn_none;
@@ -872,6 +925,14 @@ struct TCCState {
 
 #ifdef TCC_TARGET_X86_64
     unsigned char nosse; /* For -mno-sse support. */
+    unsigned char popcnt; /* -mpopcnt: use the popcnt instruction */
+    unsigned char lzcnt; /* -mlzcnt: use the lzcnt instruction */
+#endif
+#ifdef TCC_TARGET_RISCV64
+    unsigned char zbb; /* -mzbb: use the Zbb bit manipulation extension */
+#endif
+#ifdef TCC_TARGET_I386
+    unsigned char sse2; /* -msse2: float and double math in xmm registers */
 #endif
 #ifdef TCC_TARGET_ARM
     unsigned char float_abi; /* float ABI of the generated code*/
@@ -1006,7 +1067,8 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     int *ifdef_stack_ptr;
 
     /* included files enclosed with #ifndef MACRO */
-    int cached_includes_hash[CACHED_INCLUDES_HASH_SIZE];
+    int *cached_includes_hash; /* by path, then by identity */
+    int cached_includes_hash_size;
     CachedInclude **cached_includes;
     int nb_cached_includes;
 
@@ -1031,6 +1093,9 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     /* got & plt handling */
     Section *got;
     Section *plt;
+    /* PT_TLS segment of the output file, see layout_sections() */
+    addr_t tls_addr, tls_size;
+    int tls_align;
 
     /* predefined sections */
     Section *text_section, *data_section, *rodata_section, *bss_section;
@@ -1172,6 +1237,7 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
 
     /*----------- tccasm.c --------*/
     Section *tccasm_last_text_section; /* to handle .previous asm directive */
+    int tccasm_nb_inline; /* number of inline asm statements so far */
     
     /* ------------ tccgen.c ------------ */
 
@@ -1184,6 +1250,7 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     SValue *vtop;
     SValue tccgen__vstack[1 + VSTACK_SIZE];
     int tccgen_rsym, tccgen_anon_sym, ind, loc;
+    int tccgen_label_ind; /* code offset of the last jump target (for peephole) */
     char tccgen_debug_modes;
 
     int tccgen_const_wanted; /* true if constant wanted */
@@ -1197,6 +1264,18 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     Sym *tccgen_sym_free_first;
     void **tccgen_sym_pools;
     int tccgen_nb_sym_pools;
+    FieldIndex **tccgen_field_index; /* hash table keyed on struct Sym */
+    int tccgen_field_index_size, tccgen_nb_field_index;
+    Sym **tccgen_vector_types; /* one struct Sym per vector type */
+    int tccgen_nb_vector_types;
+    RegvarCand *tccgen_regvar_cand; /* hash table keyed on token */
+    int tccgen_regvar_cand_size, tccgen_nb_regvar_cand;
+    int tccgen_regvar_nb; /* registers reserved by gfunc_prolog */
+    int tccgen_regvar_used, tccgen_regvar_saved; /* masks of those */
+    int tccgen_inline_depth; /* nesting of call sites being inlined */
+    int tccgen_inline_level, tccgen_inline_ret; /* its body's local_scope, result slot */
+    int tccgen_tail_ok; /* the body scan allows tail calls */
+    int tccgen_tail_call; /* 1: gfunc_call may jump, 2: it did */
     Sym *tccgen_all_cleanups, *tccgen_pending_gotos;
     int local_scope;
     int tccgen_in_sizeof;
@@ -1207,6 +1286,10 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     CString tccgen_initstr;
     
     switch_t *tccgen_cur_switch; /* current switch */
+    cold_t *tccgen_cold; /* pending unlikely statements */
+    int tccgen_cold_over, tccgen_cold_over_ind; /* jump over them, its target */
+    scope_t *tccgen_cold_scope; /* scope of the compound statement being parsed */
+    int tccgen_expect; /* 1: unlikely, 2: likely, from __builtin_expect() */
 
     temp_local_variable_t tccgen_arr_temp_local_vars[MAX_TEMP_LOCAL_VARIABLE_NUMBER];
     int tccgen_nb_temp_local_vars;
@@ -1231,6 +1314,24 @@ AOUTHDR tcccoff_o_filehdr;		/* OPTIONAL (A.OUT) FILE HEADER       */
     /*--------x86_64-gen.c --------*/
     unsigned long x86_64_gen_func_sub_sp_offset;
     int x86_64_gen_func_ret_sub;
+    int x86_64_gen_func_regvar_ind, x86_64_gen_func_regvar_loc;
+    /* peephole: last store of a register (see store()) and the jumps
+       patched to the current code offset (see gsym_addr()) */
+    int x86_64_gen_peep_ind, x86_64_gen_peep_r, x86_64_gen_peep_fr;
+    int x86_64_gen_peep_c, x86_64_gen_peep_size;
+    int x86_64_gen_peep_jmp_ind, x86_64_gen_peep_nb_jmp;
+    int x86_64_gen_peep_jmp[16];
+    /* branch relaxation: the jumps of the current function and the
+       switch tables which refer to it (see gen_relax()) */
+    struct relax_jump *x86_64_gen_relax;
+    int x86_64_gen_nb_relax, x86_64_gen_relax_size;
+    int *x86_64_gen_relax_tab, x86_64_gen_nb_relax_tab;
+    int x86_64_gen_relax_sym, x86_64_gen_relax_rel, x86_64_gen_relax_asm;
+    int x86_64_gen_relax_stab;
+    /* frame pointer omission: the stack slot references of the current
+       function, rewritten once its frame is known (see gen_frame_refs()) */
+    int *x86_64_gen_fp_ref, x86_64_gen_nb_fp_ref, x86_64_gen_fp_ref_size;
+    int x86_64_gen_fp_omit, x86_64_gen_fp_needed;
 #if defined(CONFIG_TCC_BCHECK)
     addr_t func_bound_offset;
     unsigned long func_bound_ind;
@@ -1255,6 +1356,7 @@ struct filespec {
 #define VT_CMP       0x0033  /* the value is stored in processor flags (in vc) */
 #define VT_JMP       0x0034  /* value is the consequence of jmp true (even) */
 #define VT_JMPI      0x0035  /* value is the consequence of jmp false (odd) */
+#define VT_REGVAR    0x0036  /* register variable, register number in vc */
 #define VT_LVAL      0x0100  /* var is an lvalue */
 #define VT_SYM       0x0200  /* a symbol value is added */
 #define VT_MUSTCAST  0x0C00  /* value must be casted to be correct (used for
@@ -1277,7 +1379,7 @@ struct filespec {
 #define VT_DOUBLE           9  /* IEEE double */
 #define VT_LDOUBLE         10  /* IEEE long double */
 #define VT_BOOL            11  /* ISOC99 boolean type */
-#define VT_QLONG           13  /* 128-bit integer. Only used for x86-64 ABI */
+#define VT_QLONG           13  /* 128-bit integer (__int128, x86-64 ABI) */
 #define VT_QFLOAT          14  /* 128-bit float. Only used for x86-64 ABI */
 
 #define VT_UNSIGNED    0x0010  /* unsigned type */
@@ -1308,6 +1410,9 @@ struct filespec {
 #define IS_ENUM(t) ((t & VT_STRUCT_MASK) == VT_ENUM)
 #define IS_ENUM_VAL(t) ((t & VT_STRUCT_MASK) == VT_ENUM_VAL)
 #define IS_UNION(t) ((t & (VT_STRUCT_MASK|VT_BTYPE)) == VT_UNION)
+/* GCC vector types are structs with one array member */
+#define IS_VECTOR(type) (((type)->t & VT_BTYPE) == VT_STRUCT && (type)->ref->a.vector)
+#define VECTOR_ELEM(ty) (&(ty)->ref->next->type.ref->type)
 
 #define VT_ATOMIC   VT_VOLATILE
 
@@ -1360,6 +1465,8 @@ struct filespec {
 #define TOK_SHL     '<' /* shift left */
 #define TOK_SAR     '>' /* signed shift right */
 #define TOK_SHR     0x8b /* unsigned shift right */
+#define TOK_UMULH   0x8c /* high part of unsigned 64x64 mul */
+#define TOK_SMULH   0x8d /* high part of signed 64x64 mul */
 #define TOK_NEG     TOK_MID /* unary minus operation (for floats) */
 
 #define TOK_ARROW   0xa0 /* -> */
@@ -1369,6 +1476,7 @@ struct filespec {
 #define TOK_PLCHLDR 0xa4 /* placeholder token as defined in C99 */
 #define TOK_NOSUBST 0xa5 /* means following token has already been pp'd */
 #define TOK_PPJOIN  0xa6 /* A '##' in the right position to mean pasting */
+#define TOK_PACK    0xa7 /* struct layout state follows (saved token strings) */
 
 /* assignment operators */
 #define TOK_A_ADD   0xb0
@@ -1659,7 +1767,7 @@ ST_FUNC void vrote(TCCState *S, SValue *e, int n);
 ST_FUNC void vrott(TCCState *S, int n);
 ST_FUNC void vrotb(TCCState *S, int n);
 ST_FUNC void vpop(TCCState *S);
-#if PTR_SIZE == 4
+#if PTR_SIZE == 4 || defined CONFIG_TCC_INT128
 ST_FUNC void lexpand(TCCState *S);
 #endif
 #ifdef TCC_TARGET_ARM
@@ -1669,6 +1777,9 @@ ST_FUNC void save_reg(TCCState *S, int r);
 ST_FUNC void save_reg_upstack(TCCState *S, int r, int n);
 ST_FUNC int get_reg(TCCState *S, int rc);
 ST_FUNC void save_regs(TCCState *S, int n);
+#ifdef STRUCT_INLINE_MAX
+ST_FUNC void save_regs_keep(TCCState *S, int n);
+#endif
 ST_FUNC void gaddrof(TCCState *S);
 ST_FUNC int gv(TCCState *S, int rc);
 ST_FUNC void gv2(TCCState *S, int rc1, int rc2);
@@ -1688,6 +1799,7 @@ ST_FUNC Sym *get_sym_ref(TCCState *S, CType *type, Section *sec, unsigned long o
 #endif
 #if defined TCC_TARGET_X86_64 && !defined TCC_TARGET_PE
 ST_FUNC int classify_x86_64_va_arg(CType *ty);
+ST_FUNC void gen_va_arg(TCCState *S, CType *t);
 #endif
 #ifdef CONFIG_TCC_BCHECK
 ST_FUNC void gbound_args(TCCState *S, int nb_args);
@@ -1722,6 +1834,7 @@ ST_FUNC void section_realloc(TCCState *S, Section *sec, unsigned long new_size);
 ST_FUNC size_t section_add(TCCState *S, Section *sec, addr_t size, int align);
 ST_FUNC void *section_ptr_add(TCCState *S, Section *sec, addr_t size);
 ST_FUNC Section *find_section(TCCState *S, const char *name);
+ST_FUNC Section *find_section_create(TCCState *S, const char *name, int create);
 ST_FUNC Section *new_symtab(TCCState *S, const char *symtab_name, int sh_type, int sh_flags, const char *strtab_name, const char *hash_name, int hash_sh_flags);
 
 ST_FUNC int put_elf_str(TCCState *S, Section *s, const char *sym);
@@ -1775,9 +1888,11 @@ ST_FUNC void tcc_add_runtime(TCCState *S);
    that unknown relocation don't create a GOT or PLT entry */
 enum gotplt_entry {
     NO_GOTPLT_ENTRY,	/* never generate (eg. GLOB_DAT & JMP_SLOT relocs) */
-    BUILD_GOT_ONLY,	/* only build GOT (eg. TPOFF relocs) */
+    BUILD_GOT_ONLY,	/* only build GOT (eg. GOTOFF relocs) */
     AUTO_GOTPLT_ENTRY,	/* generate if sym is UNDEF */
-    ALWAYS_GOTPLT_ENTRY	/* always generate (eg. PLTOFF relocs) */
+    ALWAYS_GOTPLT_ENTRY,	/* always generate (eg. PLTOFF relocs) */
+    TLS_GOT_ENTRY	/* GOT entry with the TP offset (initial-exec TLS)
+			   unless relaxed to local-exec in executables */
 };
 
 #if !defined(ELF_OBJ_ONLY) || defined(TCC_TARGET_MACHO)
@@ -1793,6 +1908,9 @@ ST_FUNC void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr,
 /* ------------ xxx-gen.c ------------ */
 ST_DATA const char * const target_machine_defs;
 ST_DATA const int reg_classes[NB_REGS];
+#ifdef CONFIG_TCC_REGVARS
+ST_DATA const int regvar_regs[NB_REGVARS];
+#endif
 
 ST_FUNC void gsym_addr(TCCState *S, int t, int a);
 ST_FUNC void gsym(TCCState *S, int t);
@@ -1803,6 +1921,9 @@ ST_FUNC void gfunc_call(TCCState *S, int nb_args);
 ST_FUNC void gfunc_prolog(TCCState *S, Sym *func_sym);
 ST_FUNC void gfunc_epilog(TCCState *S);
 ST_FUNC void gen_fill_nops(TCCState *S, int);
+#ifdef CONFIG_TCC_ALIGN_CODE
+ST_FUNC void gen_align_code(TCCState *S, int align);
+#endif
 ST_FUNC int gjmp(TCCState *S, int t);
 ST_FUNC void gjmp_addr(TCCState *S, int a);
 ST_FUNC int gjmp_cond(TCCState *S, int op, int t);
@@ -1819,6 +1940,15 @@ ST_FUNC void o(TCCState *S, unsigned int c);
 ST_FUNC void gen_vla_sp_save(TCCState *S, int addr);
 ST_FUNC void gen_vla_sp_restore(TCCState *S, int addr);
 ST_FUNC void gen_vla_alloc(TCCState *S, CType *type, int align);
+#ifdef CONFIG_TCC_JMPTABLE
+ST_FUNC void gen_jmptable(TCCState *S, Sym *table);
+#endif
+#ifdef CONFIG_TCC_TLS
+ST_FUNC void gen_tls_addr(TCCState *S);
+#endif
+#ifdef CONFIG_TCC_SELECT
+ST_FUNC void gen_select(TCCState *S, SValue *cond);
+#endif
 
 static inline uint16_t read16le(unsigned char *p) {
     return p[0] | (uint16_t)p[1] << 8;
@@ -1856,6 +1986,7 @@ ST_FUNC void gen_addr32(TCCState *S, int r, Sym *sym, int c);
 ST_FUNC void gen_addrpc32(TCCState *S, int r, Sym *sym, int c);
 ST_FUNC void gen_cvt_csti(TCCState *S, int t);
 ST_FUNC void gen_increment_tcov (TCCState *S, SValue *sv);
+ST_FUNC void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c);
 #endif
 
 /* ------------ x86_64-gen.c ------------ */
@@ -1867,6 +1998,12 @@ ST_FUNC void gen_vla_result(TCCState *S, int addr);
 #endif
 ST_FUNC void gen_cvt_sxtw(TCCState *S);
 ST_FUNC void gen_cvt_csti(TCCState *S, int t);
+ST_FUNC void gen_struct_copy(TCCState *S, int size);
+ST_FUNC void gen_struct_clear(TCCState *S, int size);
+ST_FUNC int gen_opv(TCCState *S, int op, SValue *a, SValue *b, int d);
+ST_FUNC int gen_bitop(TCCState *S, int op);
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo);
+ST_FUNC void arch_transfer_ret_regs(TCCState *S, int);
 #endif
 
 /* ------------ arm-gen.c ------------ */
@@ -1888,6 +2025,11 @@ ST_FUNC void gen_clear_cache(TCCState *S);
 ST_FUNC void gen_cvt_sxtw(TCCState *S);
 ST_FUNC void gen_cvt_csti(TCCState *S, int t);
 ST_FUNC void gen_increment_tcov (TCCState *S, SValue *sv);
+ST_FUNC void gen_struct_copy(TCCState *S, int size);
+ST_FUNC void gen_struct_clear(TCCState *S, int size);
+ST_FUNC int gen_opv(TCCState *S, int op, SValue *a, SValue *b, int d);
+ST_FUNC int gen_bitop(TCCState *S, int op);
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo);
 #endif
 
 /* ------------ riscv64-gen.c ------------ */
@@ -1898,6 +2040,8 @@ ST_FUNC void gen_va_start(TCCState *S);
 ST_FUNC void arch_transfer_ret_regs(TCCState *S, int);
 ST_FUNC void gen_cvt_sxtw(TCCState *S);
 ST_FUNC void gen_increment_tcov (TCCState *S, SValue *sv);
+ST_FUNC int gen_bitop(TCCState *S, int op);
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo);
 #endif
 
 /* ------------ c67-gen.c ------------ */
@@ -1925,6 +2069,10 @@ ST_FUNC void gen_expr32(TCCState *S, ExprValue *pe);
 #ifdef TCC_TARGET_X86_64
 ST_FUNC void gen_expr64(TCCState *S, ExprValue *pe);
 #endif
+#if defined TCC_TARGET_I386 || defined TCC_TARGET_X86_64
+ST_FUNC void gen_sse_opf(TCCState *S, int op, int fr, int fc);
+ST_FUNC int gen_sse_unordered(int cmp, int op);
+#endif
 ST_FUNC void asm_opcode(TCCState *S, int opcode);
 ST_FUNC int asm_parse_regvar(TCCState *S, int t);
 ST_FUNC void asm_compute_constraints(TCCState *S, ASMOperand *operands, int nb_operands, int nb_outputs, const uint8_t *clobber_regs, int *pout_reg);
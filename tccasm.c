@@ -1242,6 +1242,9 @@ ST_FUNC void asm_instr(TCCState *S)
     sec = cur_text_section;
     /* assemble the string with tcc internal assembler */
     tcc_assemble_inline(S, astr1.data, astr1.size - 1, 0);
+    /* the asm may define labels at its end */
+    S->tccgen_label_ind = S->ind;
+    S->tccasm_nb_inline++;
     if (sec != cur_text_section) {
         tcc_warning(S, "inline asm tries to change current section");
         use_section1(S, sec);
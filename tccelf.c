@@ -335,7 +335,7 @@ static void section_reserve(TCCState *S, Section *sec, unsigned long size)
 }
 #endif
 
-static Section *find_section_create (TCCState *S, const char *name, int create)
+ST_FUNC Section *find_section_create (TCCState *S, const char *name, int create)
 {
     Section *sec;
     int i;
@@ -1229,6 +1229,20 @@ redo:
                 continue;
             }
 
+#ifdef R_TPOFF
+            /* initial-exec TLS: thread-local variables of the executable
+               are accessed without GOT, see relocate() */
+            if (gotplt_entry == TLS_GOT_ENTRY) {
+                if (pass != 1 || (S->output_type == TCC_OUTPUT_EXE
+                                  && sym->st_shndx != SHN_UNDEF))
+                    continue;
+                if (!S->got)
+                    build_got(S);
+                put_got_entry(S, R_TPOFF, sym_index);
+                continue;
+            }
+#endif
+
             /* Automatically create PLT/GOT [entry] if it is an undefined
 	       reference (resolved at runtime), or the symbol is absolute,
 	       probably created by tcc_add_symbol, and thus on 64-bit
@@ -1697,6 +1711,14 @@ static void fill_local_got_entries(TCCState *S)
 	    unsigned offset = attr->got_offset;
 	    if (offset != rel->r_offset - S->got->sh_addr)
 	      tcc_error_noabort(S, "huh");
+#ifdef R_TPOFF
+            if (ELFW(ST_TYPE)(sym->st_info) == STT_TLS) {
+                /* initial-exec reference to a local thread-local variable */
+                rel->r_info = ELFW(R_INFO)(0, R_TPOFF);
+                rel->r_addend = sym->st_value - S->tls_addr;
+                continue;
+            }
+#endif
 	    rel->r_info = ELFW(R_INFO)(0, R_RELATIVE);
 #if SHT_RELX == SHT_RELA
 	    rel->r_addend = sym->st_value;
@@ -1742,6 +1764,12 @@ static void bind_exe_dynsyms(TCCState *S)
 				    name);
 		    int index = sym - (ElfW(Sym) *) symtab_section->data;
 		    get_sym_attr(S, index, 1)->dyn_index = dynindex;
+                } else if (type == STT_TLS) {
+                    /* accessed through the GOT, see build_got_entries() */
+                    index = sym - (ElfW(Sym) *) symtab_section->data;
+                    get_sym_attr(S, index, 1)->dyn_index =
+                        put_elf_sym(S, S->dynsym, 0, esym->st_size,
+                                    esym->st_info, 0, SHN_UNDEF, name);
                 } else if (type == STT_OBJECT) {
                     unsigned long offset;
                     ElfW(Sym) *dynsym;
@@ -1840,6 +1868,360 @@ static void export_global_syms(TCCState *S)
     }
 }
 
+/* forget the contents of a section so that it is not output */
+static void drop_section(Section *s)
+{
+    s->data_offset = 0;
+    s->sh_flags &= ~SHF_ALLOC;
+    if (s->reloc)
+        s->reloc->data_offset = 0;
+}
+
+/* sections which are kept with --gc-sections even if nothing refers
+   to them */
+static int gc_root_section(TCCState *S, Section *s)
+{
+    const char *p;
+
+    if (s == text_section || s == S->got || s == S->plt
+        || s->sh_type == SHT_INIT_ARRAY || s->sh_type == SHT_FINI_ARRAY
+        || s->sh_type == SHT_PREINIT_ARRAY
+        || !strcmp(s->name, ".init") || !strcmp(s->name, ".fini")
+        || !strcmp(s->name, ".interp")
+        || !strcmp(s->name, ".ctors") || !strcmp(s->name, ".dtors")
+        || !strcmp(s->name, ".eh_frame"))
+        return 1;
+    /* may be found through __start_ and __stop_ symbols */
+    for (p = s->name; isid(*p) || isnum(*p); p++)
+        ;
+    return !*p;
+}
+
+/* --gc-sections: drop the code and data sections which are not reachable
+   through relocations from the entry point, the init and fini arrays
+   and the exported symbols */
+static void gc_sections(TCCState *S)
+{
+    unsigned char *live;
+    int *stack, sp, i, shndx;
+    Section *s, *sr;
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+    const char *name;
+
+    live = tcc_mallocz(S, S->nb_sections);
+    stack = tcc_malloc(S, S->nb_sections * sizeof *stack);
+    sp = 0;
+#define GC_MARK(i) \
+    if (!live[i]) live[i] = 1, stack[sp++] = i
+
+    for (i = 1; i < S->nb_sections; i++) {
+        s = S->sections[i];
+        if (!(s->sh_flags & SHF_ALLOC))
+            live[i] = 1; /* debug info etc: keep, but don't follow */
+        else if ((s->sh_type != SHT_PROGBITS && s->sh_type != SHT_NOBITS)
+                 || gc_root_section(S, s))
+            GC_MARK(i);
+    }
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        shndx = sym->st_shndx;
+        if (shndx == SHN_UNDEF || shndx >= SHN_LORESERVE
+            || ELFW(ST_BIND)(sym->st_info) == STB_LOCAL)
+            continue;
+        name = (char *) symtab_section->link->data + sym->st_name;
+        if (S->output_type == TCC_OUTPUT_DLL || S->rdynamic
+            || !strcmp(name, "_start"))
+            GC_MARK(shndx);
+    }
+    if (S->dynsym) {
+        for_each_elem(S->dynsym, 1, sym, ElfW(Sym)) {
+            shndx = sym->st_shndx;
+            if (shndx != SHN_UNDEF && shndx < SHN_LORESERVE)
+                GC_MARK(shndx);
+        }
+    }
+
+    while (sp) {
+        s = S->sections[stack[--sp]];
+        sr = s->reloc;
+        if (!sr || !strcmp(s->name, ".eh_frame"))
+            continue;
+        for_each_elem(sr, 0, rel, ElfW_Rel) {
+            sym = &((ElfW(Sym) *)symtab_section->data)[ELFW(R_SYM)(rel->r_info)];
+            shndx = sym->st_shndx;
+            if (shndx != SHN_UNDEF && shndx < SHN_LORESERVE)
+                GC_MARK(shndx);
+        }
+    }
+#undef GC_MARK
+
+    for (i = 1; i < S->nb_sections; i++) {
+        s = S->sections[i];
+        if (live[i])
+            continue;
+        if (S->verbose >= 2)
+            printf("removing unused section '%s'\n", s->name);
+        drop_section(s);
+    }
+    /* their symbols are not output, references from debug info
+       resolve to 0 */
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        shndx = sym->st_shndx;
+        if (shndx != SHN_UNDEF && shndx < SHN_LORESERVE && !live[shndx]) {
+            sym->st_name = 0;
+            sym->st_value = 0;
+            sym->st_shndx = SHN_ABS;
+        }
+    }
+    tcc_free(S, stack);
+    tcc_free(S, live);
+}
+
+/* append the sections .text.foo, .data.foo, .data.ro.foo and .bss.foo
+   (-ffunction-sections, -fdata-sections or from object files) to
+   .text, .data, .data.ro and .bss, as ld does for executables and
+   shared libraries, instead of giving each its own section header */
+static void merge_sym_sections(TCCState *S)
+{
+    Section *base[4], *s, *b;
+    int i, j, len;
+    addr_t offset;
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+
+    base[0] = text_section, base[1] = data_section;
+    base[2] = rodata_section, base[3] = bss_section;
+    for (i = 1; i < S->nb_sections; i++) {
+        s = S->sections[i];
+        if (!(s->sh_flags & SHF_ALLOC))
+            continue;
+        for (b = NULL, j = 0; j < 4; j++) {
+            if (s == base[j])
+                break;
+            len = strlen(base[j]->name);
+            if (!strncmp(s->name, base[j]->name, len) && s->name[len] == '.'
+                && s->sh_type == base[j]->sh_type
+                && s->sh_flags == base[j]->sh_flags
+                && (!b || len > strlen(b->name)))
+                b = base[j];
+        }
+        if (j < 4 || !b)
+            continue;
+        offset = section_add(S, b, s->data_offset, s->sh_addralign);
+        if (s->sh_type != SHT_NOBITS)
+            memcpy(b->data + offset, s->data, s->data_offset);
+        if (s->reloc) {
+            for_each_elem(s->reloc, 0, rel, ElfW_Rel)
+                put_elf_reloca(symtab_section, b, rel->r_offset + offset,
+                               ELFW(R_TYPE)(rel->r_info),
+                               ELFW(R_SYM)(rel->r_info),
+#if SHT_RELX == SHT_RELA
+                               rel->r_addend
+#else
+                               0
+#endif
+                               );
+        }
+        for_each_elem(symtab_section, 1, sym, ElfW(Sym))
+            if (sym->st_shndx == i)
+                sym->st_shndx = b->sh_num, sym->st_value += offset;
+        if (S->dynsym) {
+            for_each_elem(S->dynsym, 1, sym, ElfW(Sym))
+                if (sym->st_shndx == i)
+                    sym->st_shndx = b->sh_num, sym->st_value += offset;
+        }
+        if (S->verbose >= 2)
+            printf("merging section '%s' into '%s'\n", s->name, b->name);
+        drop_section(s);
+    }
+}
+
+static int icf_candidate(Section *s)
+{
+    return s->sh_type == SHT_PROGBITS
+        && (s->sh_flags & (SHF_ALLOC | SHF_EXECINSTR))
+            == (SHF_ALLOC | SHF_EXECINSTR)
+        && s->data_offset
+        && !strncmp(s->name, ".text.", 6);
+}
+
+/* hash the contents of a section and the targets of its relocations */
+static unsigned icf_hash(TCCState *S, Section *s)
+{
+    unsigned h = s->data_offset;
+    unsigned char *p;
+    ElfW_Rel *rel;
+    ElfW(Sym) *sym;
+
+    for (p = s->data; p < s->data + s->data_offset; p++)
+        h = h * 31 + *p;
+    if (s->reloc) {
+        for_each_elem(s->reloc, 0, rel, ElfW_Rel) {
+            sym = &((ElfW(Sym) *)symtab_section->data)[ELFW(R_SYM)(rel->r_info)];
+            h = h * 31 + rel->r_offset;
+            h = h * 31 + ELFW(R_TYPE)(rel->r_info);
+#if SHT_RELX == SHT_RELA
+            h = h * 31 + rel->r_addend;
+#endif
+            if (sym->st_shndx != s->sh_num)
+                h = h * 31 + sym->st_shndx;
+            h = h * 31 + sym->st_value;
+        }
+    }
+    return h;
+}
+
+/* relocations of a and b point to the same place, or to the same
+   offset in the section itself */
+static int icf_same_target(Section *a, ElfW(Sym) *sa, Section *b, ElfW(Sym) *sb)
+{
+    if (sa == sb)
+        return 1;
+    if (sa->st_value != sb->st_value)
+        return 0;
+    if (sa->st_shndx == a->sh_num)
+        return sb->st_shndx == b->sh_num;
+    return sa->st_shndx == sb->st_shndx
+        && sa->st_shndx != SHN_UNDEF && sa->st_shndx != SHN_COMMON;
+}
+
+static int icf_equal(TCCState *S, Section *a, Section *b)
+{
+    ElfW_Rel *ra, *rb, *end;
+    ElfW(Sym) *syms = (ElfW(Sym) *)symtab_section->data;
+    addr_t na = a->reloc ? a->reloc->data_offset : 0;
+    addr_t nb = b->reloc ? b->reloc->data_offset : 0;
+
+    if (a->data_offset != b->data_offset
+        || a->sh_flags != b->sh_flags
+        || a->sh_addralign != b->sh_addralign
+        || na != nb
+        || memcmp(a->data, b->data, a->data_offset))
+        return 0;
+    if (!na)
+        return 1;
+    ra = (ElfW_Rel *)a->reloc->data;
+    rb = (ElfW_Rel *)b->reloc->data;
+    end = (ElfW_Rel *)(a->reloc->data + na);
+    for (; ra < end; ra++, rb++) {
+        if (ra->r_offset != rb->r_offset
+            || ELFW(R_TYPE)(ra->r_info) != ELFW(R_TYPE)(rb->r_info)
+#if SHT_RELX == SHT_RELA
+            || ra->r_addend != rb->r_addend
+#endif
+            || !icf_same_target(a, &syms[ELFW(R_SYM)(ra->r_info)],
+                                b, &syms[ELFW(R_SYM)(rb->r_info)]))
+            return 0;
+    }
+    return 1;
+}
+
+/* relocations which call or jump to a function without taking its
+   address */
+static int icf_call_reloc(int type)
+{
+#if defined TCC_TARGET_X86_64
+    return type == R_X86_64_PLT32;
+#elif defined TCC_TARGET_I386
+    return type == R_386_PC32 || type == R_386_PLT32;
+#elif defined TCC_TARGET_ARM64
+    return type == R_AARCH64_CALL26 || type == R_AARCH64_JUMP26;
+#elif defined TCC_TARGET_ARM
+    return type == R_ARM_PC24 || type == R_ARM_CALL
+        || type == R_ARM_JUMP24 || type == R_ARM_PLT32;
+#elif defined TCC_TARGET_RISCV64
+    return type == R_RISCV_CALL || type == R_RISCV_CALL_PLT;
+#else
+    return 0;
+#endif
+}
+
+/* mark the sections whose address can be seen: those with global
+   symbols, and those referred to by allocated code or data other than
+   through a call */
+static unsigned char *icf_keep_address(TCCState *S)
+{
+    unsigned char *keep = tcc_mallocz(S, S->nb_sections);
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+    Section *sr;
+    int i;
+
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym))
+        if (sym->st_shndx < S->nb_sections
+            && ELFW(ST_BIND)(sym->st_info) != STB_LOCAL)
+            keep[sym->st_shndx] = 1;
+    for (i = 1; i < S->nb_sections; i++) {
+        sr = S->sections[i];
+        if (sr->sh_type != SHT_RELX
+            || !(S->sections[sr->sh_info]->sh_flags & SHF_ALLOC))
+            continue;
+        for_each_elem(sr, 0, rel, ElfW_Rel) {
+            sym = &((ElfW(Sym) *)symtab_section->data)[ELFW(R_SYM)(rel->r_info)];
+            if (sym->st_shndx < S->nb_sections
+                && !icf_call_reloc(ELFW(R_TYPE)(rel->r_info)))
+                keep[sym->st_shndx] = 1;
+        }
+    }
+    return keep;
+}
+
+/* --icf: fold function sections with the same code and the same
+   relocations into one.  Symbols of the folded section are moved to
+   the survivor.  Distinct functions must have distinct addresses in C,
+   so only functions which are called but never seen otherwise are
+   folded away, into any identical one.  Callers of folded functions
+   become identical themselves then, so repeat until nothing changes. */
+static void icf_sections(TCCState *S)
+{
+    int *bucket, *next, nb_buckets, i, j, folded, pass;
+    unsigned *hash;
+    unsigned char *keep;
+    Section *s;
+    ElfW(Sym) *sym;
+
+    nb_buckets = 1;
+    while (nb_buckets < S->nb_sections)
+        nb_buckets *= 2;
+    bucket = tcc_malloc(S, nb_buckets * sizeof *bucket);
+    next = tcc_malloc(S, S->nb_sections * sizeof *next);
+    hash = tcc_malloc(S, S->nb_sections * sizeof *hash);
+    keep = icf_keep_address(S);
+    do {
+        folded = 0;
+        memset(bucket, 0, nb_buckets * sizeof *bucket);
+        /* the sections which keep their address go first, so that
+           the others can be folded into them */
+        for (pass = 1; pass >= 0; pass--)
+        for (i = 1; i < S->nb_sections; i++) {
+            s = S->sections[i];
+            if (keep[i] != pass || !icf_candidate(s))
+                continue;
+            hash[i] = icf_hash(S, s);
+            for (j = bucket[hash[i] & (nb_buckets - 1)]; j; j = next[j])
+                if (hash[j] == hash[i] && icf_equal(S, S->sections[j], s))
+                    break;
+            if (!j || keep[i]) {
+                next[i] = bucket[hash[i] & (nb_buckets - 1)];
+                bucket[hash[i] & (nb_buckets - 1)] = i;
+                continue;
+            }
+            if (S->verbose >= 2)
+                printf("folding section '%s' into '%s'\n",
+                       s->name, S->sections[j]->name);
+            for_each_elem(symtab_section, 1, sym, ElfW(Sym))
+                if (sym->st_shndx == i)
+                    sym->st_shndx = j;
+            drop_section(s);
+            folded = 1;
+        }
+    } while (folded);
+    tcc_free(S, keep);
+    tcc_free(S, hash);
+    tcc_free(S, next);
+    tcc_free(S, bucket);
+}
+
 /* decide if an unallocated section should be output. */
 static int set_sec_sizes(TCCState *S)
 {
@@ -1930,6 +2312,7 @@ static int layout_sections(TCCState *S, ElfW(Phdr) *phdr,
         addr_t addr;
         ElfW(Phdr) *ph;
         int j, k, f, file_type = S->output_type;
+        int tls_offset = 0, tls_filesz = 0;
 
         s_align = ELF_PAGE_SIZE;
         if (S->section_align)
@@ -1964,21 +2347,41 @@ static int layout_sections(TCCState *S, ElfW(Phdr) *phdr,
         /* read only segment mapping for GNU_RELRO */
 	roinf->sh_offset = roinf->sh_addr = roinf->sh_size = 0;
 
+        /* the TLS sections are put together at the end of the RW
+           segment, the TLS block starts at their largest alignment */
+        S->tls_addr = S->tls_size = 0, S->tls_align = 1;
+        for(i = 1; i < S->nb_sections; i++) {
+            s = S->sections[i];
+            if ((s->sh_flags & SHF_TLS) && S->tls_align < s->sh_addralign)
+                S->tls_align = s->sh_addralign;
+        }
+
         for(j = 0; j < phfill; j++) {
-            ph->p_type = j == 2 ? PT_TLS : PT_LOAD;
+            if (j == 2) {
+                ph->p_type = PT_TLS;
+                ph->p_flags = PF_R;
+                ph->p_align = S->tls_align;
+                ph->p_offset = tls_offset;
+                ph->p_vaddr = ph->p_paddr = S->tls_addr;
+                ph->p_filesz = tls_filesz;
+                ph->p_memsz = S->tls_size;
+                ph++;
+                continue;
+            }
+            ph->p_type = PT_LOAD;
             if (j == 0)
                 ph->p_flags = PF_R | PF_X;
             else
                 ph->p_flags = PF_R | PF_W;
-            ph->p_align = j == 2 ? 4 : s_align;
+            ph->p_align = s_align;
 
             /* Decide the layout of sections loaded in memory. This must
                be done before program headers are filled since they contain
                info about the layout. We do the following ordering: interp,
-               symbol tables, relocations, progbits, nobits */
+               symbol tables, relocations, progbits, tls, nobits */
             /* XXX: do faster and simpler sorting */
 	    f = -1;
-            for(k = 0; k < 7; k++) {
+            for(k = 0; k < 9; k++) {
                 for(i = 1; i < S->nb_sections; i++) {
                     s = S->sections[i];
                     /* compute if section should be included */
@@ -1986,14 +2389,10 @@ static int layout_sections(TCCState *S, ElfW(Phdr) *phdr,
                         if ((s->sh_flags & (SHF_ALLOC | SHF_WRITE | SHF_TLS)) !=
                             SHF_ALLOC)
                             continue;
-                    } else if (j == 1) {
-                        if ((s->sh_flags & (SHF_ALLOC | SHF_WRITE | SHF_TLS)) !=
+                    } else {
+                        if ((s->sh_flags & (SHF_ALLOC | SHF_WRITE)) !=
                             (SHF_ALLOC | SHF_WRITE))
                             continue;
-                    } else  {
-                        if ((s->sh_flags & (SHF_ALLOC | SHF_WRITE | SHF_TLS)) !=
-                            (SHF_ALLOC | SHF_WRITE | SHF_TLS))
-                            continue;
                     }
                     if (s == interp) {
                         if (k != 0)
@@ -2012,10 +2411,14 @@ static int layout_sections(TCCState *S, ElfW(Phdr) *phdr,
                             if (k != 2)
                                 continue;
                         }
+                    } else if (s->sh_flags & SHF_TLS) {
+                        if (k != 6 + (s->sh_type == SHT_NOBITS))
+                            continue;
                     } else if (s->sh_type == SHT_NOBITS) {
-                        if (k != 6)
+                        if (k != 8)
                             continue;
                     } else if ((s == rodata_section
+                                || !strncmp(s->name, ".data.ro.", 9)
 #ifdef CONFIG_TCC_BCHECK
 		                || s == bounds_section
                                 || s == lbounds_section
@@ -2038,10 +2441,20 @@ static int layout_sections(TCCState *S, ElfW(Phdr) *phdr,
 			s->sh_addralign = PAGESIZE;
                     addr = (addr + s->sh_addralign - 1) &
                         ~(s->sh_addralign - 1);
+                    if ((s->sh_flags & SHF_TLS) && !S->tls_addr)
+                        addr = (addr + S->tls_align - 1) & -S->tls_align;
                     file_offset += (int) ( addr - tmp );
                     s->sh_offset = file_offset;
                     s->sh_addr = addr;
 
+                    if (s->sh_flags & SHF_TLS) {
+                        if (!S->tls_addr)
+                            S->tls_addr = addr, tls_offset = file_offset;
+                        S->tls_size = addr + s->sh_size - S->tls_addr;
+                        if (s->sh_type != SHT_NOBITS)
+                            tls_filesz = file_offset + s->sh_size - tls_offset;
+                    }
+
                     /* update program header infos */
                     if (ph->p_offset == 0) {
                         ph->p_offset = file_offset;
@@ -2590,6 +3003,8 @@ static int elf_output_file(TCCState *S, const char *filename)
         /* if linking, also link in runtime libraries (libc, libgcc, etc.) */
         tcc_add_runtime(S);
 	resolve_common_syms(S);
+        if (S->icf)
+            icf_sections(S);
 
         if (!S->static_link) {
             if (file_type == TCC_OUTPUT_EXE) {
@@ -2630,6 +3045,9 @@ static int elf_output_file(TCCState *S, const char *filename)
                 export_global_syms(S);
             }
         }
+        if (S->gc_sections)
+            gc_sections(S);
+        merge_sym_sections(S);
         build_got_entries(S);
 	version_add (S);
     }
@@ -2677,7 +3095,7 @@ static int elf_output_file(TCCState *S, const char *filename)
 
     /* compute number of program headers */
     if (file_type == TCC_OUTPUT_DLL)
-        phnum = 3;
+        phnum = 3 + (i < S->nb_sections);
     else if (S->static_link)
         phnum = 3;
     else {
@@ -2719,6 +3137,9 @@ static int elf_output_file(TCCState *S, const char *filename)
                 if (sym->st_shndx != SHN_UNDEF && sym->st_shndx < SHN_LORESERVE) {
                     /* do symbol relocation */
                     sym->st_value += S->sections[sym->st_shndx]->sh_addr;
+                    /* thread-local symbols are offsets in the TLS block */
+                    if (ELFW(ST_TYPE)(sym->st_info) == STT_TLS)
+                        sym->st_value -= S->tls_addr;
                 }
             }
         }
@@ -42,13 +42,64 @@
 
 static void tcc_tcov_block_begin(TCCState *S);
 
+/* Patch the jump over the unlikely statements of cold_flush() to the
+   code that was placed after them */
+static void cold_over(TCCState *S)
+{
+    if (S->tccgen_cold_over) {
+        gsym_addr(S, S->tccgen_cold_over, S->tccgen_cold_over_ind);
+        S->tccgen_cold_over = 0;
+    }
+}
+
+/* true when the code here is only reached by that jump */
+static int cold_over_here(TCCState *S)
+{
+    return S->tccgen_cold_over && S->tccgen_cold_over_ind == S->ind
+        && !S->nocode_wanted;
+}
+
 /* Clear 'nocode_wanted' at label if it was used */
-ST_FUNC void gsym(TCCState *S, int t) { if (t) { gsym_addr(S, t, S->ind); CODE_ON(); }}
-static int gind(TCCState *S) { int t = S->ind; CODE_ON(); if (S->tccgen_debug_modes) tcc_tcov_block_begin(S); return t; }
+ST_FUNC void gsym(TCCState *S, int t) { if (t) { cold_over(S); gsym_addr(S, t, S->ind); CODE_ON(); }}
+static int gind(TCCState *S) { int t; cold_over(S); t = S->tccgen_label_ind = S->ind; CODE_ON(); if (S->tccgen_debug_modes) tcc_tcov_block_begin(S); return t; }
+
+/* label at the head of a loop, padded with nops for -falign-loops */
+static int gind_loop(TCCState *S)
+{
+    int a = S->align_loops;
+    if (a > 1 && !S->nocode_wanted) {
+        if (cur_text_section->sh_addralign < a)
+            cur_text_section->sh_addralign = a;
+#ifdef CONFIG_TCC_ALIGN_CODE
+        gen_align_code(S, a);
+#else
+        gen_fill_nops(S, -S->ind & (a - 1));
+#endif
+    }
+    return gind(S);
+}
+
+/* Set 'nocode_wanted' after unconditional jumps.  A jump which would
+   only be reached by the jump of cold_flush() is not emitted, that one
+   goes straight to the target instead. */
+static void gjmp_addr_acs(TCCState *S, int t)
+{
+    if (cold_over_here(S))
+        gsym_addr(S, S->tccgen_cold_over, t), S->tccgen_cold_over = 0;
+    else
+        cold_over(S), gjmp_addr(S, t);
+    CODE_OFF();
+}
 
-/* Set 'nocode_wanted' after unconditional jumps */
-static void gjmp_addr_acs(TCCState *S, int t) { gjmp_addr(S, t); CODE_OFF(); }
-static int gjmp_acs(TCCState *S, int t) { t = gjmp(S, t); CODE_OFF(); return t; }
+static int gjmp_acs(TCCState *S, int t)
+{
+    if (cold_over_here(S))
+        t = gjmp_append(S, S->tccgen_cold_over, t), S->tccgen_cold_over = 0;
+    else
+        cold_over(S), t = gjmp(S, t);
+    CODE_OFF();
+    return t;
+}
 
 /* These are #undef'd at the end of this file */
 #define gjmp_addr gjmp_addr_acs
@@ -143,12 +194,14 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
 static void decl(TCCState *S, int l);
 static int decl0(TCCState *S, int l, int is_for_loop_init, Sym *);
 static void expr_eq(TCCState *S);
+static void expr_cond(TCCState *S);
 static void vla_runtime_type_size(TCCState *S, CType *type, int *a);
 static int is_compatible_unqualified_types(CType *type1, CType *type2);
 static inline int64_t expr_const64(TCCState *S);
 static void vpush64(TCCState *S, int ty, unsigned long long v);
 static void vpush(TCCState *S, CType *type);
 static int gvtst(TCCState *S, int inv, int t);
+static int condition_3way(TCCState *S);
 static void gen_inline_functions(TCCState *S);
 static void free_inline_functions(TCCState *S);
 static void skip_or_save_block(TCCState *S, TokenString **str);
@@ -156,6 +209,12 @@ static void gv_dup(TCCState *S);
 static int get_temp_local_var(TCCState *S, int size,int align);
 static void clear_temp_local_var_list();
 static void cast_error(TCCState *S, CType *st, CType *dt);
+static void field_index_free(TCCState *S, Sym *type);
+static void gen_function(TCCState *S, Sym *sym);
+static int inline_call(TCCState *S, Sym *s);
+#ifdef CONFIG_TCC_TAILCALL
+static int tail_call_ok(TCCState *S, CType *ret);
+#endif
 
 ST_INLN int is_float(int t)
 {
@@ -181,6 +240,9 @@ static int btype_size(int bt)
         bt == VT_SHORT ? 2 :
         bt == VT_INT ? 4 :
         bt == VT_LLONG ? 8 :
+#ifdef CONFIG_TCC_INT128
+        bt == VT_QLONG ? 16 :
+#endif
         bt == VT_PTR ? PTR_SIZE : 0;
 }
 
@@ -214,6 +276,9 @@ static int R2_RET(int t)
 #elif defined TCC_TARGET_RISCV64
     if (t == VT_LDOUBLE)
         return REG_IRE2;
+#elif defined TCC_TARGET_ARM64
+    if (t == VT_QLONG)
+        return REG_IRE2;
 #endif
     return VT_CONST;
 }
@@ -234,7 +299,7 @@ static int RC_RET(int t)
 }
 
 /* returns generic register class for type t */
-static int RC_TYPE(int t)
+static int RC_TYPE(TCCState *S, int t)
 {
     if (!is_float(t))
         return RC_INT;
@@ -246,6 +311,9 @@ static int RC_TYPE(int t)
 #elif defined TCC_TARGET_RISCV64
     if ((t & VT_BTYPE) == VT_LDOUBLE)
         return RC_INT;
+#elif defined TCC_TARGET_I386
+    if ((t & VT_BTYPE) != VT_LDOUBLE && S->sse2)
+        return RC_XMM;
 #endif
     return RC_FLOAT;
 }
@@ -409,7 +477,7 @@ static void tcc_debug_line(TCCState *S)
 {
     BufferedFile *f;
     if (!S->do_debug
-        || cur_text_section != text_section
+        || (cur_text_section != text_section && S->tccgen_func_ind == -1)
         || !(f = put_new_file(S))
         || S->tccgen_last_line_num == f->line_num)
         return;
@@ -665,6 +733,10 @@ static void tcc_debug_funcend(TCCState *S, int size)
         return;
     tcc_debug_stabn(S, N_RBRAC, size);
     tcc_debug_finish (S, S->debug_info_root);
+    /* end of function, needed when it is not followed by the end of
+       the text section (-ffunction-sections) */
+    if (cur_text_section != text_section)
+        put_stabn(S, N_FUN, 0, 0, size);
 }
 
 
@@ -909,6 +981,31 @@ ST_FUNC void tccgen_finish(TCCState *S)
     free_inline_functions(S);
     sym_pop(S, &S->tccgen_global_stack, NULL, 0);
     sym_pop(S, &S->local_stack, NULL, 0);
+    tcc_free(S, S->tccgen_field_index);
+    S->tccgen_field_index = NULL;
+    S->tccgen_field_index_size = S->tccgen_nb_field_index = 0;
+    tcc_free(S, S->tccgen_vector_types);
+    S->tccgen_vector_types = NULL;
+    S->tccgen_nb_vector_types = 0;
+    S->tccgen_cold_over = 0;
+    while (S->tccgen_cold) { /* after errors */
+        cold_t *cb = S->tccgen_cold;
+        S->tccgen_cold = cb->prev;
+        tok_str_free(S, cb->str);
+        tcc_free(S, cb);
+    }
+    tcc_free(S, S->tccgen_regvar_cand);
+    S->tccgen_regvar_cand = NULL;
+    S->tccgen_regvar_cand_size = S->tccgen_nb_regvar_cand = 0;
+#ifdef TCC_TARGET_X86_64
+    tcc_free(S, S->x86_64_gen_relax);
+    tcc_free(S, S->x86_64_gen_relax_tab);
+    S->x86_64_gen_relax = NULL, S->x86_64_gen_relax_tab = NULL;
+    S->x86_64_gen_relax_size = S->x86_64_gen_nb_relax = S->x86_64_gen_nb_relax_tab = 0;
+    tcc_free(S, S->x86_64_gen_fp_ref);
+    S->x86_64_gen_fp_ref = NULL;
+    S->x86_64_gen_fp_ref_size = S->x86_64_gen_nb_fp_ref = 0;
+#endif
     /* free preprocessor macros */
     free_defines(S, NULL);
     /* free sym_pools */
@@ -990,7 +1087,7 @@ ST_FUNC void put_extern_sym2(TCCState *S, Sym *sym, int sh_num,
             if ((t & (VT_BTYPE|VT_ASM_FUNC)) == VT_ASM_FUNC)
                 sym_type = STT_FUNC;
         } else {
-            sym_type = STT_OBJECT;
+            sym_type = sym->a.tls ? STT_TLS : STT_OBJECT;
         }
         if (t & (VT_STATIC | VT_INLINE))
             sym_bind = STB_LOCAL;
@@ -1247,8 +1344,11 @@ ST_FUNC void sym_pop(TCCState *S, Sym **ptop, Sym *b, int keep)
                 ps = &ts->sym_identifier;
             *ps = s->prev_tok;
         }
-	if (!keep)
+	if (!keep) {
+            if ((v & SYM_STRUCT) && s->a.fieldidx)
+                field_index_free(S, s);
 	    sym_free(S, s);
+        }
         s = ss;
     }
     if (!keep)
@@ -1452,6 +1552,8 @@ static void gvtst_set(TCCState *S, int inv, int t)
     int *p;
 
     if (S->vtop->r != VT_CMP) {
+        if (IS_VECTOR(&S->vtop->type))
+            tcc_error(S, "used vector type where scalar is required");
         vpushi(S, 0);
         gen_op(S, TOK_NE);
         if (S->vtop->r != VT_CMP) /* must be VT_CONST then */
@@ -1499,11 +1601,26 @@ static void gen_test_zero(TCCState *S, int op)
             S->vtop->cmp_op ^= 1;
         }
     } else {
+        if (IS_VECTOR(&S->vtop->type))
+            tcc_error(S, "used vector type where scalar is required");
         vpushi(S, 0);
         gen_op(S, op);
     }
 }
 
+/* the __builtin_expect() hint for the value on top of the stack: 1 if
+   it is expected to be false, 2 if expected to be true, else 0 */
+static int vexpect(TCCState *S)
+{
+    int e = S->tccgen_expect;
+    return e >> 2 == S->vtop - vstack + 1 ? e & 3 : 0;
+}
+
+static void vset_expect(TCCState *S, int e)
+{
+    S->tccgen_expect = e ? (int)(S->vtop - vstack + 1) << 2 | e : 0;
+}
+
 /* ------------------------------------------------------------------------- */
 /* push a symbol value of TYPE */
 ST_FUNC void vpushsym(TCCState *S, CType *type, Sym *sym)
@@ -1582,6 +1699,7 @@ static void merge_symattr(struct SymAttr *sa, struct SymAttr *sa1)
     sa->dllexport |= sa1->dllexport;
     sa->nodecorate |= sa1->nodecorate;
     sa->dllimport |= sa1->dllimport;
+    sa->tls |= sa1->tls;
 }
 
 /* Merge function attributes.  */
@@ -1599,6 +1717,10 @@ static void merge_funcattr(struct FuncAttr *fa, struct FuncAttr *fa1)
       fa->func_ctor = 1;
     if (fa1->func_dtor)
       fa->func_dtor = 1;
+    if (fa1->func_cold)
+      fa->func_cold = 1;
+    if (fa1->func_hot)
+      fa->func_hot = 1;
 }
 
 /* Merge attributes.  */
@@ -1683,8 +1805,12 @@ static void patch_type(TCCState *S, Sym *sym, CType *type)
 /* Merge some storage attributes.  */
 static void patch_storage(TCCState *S, Sym *sym, AttributeDef *ad, CType *type)
 {
-    if (type)
+    if (type) {
         patch_type(S, sym, type);
+        if (sym->a.tls != ad->a.tls)
+            tcc_error(S, "thread-local and non thread-local declarations of '%s'",
+                get_tok_str(S, sym->v, NULL));
+    }
 
 #ifdef TCC_TARGET_PE
     if (sym->a.dllimport != ad->a.dllimport)
@@ -1761,6 +1887,22 @@ ST_FUNC void save_regs(TCCState *S, int n)
         save_reg(S, p->r);
 }
 
+#ifdef STRUCT_INLINE_MAX
+/* like save_regs(), but keep the registers also used by the top n
+   entries */
+ST_FUNC void save_regs_keep(TCCState *S, int n)
+{
+    SValue *p, *q;
+    for(p = vstack; p <= S->vtop - n; p++) {
+        for(q = S->vtop - n + 1; q <= S->vtop; q++)
+            if ((q->r & VT_VALMASK) == (p->r & VT_VALMASK))
+                break;
+        if (q > S->vtop)
+            save_reg(S, p->r);
+    }
+}
+#endif
+
 /* save r to the memory stack, and mark it as being free */
 ST_FUNC void save_reg(TCCState *S, int r)
 {
@@ -1791,6 +1933,8 @@ ST_FUNC void save_reg_upstack(TCCState *S, int r, int n)
                 sv.type.t = bt;
                 size = type_size(&sv.type, &align);
                 l = get_temp_local_var(S, size,align);
+                if (bt == VT_QLONG)
+                    sv.type.t = VT_LLONG; /* saved as two words */
                 sv.r = VT_LOCAL | VT_LVAL;
                 sv.c.i = l;
                 store(S, p->r & VT_VALMASK, &sv);
@@ -2298,10 +2442,18 @@ ST_FUNC int gv(TCCState *S, int rc)
                 if ((S->vtop->r & (VT_VALMASK | VT_LVAL)) == VT_CONST) {
                     /* load constant */
                     unsigned long long ll = S->vtop->c.i;
+#ifdef CONFIG_TCC_INT128
+                    unsigned long long hi = S->vtop->c.q[1];
+                    S->vtop->type.t = load_type;
+#endif
                     S->vtop->c.i = ll; /* first word */
                     load(S, r, S->vtop);
                     S->vtop->r = r; /* save register value */
+#ifdef CONFIG_TCC_INT128
+                    vpush64(S, load_type, hi); /* second word */
+#else
                     vpushi(S, ll >> 32); /* second word */
+#endif
                 } else if (S->vtop->r & VT_LVAL) {
                     /* We do not want to modifier the long long pointer here.
                        So we save any other instances down the stack */
@@ -2320,6 +2472,7 @@ ST_FUNC int gv(TCCState *S, int rc)
                     S->vtop->type.t = load_type;
                 } else {
                     /* move registers */
+                    S->vtop->type.t = load_type;
                     if (!r_ok)
                         load(S, r, S->vtop);
                     if (r2_ok && S->vtop->r2 < VT_CONST)
@@ -2383,8 +2536,23 @@ ST_FUNC void gv2(TCCState *S, int rc1, int rc2)
     }
 }
 
+/* 'long long' on 32 bit targets and __int128 on 64 bit targets are
+   handled as pairs of machine words (VT_DWORD made of two VT_WORD) */
 #if PTR_SIZE == 4
-/* expand 64bit on stack in two ints */
+# define TWO_WORD_OPS
+# define VT_DWORD VT_LLONG
+# define VT_WORD VT_INT
+# define WORD_HELPER(name) TOK___##name##di3
+#elif defined CONFIG_TCC_INT128
+# define TWO_WORD_OPS
+# define VT_DWORD VT_QLONG
+# define VT_WORD VT_LLONG
+# define WORD_HELPER(name) TOK___##name##ti3
+#endif
+#define WORD_BITS (PTR_SIZE * 8)
+
+#ifdef TWO_WORD_OPS
+/* expand a double word on stack in two words */
 ST_FUNC void lexpand(TCCState *S)
 {
     int u, v;
@@ -2392,22 +2560,24 @@ ST_FUNC void lexpand(TCCState *S)
     v = S->vtop->r & (VT_VALMASK | VT_LVAL);
     if (v == VT_CONST) {
         vdup(S);
+#if PTR_SIZE == 4
         S->vtop[0].c.i >>= 32;
+#else
+        S->vtop[0].c.i = S->vtop[0].c.q[1];
+#endif
     } else if (v == (VT_LVAL|VT_CONST) || v == (VT_LVAL|VT_LOCAL)) {
         vdup(S);
-        S->vtop[0].c.i += 4;
+        S->vtop[0].c.i += PTR_SIZE;
     } else {
         gv(S, RC_INT);
         vdup(S);
         S->vtop[0].r = S->vtop[-1].r2;
         S->vtop[0].r2 = S->vtop[-1].r2 = VT_CONST;
     }
-    S->vtop[0].type.t = S->vtop[-1].type.t = VT_INT | u;
+    S->vtop[0].type.t = S->vtop[-1].type.t = VT_WORD | u;
 }
-#endif
 
-#if PTR_SIZE == 4
-/* build a long long from two ints */
+/* build a double word from two words */
 static void lbuild(TCCState *S, int t)
 {
     gv2(S, RC_INT, RC_INT);
@@ -2424,8 +2594,8 @@ static void gv_dup(TCCState *S)
     int t, rc, r;
 
     t = S->vtop->type.t;
-#if PTR_SIZE == 4
-    if ((t & VT_BTYPE) == VT_LLONG) {
+#ifdef TWO_WORD_OPS
+    if ((t & VT_BTYPE) == VT_DWORD) {
         if (t & VT_BITFIELD) {
             gv(S, RC_INT);
             t = S->vtop->type.t;
@@ -2447,7 +2617,7 @@ static void gv_dup(TCCState *S)
     }
 #endif
     /* duplicate value */
-    rc = RC_TYPE(t);
+    rc = RC_TYPE(S, t);
     gv(S, rc);
     r = get_reg(S, rc);
     vdup(S);
@@ -2455,9 +2625,9 @@ static void gv_dup(TCCState *S)
     S->vtop->r = r;
 }
 
-#if PTR_SIZE == 4
-/* generate CPU independent (unsigned) long long operations */
-static void gen_opl(TCCState *S, int op)
+#ifdef TWO_WORD_OPS
+/* generate CPU independent double word operations */
+static void gen_opw(TCCState *S, int op)
 {
     int t, a, b, op1, c, i;
     int func;
@@ -2468,23 +2638,23 @@ static void gen_opl(TCCState *S, int op)
     switch(op) {
     case '/':
     case TOK_PDIV:
-        func = TOK___divdi3;
+        func = WORD_HELPER(div);
         goto gen_func;
     case TOK_UDIV:
-        func = TOK___udivdi3;
+        func = WORD_HELPER(udiv);
         goto gen_func;
     case '%':
-        func = TOK___moddi3;
+        func = WORD_HELPER(mod);
         goto gen_mod_func;
     case TOK_UMOD:
-        func = TOK___umoddi3;
+        func = WORD_HELPER(umod);
     gen_mod_func:
 #ifdef TCC_ARM_EABI
         reg_iret = TREG_R2;
         reg_lret = TREG_R3;
 #endif
     gen_func:
-        /* call generic long long function */
+        /* call generic double word function */
         vpush_helper_func(S, func);
         vrott(S, 3);
         gfunc_call(S, 2);
@@ -2573,18 +2743,18 @@ static void gen_opl(TCCState *S, int op)
             vpop(S);
             if (op != TOK_SHL)
                 vswap(S);
-            if (c >= 32) {
+            if (c >= WORD_BITS) {
                 /* stack: L H */
                 vpop(S);
-                if (c > 32) {
-                    vpushi(S, c - 32);
+                if (c > WORD_BITS) {
+                    vpushi(S, c - WORD_BITS);
                     gen_op(S, op);
                 }
                 if (op != TOK_SAR) {
                     vpushi(S, 0);
                 } else {
                     gv_dup(S);
-                    vpushi(S, 31);
+                    vpushi(S, WORD_BITS - 1);
                     gen_op(S, TOK_SAR);
                 }
                 vswap(S);
@@ -2595,7 +2765,7 @@ static void gen_opl(TCCState *S, int op)
                 vpushi(S, c);
                 gen_op(S, op);
                 vswap(S);
-                vpushi(S, 32 - c);
+                vpushi(S, WORD_BITS - c);
                 if (op == TOK_SHL)
                     gen_op(S, TOK_SHR);
                 else
@@ -2616,13 +2786,13 @@ static void gen_opl(TCCState *S, int op)
             /* XXX: should provide a faster fallback on x86 ? */
             switch(op) {
             case TOK_SAR:
-                func = TOK___ashrdi3;
+                func = WORD_HELPER(ashr);
                 goto gen_func;
             case TOK_SHR:
-                func = TOK___lshrdi3;
+                func = WORD_HELPER(lshr);
                 goto gen_func;
             case TOK_SHL:
-                func = TOK___ashldi3;
+                func = WORD_HELPER(ashl);
                 goto gen_func;
             }
         }
@@ -2640,6 +2810,12 @@ static void gen_opl(TCCState *S, int op)
         S->vtop[-2] = tmp;
         /* stack: L1 L2 H1 H2 */
         save_regs(S, 4);
+#ifdef TCC_TARGET_ARM64
+        /* compares are not kept in the flags, the non equal test below
+           needs the high words again */
+        if (op != TOK_EQ && op != TOK_NE)
+            vpushv(S, S->vtop - 1), vpushv(S, S->vtop - 1);
+#endif
         /* compare high */
         op1 = op;
         /* when values are equal, we need to compare low words. since
@@ -2661,8 +2837,12 @@ static void gen_opl(TCCState *S, int op)
             a = gvtst(S, 1, 0);
             if (op != TOK_EQ) {
                 /* generate non equal test */
+#ifdef TCC_TARGET_ARM64
+                gen_op(S, TOK_NE);
+#else
                 vpushi(S, 0);
                 vset_VT_CMP(S, TOK_NE);
+#endif
                 b = gvtst(S, 0, 0);
             }
         }
@@ -2699,6 +2879,382 @@ static int gen_opic_lt(uint64_t a, uint64_t b)
     return (a ^ (uint64_t)1 << 63) < (b ^ (uint64_t)1 << 63);
 }
 
+#if PTR_SIZE == 8
+/* (hi:lo) / d for hi < d, remainder in *r */
+static uint64_t gen_opic_udiv128(uint64_t hi, uint64_t lo, uint64_t d,
+                                 uint64_t *r)
+{
+    uint64_t q = 0;
+    int i, c;
+
+    for (i = 0; i < 64; i++) {
+        c = hi >> 63;
+        hi = hi << 1 | lo >> 63;
+        lo <<= 1;
+        q <<= 1;
+        if (c || hi >= d)
+            hi -= d, q |= 1;
+    }
+    *r = hi;
+    return q;
+}
+#endif
+
+/* Divide vtop[-1] by the constant c (not 0 or 1) without a division
+   instruction: shifts for powers of two, a multiplication with the
+   modular inverse for the exact pointer difference division and else
+   a multiplication with a 'magic' reciprocal, see "Division by
+   Invariant Integers using Multiplication" (Granlund, Montgomery).
+   Returns 0 if the generic code should be used instead. */
+static int gen_opic_divc(TCCState *S, int op, uint64_t c)
+{
+    int t = S->vtop[-1].type.t, bt = t & VT_BTYPE;
+    int n = bt == VT_LLONG || (PTR_SIZE == 8 && bt == VT_PTR) ? 64 : 32;
+    uint64_t mask = (uint64_t)-1 >> (64 - n), d, m;
+    int uns = op == TOK_UDIV || op == TOK_UMOD;
+    int mod = op == '%' || op == TOK_UMOD;
+    int neg = 0, k = 0, l;
+
+    d = c & mask;
+    if (!uns && (d >> (n - 1))) {
+        d = -d & mask;
+        neg = !mod; /* x % -d == x % d */
+    }
+    if ((d & (d - 1)) == 0) {
+        while (d >> k > 1)
+            k++;
+        if (op == TOK_UDIV || op == TOK_PDIV)
+            return 0; /* simple shift, done by the caller */
+        if (op == TOK_UMOD) {
+            S->vtop->c.i = d - 1;
+            gen_op(S, '&');
+            return 1;
+        }
+    } else if (op == TOK_PDIV) {
+        /* exact division: x / (o << k) == (x >> k) * (1 / o) */
+        while (!(d >> k & 1))
+            k++;
+        d >>= k, m = d;
+        for (l = 0; l < 5; l++)
+            m *= 2 - d * m;
+        S->vtop->c.i = k;
+        gen_op(S, TOK_SAR);
+        vpush64(S, t, m & mask);
+        gen_op(S, '*');
+        return 1;
+    } else {
+#if PTR_SIZE == 8
+        k = -1;
+#else
+        return 0;
+#endif
+    }
+
+    --S->vtop;
+    if (mod)
+        gv_dup(S);
+    if (k >= 0) {
+        /* signed power of two, round towards zero */
+        if (k) {
+            gv_dup(S);
+            if (k > 1)
+                vpushi(S, n - 1), gen_op(S, TOK_SAR);
+            vpushi(S, n - k), gen_op(S, TOK_SHR);
+            gen_op(S, '+');
+            vpushi(S, k), gen_op(S, TOK_SAR);
+        }
+        if (neg)
+            vpushi(S, 0), vswap(S), gen_op(S, '-');
+    }
+#if PTR_SIZE == 8
+    else {
+        int add, sh, tl = VT_LLONG | (uns ? VT_UNSIGNED : 0);
+        uint64_t r;
+
+        l = 63;
+        while (!(d >> l))
+            l--;
+        /* m = 2^(n + sh) / d */
+        sh = l - !uns;
+        if (n == 64)
+            m = gen_opic_udiv128((uint64_t)1 << sh, 0, d, &r);
+        else
+            m = gen_opic_udiv128(0, (uint64_t)1 << (32 + sh), d, &r);
+        add = d - r >= (uint64_t)1 << l;
+        if (add) {
+            /* the magic needs n + 1 bits */
+            m = (m + m) & mask;
+            if (((r + r) & mask) >= d || ((r + r) & mask) < r)
+                m++;
+            sh = l;
+        }
+        m = (m + 1) & mask;
+        if (uns) {
+            if (n == 32) {
+                gen_cast_s(S, tl);
+                if (add)
+                    gv_dup(S);
+                vpush64(S, tl, m), gen_op(S, '*');
+                if (add) {
+                    vpushi(S, 32), gen_op(S, TOK_SHR);
+                    gen_op(S, '+');
+                    sh += 1;
+                } else
+                    sh += 32;
+            } else if (add) {
+                /* ((x - t) >> 1) + t with t = mulhi(x, m) */
+                gv_dup(S);
+                vpush64(S, tl, m), gen_op(S, TOK_UMULH);
+                gv_dup(S);
+                vrott(S, 3);
+                gen_op(S, '-');
+                vpushi(S, 1), gen_op(S, TOK_SHR);
+                gen_op(S, '+');
+            } else {
+                vpush64(S, tl, m), gen_op(S, TOK_UMULH);
+            }
+            vpushi(S, sh), gen_op(S, TOK_SHR);
+        } else {
+            if (neg)
+                m = -m & mask;
+            if (n == 32)
+                gen_cast_s(S, tl), m = (int32_t)m;
+            if (add)
+                gv_dup(S);
+            vpush64(S, tl, m);
+            if (n == 32)
+                gen_op(S, '*'), vpushi(S, 32), gen_op(S, TOK_SAR);
+            else
+                gen_op(S, TOK_SMULH);
+            if (add) {
+                if (neg)
+                    vswap(S);
+                gen_op(S, neg ? '-' : '+');
+            }
+            vpushi(S, sh), gen_op(S, TOK_SAR);
+            /* add one to negative quotients */
+            gv_dup(S);
+            vpushi(S, 63), gen_op(S, TOK_SHR);
+            gen_op(S, '+');
+        }
+        if (n == 32)
+            gen_cast_s(S, t);
+    }
+#endif
+    if (mod) {
+        vpush64(S, t, d), gen_op(S, '*');
+        gen_op(S, '-');
+    }
+    return 1;
+}
+
+#ifdef CONFIG_TCC_INT128
+/* __int128 constants, as {low, high} words in c.q[] */
+
+/* a <<= n, n = 0..127 */
+static void gen_opq_shl(uint64_t *a, int n)
+{
+    if (n >= 64)
+        a[1] = a[0] << (n - 64), a[0] = 0;
+    else if (n)
+        a[1] = a[1] << n | a[0] >> (64 - n), a[0] <<= n;
+}
+
+/* a >>= n, n = 0..127, with the sign of a if 'sar' */
+static void gen_opq_shr(uint64_t *a, int n, int sar)
+{
+    uint64_t s = sar ? -(a[1] >> 63) : 0;
+
+    if (n >= 64) {
+        a[0] = a[1] >> (n - 64);
+        if (n > 64)
+            a[0] |= s << (128 - n);
+        a[1] = s;
+    } else if (n) {
+        a[0] = a[0] >> n | a[1] << (64 - n);
+        a[1] = a[1] >> n | s << (64 - n);
+    }
+}
+
+static void gen_opq_neg(uint64_t *a)
+{
+    a[1] = -a[1] - (a[0] != 0);
+    a[0] = -a[0];
+}
+
+/* the unsigned 'a' rounded once to 'bits' significant bits, as the
+   runtime conversions do */
+static long double gen_opq_to_ld(const uint64_t *a, int bits)
+{
+    uint64_t hi = a[1], lo = a[0], m, r, half = (uint64_t)1 << 63;
+    int e = 64, s;
+    long double x;
+
+    if (hi == 0 && (bits == 64 || lo >> bits == 0))
+        return lo;
+    if (hi == 0)
+        hi = lo, lo = 0, e = 0;
+    for (s = 32; s; s >>= 1)
+        if (hi >> (64 - s) == 0)
+            hi = hi << s | lo >> (64 - s), lo <<= s, e -= s;
+    if (bits < 64)
+        m = hi >> (64 - bits), r = hi << bits | (lo != 0);
+    else
+        m = hi, r = lo;
+    e += 64 - bits;
+    if (r > half || (r == half && (m & 1)))
+        if (++m == 0)
+            m = half, e++;
+    for (x = m; e >= 32; e -= 32)
+        x *= 4294967296.0;
+    return x * ((uint64_t)1 << e);
+}
+
+/* a = a * b */
+static void gen_opq_mul(uint64_t *a, const uint64_t *b)
+{
+    uint64_t a0 = (uint32_t)a[0], a1 = a[0] >> 32;
+    uint64_t b0 = (uint32_t)b[0], b1 = b[0] >> 32;
+    uint64_t m = (a0 * b0 >> 32) + (uint32_t)(a1 * b0) + a0 * b1;
+    uint64_t hi = a1 * b1 + (a1 * b0 >> 32) + (m >> 32);
+
+    hi += a[0] * b[1] + a[1] * b[0];
+    a[0] *= b[0];
+    a[1] = hi;
+}
+
+static int gen_opq_ult(const uint64_t *a, const uint64_t *b)
+{
+    return a[1] != b[1] ? a[1] < b[1] : a[0] < b[0];
+}
+
+/* unsigned a = a / b, r = a % b */
+static void gen_opq_udiv(uint64_t *a, const uint64_t *b, uint64_t *r)
+{
+    int i, c;
+
+    r[0] = r[1] = 0;
+    for (i = 0; i < 128; i++) {
+        c = r[1] >> 63;
+        r[1] = r[1] << 1 | r[0] >> 63;
+        r[0] = r[0] << 1 | a[1] >> 63;
+        gen_opq_shl(a, 1);
+        if (c || !gen_opq_ult(r, b)) {
+            r[1] -= b[1] + (r[0] < b[0]);
+            r[0] -= b[0];
+            a[0] |= 1;
+        }
+    }
+}
+
+/* __int128 operations: fold constants, filter out some NOPs and else
+   use the double word code */
+static void gen_opq(TCCState *S, int op)
+{
+    SValue *v1 = S->vtop - 1;
+    SValue *v2 = S->vtop;
+    int c1 = (v1->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST;
+    int c2 = (v2->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST;
+    int shift = op == TOK_SHL || op == TOK_SHR || op == TOK_SAR;
+    uint64_t *a = v1->c.q, b[2], r[2], x[2];
+    int n = 0, sa, sb;
+
+    if (c2) {
+        /* the shift count is an int */
+        b[0] = v2->c.i, b[1] = shift ? 0 : v2->c.q[1];
+        n = b[0] & 127;
+    }
+    if (c1 && c2) {
+        switch(op) {
+        case '+':
+            a[1] += b[1] + (a[0] + b[0] < a[0]), a[0] += b[0];
+            break;
+        case '-':
+            a[1] -= b[1] + (a[0] < b[0]), a[0] -= b[0];
+            break;
+        case '&': a[0] &= b[0], a[1] &= b[1]; break;
+        case '^': a[0] ^= b[0], a[1] ^= b[1]; break;
+        case '|': a[0] |= b[0], a[1] |= b[1]; break;
+        case '*': gen_opq_mul(a, b); break;
+        case TOK_SHL: gen_opq_shl(a, n); break;
+        case TOK_SHR: gen_opq_shr(a, n, 0); break;
+        case TOK_SAR: gen_opq_shr(a, n, 1); break;
+        case TOK_PDIV:
+        case '/':
+        case '%':
+        case TOK_UDIV:
+        case TOK_UMOD:
+            if ((b[0] | b[1]) == 0) {
+                if (S->tccgen_const_wanted && !(S->nocode_wanted & unevalmask))
+                    tcc_error(S, "division by zero in constant");
+                goto general_case;
+            }
+            sa = sb = 0;
+            if (op != TOK_UDIV && op != TOK_UMOD) {
+                if ((sa = a[1] >> 63))
+                    gen_opq_neg(a);
+                if ((sb = b[1] >> 63))
+                    gen_opq_neg(b);
+            }
+            gen_opq_udiv(a, b, r);
+            if (op == '%' || op == TOK_UMOD) {
+                a[0] = r[0], a[1] = r[1];
+                sb = 0;
+            }
+            if (sa ^ sb)
+                gen_opq_neg(a);
+            break;
+            /* tests */
+        case TOK_EQ: a[0] = a[0] == b[0] && a[1] == b[1]; break;
+        case TOK_NE: a[0] = a[0] != b[0] || a[1] != b[1]; break;
+        case TOK_ULT: a[0] = gen_opq_ult(a, b); break;
+        case TOK_UGE: a[0] = !gen_opq_ult(a, b); break;
+        case TOK_UGT: a[0] = gen_opq_ult(b, a); break;
+        case TOK_ULE: a[0] = !gen_opq_ult(b, a); break;
+        case TOK_LT:
+        case TOK_GE:
+        case TOK_GT:
+        case TOK_LE:
+            /* compare with flipped sign bits */
+            x[0] = a[0], x[1] = a[1] ^ (uint64_t)1 << 63;
+            b[1] ^= (uint64_t)1 << 63;
+            if (op == TOK_LT || op == TOK_GE)
+                a[0] = gen_opq_ult(x, b) ^ (op == TOK_GE);
+            else
+                a[0] = gen_opq_ult(b, x) ^ (op == TOK_LE);
+            break;
+        default:
+            goto general_case;
+        }
+        if (TOK_ISCOND(op))
+            a[1] = 0;
+        S->vtop--;
+    } else if (c2 && ((b[0] | b[1]) == 0 || (shift && n == 0)) &&
+               (op == '+' || op == '-' || op == '|' || op == '^' || shift)) {
+        /* x + 0, x << 0 ... */
+        S->vtop--;
+    } else if (c2 && b[0] == 1 && b[1] == 0 &&
+               (op == '*' || op == '/' || op == TOK_UDIV || op == TOK_PDIV)) {
+        /* x * 1, x / 1 */
+        S->vtop--;
+    } else if (c2 && !b[1] && b[0] && !(b[0] & (b[0] - 1)) &&
+               (op == '*' || op == TOK_UDIV)) {
+        /* x * 2^n and unsigned x / 2^n are shifts */
+        n = 0;
+        while (b[0] >> n > 1)
+            n++;
+        vpop(S);
+        vpushi(S, n);
+        gen_opw(S, op == '*' ? TOK_SHL : TOK_SHR);
+    } else {
+    general_case:
+        if (c2 && shift)
+            v2->c.i = n;
+        gen_opw(S, op);
+    }
+}
+#endif
+
 /* handle integer constant optimizations and various machine
    independent opt */
 static void gen_opic(TCCState *S, int op)
@@ -2713,6 +3269,13 @@ static void gen_opic(TCCState *S, int op)
     uint64_t l2 = c2 ? v2->c.i : 0;
     int shm = (t1 == VT_LLONG) ? 63 : 31;
 
+#ifdef CONFIG_TCC_INT128
+    if (t1 == VT_QLONG) {
+        gen_opq(S, op);
+        return;
+    }
+#endif
+
     if (t1 != VT_LLONG && (PTR_SIZE != 8 || t1 != VT_PTR))
         l1 = ((uint32_t)l1 |
               (v1->type.t & VT_UNSIGNED ? 0 : -(l1 & 0x80000000)));
@@ -2808,6 +3371,10 @@ static void gen_opic(TCCState *S, int op)
                             (l2 == -1 || (l2 == 0xFFFFFFFF && t2 != VT_LLONG))))) {
             /* filter out NOP operations like x*1, x-0, x&-1... */
             S->vtop--;
+        } else if (c2 && l2 && (op == '/' || op == '%' || op == TOK_PDIV ||
+                                op == TOK_UDIV || op == TOK_UMOD) &&
+                   gen_opic_divc(S, op, l2)) {
+            /* division by a constant without a division */
         } else if (c2 && (op == '*' || op == TOK_PDIV || op == TOK_UDIV)) {
             /* try to use shifts instead of muls or divs */
             if (l2 > 0 && (l2 & (l2 - 1)) == 0) {
@@ -2843,7 +3410,11 @@ static void gen_opic(TCCState *S, int op)
                 /* call low level op generator */
                 if (t1 == VT_LLONG || t2 == VT_LLONG ||
                     (PTR_SIZE == 8 && (t1 == VT_PTR || t2 == VT_PTR)))
+#if PTR_SIZE == 4
+                    gen_opw(S, op);
+#else
                     gen_opl(S, op);
+#endif
                 else
                     gen_opi(S, op);
         }
@@ -2872,7 +3443,7 @@ void gen_negf(TCCState *S, int op)
 
     size = type_size(&S->vtop->type, &align);
     bt = S->vtop->type.t & VT_BTYPE;
-    save_reg(S, gv(S, RC_TYPE(bt)));
+    save_reg(S, gv(S, RC_TYPE(S, bt)));
     vdup(S);
     incr_bf_adr(S, size - 1);
     vdup(S);
@@ -3024,6 +3595,11 @@ static void type_to_str(TCCState *S, char *buf, int buf_size,
     case VT_INT:
         tstr = "int";
         goto maybe_long;
+#ifdef CONFIG_TCC_INT128
+    case VT_QLONG:
+        tstr = "__int128";
+        goto add_tstr;
+#endif
     case VT_LLONG:
         tstr = "long long";
     maybe_long:
@@ -3046,6 +3622,12 @@ static void type_to_str(TCCState *S, char *buf, int buf_size,
         pstrcat(buf, buf_size, tstr);
         break;
     case VT_STRUCT:
+        if (type->ref->a.vector) {
+            type_to_str(S, buf1, sizeof(buf1), VECTOR_ELEM(type), NULL);
+            snprintf(buf, buf_size, "%s __attribute__((vector_size(%d)))",
+                     buf1, type->ref->c);
+            break;
+        }
         tstr = "struct ";
         if (IS_UNION(t))
             tstr = "union ";
@@ -3318,6 +3900,13 @@ static int combine_types(TCCState *S, CType *dest, SValue *op1, SValue *op2, int
         } else {
             type.t = VT_FLOAT;
         }
+#ifdef CONFIG_TCC_INT128
+    } else if (bt1 == VT_QLONG || bt2 == VT_QLONG) {
+        type.t = VT_QLONG;
+        if ((t1 & (VT_BTYPE | VT_UNSIGNED)) == (VT_QLONG | VT_UNSIGNED) ||
+            (t2 & (VT_BTYPE | VT_UNSIGNED)) == (VT_QLONG | VT_UNSIGNED))
+          type.t |= VT_UNSIGNED;
+#endif
     } else if (bt1 == VT_LLONG || bt2 == VT_LLONG) {
         /* cast to biggest op */
         type.t = VT_LLONG | VT_LONG;
@@ -3342,65 +3931,265 @@ static int combine_types(TCCState *S, CType *dest, SValue *op1, SValue *op2, int
     return ret;
 }
 
-/* generic gen_op: handles types problems */
-ST_FUNC void gen_op(TCCState *S, int op)
+/* ------------------------------------------------------------------------- */
+/* GCC vector extensions */
+
+/* turn 'type' into a vector of 'size' bytes of its elements.  Vectors
+   are structs with one array member.  There is one such struct per
+   element type and size, so that compare_types() works. */
+static void vector_type(TCCState *S, CType *type, int size)
+{
+    Sym *s, *a, *f;
+    int i, t, esize, align;
+
+    t = type->t & (VT_BTYPE | VT_UNSIGNED | VT_DEFSIGN | VT_LONG);
+    if (!is_integer_btype(t & VT_BTYPE) && !is_float(t))
+        tcc_error(S, "invalid vector type");
+    esize = type_size(type, &align);
+    if ((t & VT_BTYPE) == VT_BOOL || (t & VT_BTYPE) == VT_LDOUBLE
+        || size <= 0 || (size & (size - 1)) || size % esize)
+        tcc_error(S, "invalid vector type");
+    for (i = 0; i < S->tccgen_nb_vector_types; i++) {
+        s = S->tccgen_vector_types[i];
+        if (s->c == size && s->next->type.ref->type.t == t)
+            goto found;
+    }
+    a = sym_push2(S, &S->tccgen_global_stack, SYM_FIELD, t, size / esize);
+    f = sym_push2(S, &S->tccgen_global_stack,
+                  SYM_FIELD | S->tccgen_anon_sym++, VT_PTR | VT_ARRAY, 0);
+    f->type.ref = a;
+    s = sym_push2(S, &S->tccgen_global_stack,
+                  SYM_STRUCT | S->tccgen_anon_sym++, VT_STRUCT, size);
+    s->r = size < 16 ? size : 16;
+    s->a.vector = 1;
+    s->next = f;
+    dynarray_add(S, &S->tccgen_vector_types, &S->tccgen_nb_vector_types, s);
+found:
+    type->t = (type->t & (VT_STORAGE | VT_CONSTANT | VT_VOLATILE)) | VT_STRUCT;
+    type->ref = s;
+}
+
+/* vector of signed integers as wide as the elements of 'type', the
+   type of comparisons */
+static void vector_cmp_type(TCCState *S, CType *ct, CType *type)
 {
-    int u, t1, t2, bt1, bt2, t;
-    CType type1, combtype;
+    int align, esize = type_size(VECTOR_ELEM(type), &align);
+    ct->t = esize == 1 ? VT_BYTE | VT_DEFSIGN : esize == 2 ? VT_SHORT
+          : esize == 4 ? VT_INT : VT_LLONG;
+    vector_type(S, ct, type->ref->c);
+}
 
-redo:
-    t1 = S->vtop[-1].type.t;
-    t2 = S->vtop[0].type.t;
-    bt1 = t1 & VT_BTYPE;
-    bt2 = t2 & VT_BTYPE;
-        
-    if (bt1 == VT_FUNC || bt2 == VT_FUNC) {
-	if (bt2 == VT_FUNC) {
-	    mk_pointer(S, &S->vtop->type);
-	    gaddrof(S);
-	}
-	if (bt1 == VT_FUNC) {
-	    vswap(S);
-	    mk_pointer(S, &S->vtop->type);
-	    gaddrof(S);
-	    vswap(S);
-	}
-	goto redo;
-    } else if (!combine_types(S, &combtype, S->vtop - 1, S->vtop, op)) {
-        tcc_error_noabort(S, "invalid operand types for binary operation");
+/* pop the vector lvalue on top of the stack into 'sv', copied to a
+   temporary if it is not at a fixed address */
+static void vpop_vector(TCCState *S, SValue *sv)
+{
+    int size, align, r = S->vtop->r & (VT_VALMASK | VT_LVAL);
+    CType type;
+
+    if (r != (VT_LOCAL | VT_LVAL) && r != (VT_CONST | VT_LVAL)) {
+        type = S->vtop->type;
+        size = type_size(&type, &align);
+        S->loc = (S->loc - size) & -align;
+        vset(S, &type, VT_LOCAL | VT_LVAL, S->loc);
+        vswap(S);
+        vstore(S);
         vpop(S);
-    } else if (bt1 == VT_PTR || bt2 == VT_PTR) {
-        /* at least one operand is a pointer */
-        /* relational op: must be both pointers */
-        if (TOK_ISCOND(op))
-            goto std_op;
-        /* if both pointers, then it must be the '-' op */
-        if (bt1 == VT_PTR && bt2 == VT_PTR) {
-            if (op != '-')
-                tcc_error(S, "cannot use pointers here");
-            if (S->vtop[-1].type.t & VT_VLA) {
-                vla_runtime_pointed_size(S, &S->vtop[-1].type);
-            } else {
-                vpushi(S, pointed_size(&S->vtop[-1].type));
-            }
-            vrott(S, 3);
-            gen_opic(S, op);
-            S->vtop->type.t = VT_PTRDIFF_T;
-            vswap(S);
-            gen_op(S, TOK_PDIV);
-        } else {
-            /* exactly one pointer : must be '+' or '-'. */
-            if (op != '-' && op != '+')
-                tcc_error(S, "cannot use pointers here");
-            /* Put pointer as first operand */
-            if (bt2 == VT_PTR) {
-                vswap(S);
-                t = t1, t1 = t2, t2 = t;
-            }
+        vset(S, &type, VT_LOCAL | VT_LVAL, S->loc);
+    }
+    *sv = *S->vtop--;
+    sv->type.t &= ~(VT_CONSTANT | VT_VOLATILE);
+}
+
+/* push element 'i' of the vector 'sv' */
+static void vpush_elem(TCCState *S, SValue *sv, int i)
+{
+    int align;
+
+    vpushv(S, sv);
+    S->vtop->type = *VECTOR_ELEM(&sv->type);
+    S->vtop->c.i += i * type_size(&S->vtop->type, &align);
+}
+
+/* replace the scalar on top of the stack by a vector of 'type' with
+   all elements equal to it */
+static void vector_splat(TCCState *S, CType *type)
+{
+    SValue sv;
+    int i, n, size, esize, align, d;
+    int bt = S->vtop->type.t & VT_BTYPE;
+
+    if (!is_integer_btype(bt) && !is_float(bt))
+        tcc_error(S, "invalid operand types for vector operation");
+    gen_cast(S, VECTOR_ELEM(type));
+    size = type_size(type, &align);
+    esize = type_size(VECTOR_ELEM(type), &align);
+    if ((S->vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) != VT_CONST) {
+        S->loc = (S->loc - esize) & -esize;
+        vset(S, VECTOR_ELEM(type), VT_LOCAL | VT_LVAL, S->loc);
+        vswap(S);
+        vstore(S);
+        vpop(S);
+        vset(S, VECTOR_ELEM(type), VT_LOCAL | VT_LVAL, S->loc);
+    }
+    sv = *S->vtop--;
+    S->loc = (S->loc - size) & -type->ref->r;
+    d = S->loc;
+    for (i = 0, n = size / esize; i < n; i++) {
+        vset(S, VECTOR_ELEM(type), VT_LOCAL | VT_LVAL, d + i * esize);
+        vpushv(S, &sv);
+        vstore(S);
+        vpop(S);
+    }
+    vset(S, type, VT_LOCAL | VT_LVAL, d);
+}
+
+/* binary operation with at least one vector operand.  Scalars are
+   converted and broadcast, comparisons yield 0 or -1 per element.
+   The backend gets a chance to emit SIMD code, otherwise the
+   operation is done element by element. */
+static void gen_vector_op(TCCState *S, int op)
+{
+    SValue a, b;
+    CType type, rtype, *et;
+    int i, n, size, esize, align, d;
+
+    if (!IS_VECTOR(&S->vtop[-1].type)) {
+        vswap(S);
+        vector_splat(S, &S->vtop[-1].type);
+        vswap(S);
+    } else if (!IS_VECTOR(&S->vtop->type)) {
+        vector_splat(S, &S->vtop[-1].type);
+    }
+    if (!compare_types(&S->vtop[-1].type, &S->vtop->type, 1))
+        type_incompatibility_error(S, &S->vtop[-1].type, &S->vtop->type,
+            "invalid operands to vector operation ('%s' and '%s')");
+    vpop_vector(S, &b);
+    vpop_vector(S, &a);
+    type = a.type;
+    rtype = type;
+    if (TOK_ISCOND(op))
+        vector_cmp_type(S, &rtype, &type);
+    et = VECTOR_ELEM(&rtype);
+    size = type_size(&type, &align);
+    esize = type_size(et, &align);
+    S->loc = (S->loc - size) & -type.ref->r;
+    d = S->loc;
+    i = 0, n = size / esize;
+#if defined TCC_TARGET_X86_64 || defined TCC_TARGET_ARM64
+    if (gen_opv(S, op, &a, &b, d))
+        i = n;
+#endif
+    for (; i < n; i++) {
+        vset(S, et, VT_LOCAL | VT_LVAL, d + i * esize);
+        vpush_elem(S, &a, i);
+        vpush_elem(S, &b, i);
+        gen_op(S, op);
+        if (TOK_ISCOND(op)) {
+            vpushi(S, 0);
+            vswap(S);
+            gen_op(S, '-');
+        }
+        vstore(S);
+        vpop(S);
+    }
+    vset(S, &rtype, VT_LOCAL | VT_LVAL, d);
+}
+
+/* casts between vectors, and between vectors and scalars of the same
+   size, reinterpret the bits */
+static void gen_vector_cast(TCCState *S, CType *type)
+{
+    int align, size, ss = -1;
+    SValue sv;
+
+    size = type_size(type, &align);
+    if (IS_VECTOR(&S->vtop->type) || is_integer_btype(S->vtop->type.t & VT_BTYPE))
+        ss = type_size(&S->vtop->type, &align);
+    if (ss != size || (!IS_VECTOR(type) && !is_integer_btype(type->t & VT_BTYPE)))
+        cast_error(S, &S->vtop->type, type);
+    if (!IS_VECTOR(&S->vtop->type)) {
+        /* integer to vector: go through memory */
+        S->loc = (S->loc - size) & -size;
+        vset(S, &S->vtop->type, VT_LOCAL | VT_LVAL, S->loc);
+        vswap(S);
+        vstore(S);
+        vpop(S);
+        vset(S, type, VT_LOCAL | VT_LVAL, S->loc);
+    } else if (!IS_VECTOR(type)) {
+        /* vector to integer: read its memory */
+        vpop_vector(S, &sv);
+        vpushv(S, &sv);
+    }
+    S->vtop->type = *type;
+    S->vtop->type.t &= ~(VT_CONSTANT | VT_VOLATILE);
+}
+
+/* generic gen_op: handles types problems */
+ST_FUNC void gen_op(TCCState *S, int op)
+{
+    int u, t1, t2, bt1, bt2, t;
+    CType type1, combtype;
+
+    S->tccgen_expect = 0;
+redo:
+    t1 = S->vtop[-1].type.t;
+    t2 = S->vtop[0].type.t;
+    bt1 = t1 & VT_BTYPE;
+    bt2 = t2 & VT_BTYPE;
+        
+    if (bt1 == VT_FUNC || bt2 == VT_FUNC) {
+	if (bt2 == VT_FUNC) {
+	    mk_pointer(S, &S->vtop->type);
+	    gaddrof(S);
+	}
+	if (bt1 == VT_FUNC) {
+	    vswap(S);
+	    mk_pointer(S, &S->vtop->type);
+	    gaddrof(S);
+	    vswap(S);
+	}
+	goto redo;
+    } else if (IS_VECTOR(&S->vtop[-1].type) || IS_VECTOR(&S->vtop->type)) {
+        gen_vector_op(S, op);
+        return;
+    } else if (!combine_types(S, &combtype, S->vtop - 1, S->vtop, op)) {
+        tcc_error_noabort(S, "invalid operand types for binary operation");
+        vpop(S);
+    } else if (bt1 == VT_PTR || bt2 == VT_PTR) {
+        /* at least one operand is a pointer */
+        /* relational op: must be both pointers */
+        if (TOK_ISCOND(op))
+            goto std_op;
+        /* if both pointers, then it must be the '-' op */
+        if (bt1 == VT_PTR && bt2 == VT_PTR) {
+            if (op != '-')
+                tcc_error(S, "cannot use pointers here");
+            if (S->vtop[-1].type.t & VT_VLA) {
+                vla_runtime_pointed_size(S, &S->vtop[-1].type);
+            } else {
+                vpushi(S, pointed_size(&S->vtop[-1].type));
+            }
+            vrott(S, 3);
+            gen_opic(S, op);
+            S->vtop->type.t = VT_PTRDIFF_T;
+            vswap(S);
+            gen_op(S, TOK_PDIV);
+        } else {
+            /* exactly one pointer : must be '+' or '-'. */
+            if (op != '-' && op != '+')
+                tcc_error(S, "cannot use pointers here");
+            /* Put pointer as first operand */
+            if (bt2 == VT_PTR) {
+                vswap(S);
+                t = t1, t1 = t2, t2 = t;
+            }
 #if PTR_SIZE == 4
             if ((S->vtop[0].type.t & VT_BTYPE) == VT_LLONG)
                 /* XXX: truncate here because gen_opl can't handle ptr + long long */
                 gen_cast_s(S, VT_INT);
+#elif defined CONFIG_TCC_INT128
+            if ((S->vtop[0].type.t & VT_BTYPE) == VT_QLONG)
+                gen_cast_s(S, VT_LLONG);
 #endif
             type1 = S->vtop[-1].type;
             if (S->vtop[-1].type.ref->type.t & VT_VLA)
@@ -3443,7 +4232,7 @@ redo:
             && !TOK_ISCOND(op))
             tcc_error(S, "invalid operands for binary operation");
         else if (op == TOK_SHR || op == TOK_SAR || op == TOK_SHL) {
-            t = bt1 == VT_LLONG ? VT_LLONG : VT_INT;
+            t = bt1 == VT_LLONG || bt1 == VT_QLONG ? bt1 : VT_INT;
             if ((t1 & (VT_BTYPE | VT_UNSIGNED | VT_BITFIELD)) == (t | VT_UNSIGNED))
               t |= VT_UNSIGNED;
             t |= (VT_LONG & t1);
@@ -3490,7 +4279,7 @@ redo:
     }
     // Make sure that we have converted to an rvalue:
     if (S->vtop->r & VT_LVAL)
-        gv(S, is_float(S->vtop->type.t & VT_BTYPE) ? RC_FLOAT : RC_INT);
+        gv(S, RC_TYPE(S, S->vtop->type.t));
 }
 
 #if defined TCC_TARGET_ARM64 || defined TCC_TARGET_RISCV64 || defined TCC_TARGET_ARM
@@ -3581,6 +4370,11 @@ static void gen_cast(TCCState *S, CType *type)
     if (S->vtop->type.t & VT_BITFIELD)
         gv(S, RC_INT);
 
+    if (IS_VECTOR(type) || IS_VECTOR(&S->vtop->type)) {
+        gen_vector_cast(S, type);
+        return;
+    }
+
     dbt = type->t & (VT_BTYPE | VT_UNSIGNED);
     sbt = S->vtop->type.t & (VT_BTYPE | VT_UNSIGNED);
     if (sbt == VT_FUNC)
@@ -3611,6 +4405,44 @@ error:
             else if (sbt == VT_DOUBLE)
                 S->vtop->c.ld = S->vtop->c.d;
 
+#ifdef CONFIG_TCC_INT128
+            if (dbt_bt == VT_QLONG) {
+                uint64_t *q = S->vtop->c.q;
+                if (sf) {
+                    long double ld = S->vtop->c.ld;
+                    int neg = ld < 0;
+                    if (neg)
+                        ld = -ld;
+                    q[1] = ld / 18446744073709551616.0L;
+                    q[0] = ld - q[1] * 18446744073709551616.0L;
+                    if (neg)
+                        gen_opq_neg(q);
+                } else if (sbt_bt != VT_QLONG) {
+                    if (sbt_bt != VT_LLONG && sbt_bt != VT_PTR)
+                        q[0] = sbt & VT_UNSIGNED ? (uint32_t)q[0]
+                                                 : (uint64_t)(int32_t)q[0];
+                    q[1] = sbt & VT_UNSIGNED ? 0 : -(q[0] >> 63);
+                }
+                goto done;
+            } else if (sbt_bt == VT_QLONG) {
+                uint64_t q[2];
+                q[0] = S->vtop->c.q[0], q[1] = S->vtop->c.q[1];
+                if (df) {
+                    int neg = !(sbt & VT_UNSIGNED) && q[1] >> 63;
+                    if (neg)
+                        gen_opq_neg(q);
+                    S->vtop->c.ld = gen_opq_to_ld(q, dbt == VT_FLOAT ? 24
+                                                  : dbt == VT_DOUBLE ? 53 : 64);
+                    if (neg)
+                        S->vtop->c.ld = -S->vtop->c.ld;
+                    sf = 1, sbt_bt = VT_LDOUBLE;
+                } else if (dbt == VT_BOOL) {
+                    S->vtop->c.i = (q[0] | q[1]) != 0;
+                    goto done;
+                } else /* take the low word */
+                    sbt_bt = VT_LLONG;
+            }
+#endif
             if (df) {
                 if (sbt_bt == VT_LLONG) {
                     if ((sbt & VT_UNSIGNED) || !(S->vtop->c.i >> 63))
@@ -3674,6 +4506,22 @@ error:
             goto done;
         }
 
+#ifdef CONFIG_TCC_INT128
+        if ((sf && dbt_bt == VT_QLONG) || (df && sbt_bt == VT_QLONG)) {
+            /* __int128 <-> float, double, long double */
+            if (sf)
+                vpush_helper_func(S, TOK___fixsfti + 2 * (sbt - VT_FLOAT)
+                                  + !!(dbt & VT_UNSIGNED));
+            else
+                vpush_helper_func(S, TOK___floattisf + 2 * (dbt - VT_FLOAT)
+                                  + !!(sbt & VT_UNSIGNED));
+            vrott(S, 2);
+            gfunc_call(S, 1);
+            vpushi(S, 0);
+            PUT_R_RET(S->vtop, dbt);
+            goto done;
+        }
+#endif
         if (sf || df) {
             if (sf && df) {
                 /* convert from fp to fp */
@@ -3749,6 +4597,29 @@ error:
         ss = 4;
 
 #elif PTR_SIZE == 8
+#ifdef CONFIG_TCC_INT128
+        if (ds == 16) {
+            /* generate high word */
+            if (ss < 8)
+                gen_cast_s(S, VT_LLONG | (sbt & VT_UNSIGNED));
+            if (sbt & VT_UNSIGNED) {
+                vpushi(S, 0);
+                gv(S, RC_INT);
+            } else {
+                gv_dup(S);
+                vpushi(S, 63);
+                gen_op(S, TOK_SAR);
+            }
+            lbuild(S, dbt);
+            goto done;
+        } else if (ss == 16) {
+            /* from __int128: just take low order word */
+            lexpand(S);
+            vpop(S);
+            sbt = S->vtop->type.t & (VT_BTYPE | VT_UNSIGNED);
+            goto again;
+        }
+#endif
         if (ds == 8) {
             /* need to convert from 32bit to 64bit */
             if (sbt & VT_UNSIGNED) {
@@ -3855,7 +4726,11 @@ ST_FUNC int type_size(CType *type, int *a)
         *a = 2;
         return 2;
     } else if (bt == VT_QLONG || bt == VT_QFLOAT) {
+#ifdef CONFIG_TCC_INT128
+        *a = bt == VT_QLONG ? 16 : 8;
+#else
         *a = 8;
+#endif
         return 16;
     } else {
         /* char, void, function, _Bool */
@@ -3980,6 +4855,9 @@ static void verify_assign_cast(TCCState *S, CType *dt)
     case VT_SHORT:
     case VT_INT:
     case VT_LLONG:
+#ifdef CONFIG_TCC_INT128
+    case VT_QLONG:
+#endif
         if (sbt == VT_PTR || sbt == VT_FUNC) {
             tcc_warning(S, "assignment makes integer from pointer without a cast");
         } else if (sbt == VT_STRUCT) {
@@ -4017,9 +4895,23 @@ ST_FUNC void vstore(TCCState *S)
     if (sbt == VT_STRUCT) {
         /* if structure, only generate pointer */
         /* structure assignment : generate memcpy */
-        /* XXX: optimize if small size */
             size = type_size(&S->vtop->type, &align);
-
+#ifdef STRUCT_INLINE_MAX
+        if (size <= STRUCT_INLINE_MAX
+#ifdef CONFIG_TCC_BCHECK
+            && !S->do_bounds_check
+#endif
+            ) {
+            /* small structure: copy inline */
+            vswap(S);
+            S->vtop->type.t = VT_PTR;
+            gaddrof(S);
+            vpushv(S, S->vtop - 1);
+            S->vtop->type.t = VT_PTR;
+            gaddrof(S);
+            gen_struct_copy(S, size);
+        } else {
+#endif
             /* destination */
             vswap(S);
 #ifdef CONFIG_TCC_BCHECK
@@ -4052,6 +4944,9 @@ ST_FUNC void vstore(TCCState *S)
             /* type size */
             vpushi(S, size);
             gfunc_call(S, 3);
+#ifdef STRUCT_INLINE_MAX
+        }
+#endif
         /* leave source on stack */
 
     } else if (ft & VT_BITFIELD) {
@@ -4130,7 +5025,7 @@ ST_FUNC void vstore(TCCState *S)
                 vswap(S);
             }
 #endif
-            gv(S, RC_TYPE(dbt)); /* generate value */
+            gv(S, RC_TYPE(S, dbt)); /* generate value */
 
             if (delayed_cast) {
                 S->vtop->r |= BFVAL(VT_MUSTCAST, (sbt == VT_LLONG) + 1);
@@ -4274,6 +5169,14 @@ redo:
         case TOK_ALWAYS_INLINE2:
             ad->f.func_alwinl = 1;
             break;
+        case TOK_COLD1:
+        case TOK_COLD2:
+            ad->f.func_cold = 1;
+            break;
+        case TOK_HOT1:
+        case TOK_HOT2:
+            ad->f.func_hot = 1;
+            break;
         case TOK_SECTION1:
         case TOK_SECTION2:
             skip(S, '(');
@@ -4393,6 +5296,12 @@ redo:
             next(S);
             skip(S, ')');
             break;
+        case TOK_VECTOR_SIZE1:
+        case TOK_VECTOR_SIZE2:
+            skip(S, '(');
+            ad->vector_size = expr_const(S);
+            skip(S, ')');
+            break;
         case TOK_DLLEXPORT:
             ad->a.dllexport = 1;
             break;
@@ -4426,7 +5335,7 @@ redo:
     goto redo;
 }
 
-static Sym * find_field (CType *type, int v, int *cumofs)
+static Sym * find_field_linear (CType *type, int v, int *cumofs)
 {
     Sym *s = type->ref;
     v |= SYM_FIELD;
@@ -4434,7 +5343,7 @@ static Sym * find_field (CType *type, int v, int *cumofs)
 	if ((s->v & SYM_FIELD) &&
 	    (s->type.t & VT_BTYPE) == VT_STRUCT &&
 	    (s->v & ~SYM_FIELD) >= SYM_FIRST_ANOM) {
-	    Sym *ret = find_field (&s->type, v, cumofs);
+	    Sym *ret = find_field_linear (&s->type, v, cumofs);
 	    if (ret) {
                 *cumofs += s->c;
 	        return ret;
@@ -4446,6 +5355,126 @@ static Sym * find_field (CType *type, int v, int *cumofs)
     return s;
 }
 
+static FieldIndex **field_index_bucket(TCCState *S, Sym *type)
+{
+    return &S->tccgen_field_index[((size_t)type >> 4)
+                                  & (S->tccgen_field_index_size - 1)];
+}
+
+static int field_index_count(Sym *s)
+{
+    int n = 0;
+    while ((s = s->next) != NULL) {
+        if ((s->type.t & VT_BTYPE) == VT_STRUCT
+            && (s->v & ~SYM_FIELD) >= SYM_FIRST_ANOM)
+            n += field_index_count(s->type.ref);
+        else
+            ++n;
+    }
+    return n;
+}
+
+/* enter members in the same order find_field_linear() visits them,
+   so that the first match wins as well */
+static void field_index_fill(FieldIndex *fi, Sym *s, int cumofs)
+{
+    struct FieldSlot *fs;
+    unsigned h;
+
+    while ((s = s->next) != NULL) {
+        if ((s->type.t & VT_BTYPE) == VT_STRUCT
+            && (s->v & ~SYM_FIELD) >= SYM_FIRST_ANOM) {
+            field_index_fill(fi, s->type.ref, cumofs + s->c);
+            continue;
+        }
+        for (h = s->v * 0x9E3779B1u;; ++h) {
+            fs = &fi->slots[h & fi->mask];
+            if (fs->v == s->v)
+                break;
+            if (fs->v == 0) {
+                fs->v = s->v, fs->cumofs = cumofs, fs->f = s;
+                break;
+            }
+        }
+    }
+}
+
+static FieldIndex *field_index_new(TCCState *S, Sym *type)
+{
+    FieldIndex *fi, **pfi;
+    int i, n, size;
+
+    if (S->tccgen_nb_field_index >= S->tccgen_field_index_size) {
+        FieldIndex **old = S->tccgen_field_index;
+        int old_size = S->tccgen_field_index_size;
+        S->tccgen_field_index_size = old_size ? old_size * 2 : 64;
+        S->tccgen_field_index = tcc_mallocz(S,
+            S->tccgen_field_index_size * sizeof (FieldIndex *));
+        for (i = 0; i < old_size; ++i)
+            while ((fi = old[i]) != NULL) {
+                old[i] = fi->next;
+                pfi = field_index_bucket(S, fi->type);
+                fi->next = *pfi, *pfi = fi;
+            }
+        tcc_free(S, old);
+    }
+    n = field_index_count(type);
+    for (size = 16; size < 2 * n; size *= 2)
+        ;
+    fi = tcc_mallocz(S, sizeof *fi + (size - 1) * sizeof fi->slots[0]);
+    fi->type = type;
+    fi->mask = size - 1;
+    field_index_fill(fi, type, 0);
+    pfi = field_index_bucket(S, type);
+    fi->next = *pfi, *pfi = fi;
+    S->tccgen_nb_field_index++;
+    return fi;
+}
+
+/* called when the struct symbol 'type' is freed */
+static void field_index_free(TCCState *S, Sym *type)
+{
+    FieldIndex *fi, **pfi;
+
+    if (!S->tccgen_field_index)
+        return;
+    for (pfi = field_index_bucket(S, type); (fi = *pfi) != NULL; pfi = &fi->next)
+        if (fi->type == type) {
+            *pfi = fi->next;
+            tcc_free(S, fi);
+            S->tccgen_nb_field_index--;
+            break;
+        }
+}
+
+/* find member 'v' of struct/union 'type'.  Structs with many members
+   get a hash index on first use, others are searched linearly. */
+static Sym * find_field (TCCState *S, CType *type, int v, int *cumofs)
+{
+    Sym *ref = type->ref;
+    FieldIndex *fi;
+    struct FieldSlot *fs;
+    unsigned h;
+
+    if (!ref->a.fieldidx)
+        return find_field_linear(type, v, cumofs);
+    fi = S->tccgen_field_index ? *field_index_bucket(S, ref) : NULL;
+    while (fi && fi->type != ref)
+        fi = fi->next;
+    if (!fi)
+        fi = field_index_new(S, ref);
+    v |= SYM_FIELD;
+    for (h = v * 0x9E3779B1u;; ++h) {
+        fs = &fi->slots[h & fi->mask];
+        if (fs->v == v) {
+            *cumofs += fs->cumofs;
+            return fs->f;
+        }
+        if (fs->v == 0)
+            return NULL;
+    }
+}
+
 static void check_fields (TCCState *S, CType *type, int check)
 {
     Sym *s = type->ref;
@@ -4927,6 +5956,7 @@ do_decl:
 	    check_fields(S, type, 1);
 	    check_fields(S, type, 0);
             struct_layout(S, type, &ad);
+            s->a.fieldidx = field_index_count(s) >= FIELD_INDEX_MIN;
         }
     }
 }
@@ -5031,7 +6061,16 @@ static int parse_btype(TCCState *S, CType *type, AttributeDef *ad)
             }
             next(S);
             break;
-#ifdef TCC_TARGET_ARM64
+#ifdef CONFIG_TCC_INT128
+        case TOK_INT128:
+        case TOK_INT128_T:
+            u = VT_QLONG;
+            goto basic_type;
+        case TOK_UINT128:
+            t |= VT_DEFSIGN | VT_UNSIGNED;
+            u = VT_QLONG;
+            goto basic_type;
+#elif defined TCC_TARGET_ARM64
         case TOK_UINT128:
             /* GCC's __uint128_t appears in some Linux header files. Make it a
                synonym for long double to get the size and alignment right. */
@@ -5143,6 +6182,14 @@ static int parse_btype(TCCState *S, CType *type, AttributeDef *ad)
             t |= VT_INLINE;
             next(S);
             break;
+        case TOK_THREAD1:
+        case TOK_THREAD2:
+#ifndef CONFIG_TCC_TLS
+            tcc_error(S, "thread-local storage is not supported on this target");
+#endif
+            ad->a.tls = 1;
+            next(S);
+            break;
         case TOK_NORETURN3:
             next(S);
             ad->f.func_noreturn = 1;
@@ -5210,6 +6257,10 @@ the_end:
         t = (t & ~(VT_BTYPE|VT_LONG)) | (VT_DOUBLE|VT_LONG);
 #endif
     type->t = t;
+    if (ad->vector_size) {
+        vector_type(S, type, ad->vector_size);
+        ad->vector_size = 0;
+    }
     return type_found;
 }
 
@@ -5491,6 +6542,11 @@ static CType *type_decl(TCCState *S, CType *type, AttributeDef *ad, int *v, int
     }
     post_type(S, post, ad, storage, 0);
     parse_attribute(S, ad);
+    if (ad->vector_size) {
+        /* applies to the base type of the declarator */
+        vector_type(S, ret, ad->vector_size);
+        ad->vector_size = 0;
+    }
     type->t |= storage;
     return ret;
 }
@@ -5634,41 +6690,197 @@ static void parse_builtin_params(TCCState *S, int nc, const char *args)
         S->nocode_wanted--;
 }
 
-static void parse_atomic(TCCState *S, int atok)
+/* push the mask 'm' of type 't', cut to 'bits' */
+static void vpush_mask(TCCState *S, int t, uint64_t m, int bits)
 {
-    int size, align, arg;
-    CType *atom, *atom_ptr, ct = {0};
-    char buf[40];
-    static const char *const templates[] = {
-        /*
-         * Each entry consists of callback and function template.
-         * The template represents argument types and return type.
-         *
-         * ? void (return-only)
-         * b bool
-         * a atomic
-         * A read-only atomic
-         * p pointer to memory
-         * v value
-         * m memory model
-         */
+    vpush64(S, t, bits < 64 ? m & 0xffffffff : m);
+}
 
-        /* keep in order of appearance in tcctok.h: */
-        /* __atomic_store */            "avm.?",
-        /* __atomic_load */             "Am.v",
-        /* __atomic_exchange */         "avm.v",
-        /* __atomic_compare_exchange */ "apvbmm.b",
-        /* __atomic_fetch_add */        "avm.v",
-        /* __atomic_fetch_sub */        "avm.v",
-        /* __atomic_fetch_or */         "avm.v",
-        /* __atomic_fetch_xor */        "avm.v",
-        /* __atomic_fetch_and */        "avm.v"
-    };
-    const char *template = templates[(atok - TOK___atomic_store)];
+/* number of bits set in vtop of type 't' */
+static void gen_popcount(TCCState *S, int t, int bits)
+{
+    /* x - (x >> 1 & 0x55..) */
+    gv_dup(S);
+    vpushi(S, 1), gen_op(S, TOK_SHR);
+    vpush_mask(S, t, ~0ull / 3, bits), gen_op(S, '&');
+    gen_op(S, '-');
+    /* (x & 0x33..) + (x >> 2 & 0x33..) */
+    gv_dup(S);
+    vpush_mask(S, t, ~0ull / 5, bits), gen_op(S, '&');
+    vswap(S);
+    vpushi(S, 2), gen_op(S, TOK_SHR);
+    vpush_mask(S, t, ~0ull / 5, bits), gen_op(S, '&');
+    gen_op(S, '+');
+    /* (x + (x >> 4)) & 0x0f.. */
+    gv_dup(S);
+    vpushi(S, 4), gen_op(S, TOK_SHR);
+    gen_op(S, '+');
+    vpush_mask(S, t, ~0ull / 17, bits), gen_op(S, '&');
+    /* the sum of the bytes is in the top one */
+    vpush_mask(S, t, ~0ull / 255, bits), gen_op(S, '*');
+    vpushi(S, bits - 8), gen_op(S, TOK_SHR);
+    gen_cast_s(S, VT_INT);
+}
+
+/* __builtin_popcount, ctz, clz, ffs and bswap of vtop.  The target
+   generates them if it can, else they are computed with shifts and
+   masks. */
+static void builtin_bitop(TCCState *S, int tok)
+{
+    int op, bits, i, t;
+    uint64_t v, r;
+
+    if (tok >= TOK_builtin_bswap16) {
+        op = TOK_builtin_bswap16, i = tok - op;
+        bits = 16 << i;
+        t = i == 0 ? VT_SHORT : i == 1 ? VT_INT
+            : LONG_SIZE == 8 ? VT_LONG | VT_LLONG : VT_LLONG;
+    } else {
+        i = (tok - TOK_builtin_popcount) % 3, op = tok - i;
+        bits = i == 2 || (i == 1 && LONG_SIZE == 8) ? 64 : 32;
+        t = i == 0 ? VT_INT : i == 2 ? VT_LLONG
+            : LONG_SIZE == 8 ? VT_LONG | VT_LLONG : VT_LONG | VT_INT;
+    }
+    t |= VT_UNSIGNED;
+    gen_cast_s(S, t);
+
+    if ((S->vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST) {
+        v = S->vtop->c.i;
+        if (bits < 64)
+            v &= (1ull << bits) - 1;
+        r = 0;
+        switch (op) {
+        case TOK_builtin_popcount:
+            for (; v; v &= v - 1)
+                r++;
+            break;
+        case TOK_builtin_ctz:
+            while (r < bits && !(v >> r & 1))
+                r++;
+            break;
+        case TOK_builtin_clz:
+            while (r < bits && !(v >> (bits - 1 - r) & 1))
+                r++;
+            break;
+        case TOK_builtin_ffs:
+            if (v)
+                while (!(v >> r++ & 1))
+                    ;
+            break;
+        default:
+            for (i = 0; i < bits; i += 8)
+                r = r << 8 | (v >> i & 255);
+            break;
+        }
+        vpop(S);
+        if (op == TOK_builtin_bswap16)
+            vpush64(S, t, r);
+        else
+            vpushi(S, r);
+        return;
+    }
 
-    atom = atom_ptr = NULL;
-    size = 0; /* pacify compiler */
-    next(S);
+#if defined TCC_TARGET_X86_64 || defined TCC_TARGET_ARM64 \
+    || defined TCC_TARGET_RISCV64
+    if (gen_bitop(S, op)) {
+        if (op != TOK_builtin_bswap16)
+            S->vtop->type.t = VT_INT;
+        return;
+    }
+#endif
+
+    switch (op) {
+    case TOK_builtin_popcount:
+        gen_popcount(S, t, bits);
+        break;
+    case TOK_builtin_ctz:
+        /* popcount(~x & (x - 1)) */
+        gv_dup(S);
+        vpush64(S, t, 1), gen_op(S, '-');
+        vswap(S);
+        vpush_mask(S, t, ~0ull, bits), gen_op(S, '^');
+        gen_op(S, '&');
+        gen_popcount(S, t, bits);
+        break;
+    case TOK_builtin_clz:
+        /* bits - popcount(x | x >> 1 | x >> 2 ...) */
+        for (i = 1; i < bits; i *= 2) {
+            gv_dup(S);
+            vpushi(S, i), gen_op(S, TOK_SHR);
+            gen_op(S, '|');
+        }
+        gen_popcount(S, t, bits);
+        vpushi(S, bits), vswap(S), gen_op(S, '-');
+        break;
+    case TOK_builtin_ffs:
+        /* popcount(x ^ (x - 1)) & -(x != 0) */
+        gv_dup(S);
+        gv_dup(S);
+        vpush64(S, t, 1), gen_op(S, '-');
+        gen_op(S, '^');
+        gen_popcount(S, t, bits);
+        vswap(S);
+        vpush64(S, t, 0), gen_op(S, TOK_NE);
+        vpushi(S, 0), vswap(S), gen_op(S, '-');
+        gen_op(S, '&');
+        break;
+    default:
+        /* swap the bytes, then the pairs of bytes, ... */
+        for (i = 8; i < bits; i *= 2) {
+            gv_dup(S);
+            if (2 * i < bits) {
+                vpush_mask(S, t, ~0ull / ((1ull << i) + 1), bits);
+                gen_op(S, '&');
+            }
+            vpushi(S, i), gen_op(S, TOK_SHL);
+            vswap(S);
+            vpushi(S, i), gen_op(S, TOK_SHR);
+            if (2 * i < bits) {
+                vpush_mask(S, t, ~0ull / ((1ull << i) + 1), bits);
+                gen_op(S, '&');
+            }
+            gen_op(S, '|');
+        }
+        gen_cast_s(S, t);
+        break;
+    }
+}
+
+static void parse_atomic(TCCState *S, int atok)
+{
+    int size, align, arg, mo = -1;
+    CType *atom, *atom_ptr, ct = {0};
+    char buf[40];
+    static const char *const templates[] = {
+        /*
+         * Each entry consists of callback and function template.
+         * The template represents argument types and return type.
+         *
+         * ? void (return-only)
+         * b bool
+         * a atomic
+         * A read-only atomic
+         * p pointer to memory
+         * v value
+         * m memory model
+         */
+
+        /* keep in order of appearance in tcctok.h: */
+        /* __atomic_store */            "avm.?",
+        /* __atomic_load */             "Am.v",
+        /* __atomic_exchange */         "avm.v",
+        /* __atomic_compare_exchange */ "apvbmm.b",
+        /* __atomic_fetch_add */        "avm.v",
+        /* __atomic_fetch_sub */        "avm.v",
+        /* __atomic_fetch_or */         "avm.v",
+        /* __atomic_fetch_xor */        "avm.v",
+        /* __atomic_fetch_and */        "avm.v"
+    };
+    const char *template = templates[(atok - TOK___atomic_store)];
+
+    atom = atom_ptr = NULL;
+    size = 0; /* pacify compiler */
+    next(S);
     skip(S, '(');
     for (arg = 0;;) {
         expr_eq(S);
@@ -5702,6 +6914,11 @@ static void parse_atomic(TCCState *S, int atok)
             break;
         case 'm':
             gen_assign_cast(S, &S->tccgen_int_type);
+            /* the success order of compare_exchange comes first */
+            if (mo < 0)
+                mo = (S->vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST
+                    && S->vtop->c.i >= 0 && S->vtop->c.i < 5
+                    ? S->vtop->c.i : 5 /* __ATOMIC_SEQ_CST */;
             break;
         case 'b':
             ct.t = VT_BOOL;
@@ -5724,6 +6941,44 @@ static void parse_atomic(TCCState *S, int atok)
         break;
     }
 
+#if defined TCC_TARGET_X86_64 || defined TCC_TARGET_ARM64 \
+    || defined TCC_TARGET_RISCV64
+    if (is_integer_btype(atom->t & VT_BTYPE)
+        || (atom->t & VT_BTYPE) == VT_PTR) {
+        /* lock-free inline code: drop the memory orders and the
+           'weak' flag, the backend gets [p], [p v] or [p *e d] */
+        for (; strchr("bm", template[arg - 1]); --arg)
+            vpop(S);
+        if (atok == TOK___atomic_compare_exchange) {
+            vswap(S);
+            gv(S, RC_INT);
+            vdup(S);
+            vrott(S, 4);
+            indir(S);
+            vswap(S);
+        }
+        gen_atomic(S, atok, size, mo);
+        if (atok == TOK___atomic_compare_exchange)
+            vrott(S, 3); /* [e old ok] -> [ok e old] */
+        if (atok == TOK___atomic_store) {
+            vpush(S, &ct);
+        } else {
+            S->vtop->type.t = size == 8 ? VT_LLONG : VT_INT;
+            gen_cast(S, atom);
+        }
+        if (atok == TOK___atomic_compare_exchange) {
+            /* always write 'old' back to *e, like lib/stdatomic.c */
+            vswap(S);
+            indir(S);
+            vswap(S);
+            vstore(S);
+            vpop(S);
+            S->vtop->type.t = VT_BOOL;
+        }
+        return;
+    }
+#endif
+
     sprintf(buf, "%s_%d", get_tok_str(S, atok, 0), size);
     vpush_helper_func(S, tok_alloc_const(S, buf));
     vrott(S, arg + 1);
@@ -5740,9 +6995,25 @@ static void parse_atomic(TCCState *S, int atok)
     }
 }
 
+#ifdef CONFIG_TCC_TLS
+/* the address of a thread-local variable depends on the thread, the
+   backend computes it into a register */
+static void tls_lvalue(TCCState *S)
+{
+    CType type = S->vtop->type;
+    int lval = S->vtop->r & VT_LVAL;
+
+    S->vtop->r &= ~VT_LVAL;
+    S->vtop->type = S->char_pointer_type;
+    gen_tls_addr(S);
+    S->vtop->type = type;
+    S->vtop->r |= lval;
+}
+#endif
+
 ST_FUNC void unary(TCCState *S)
 {
-    int n, t, align, size, r, sizeof_caller;
+    int n, t, align, size, r, sizeof_caller, tail_call;
     CType type;
     Sym *s;
     AttributeDef ad;
@@ -5753,6 +7024,10 @@ ST_FUNC void unary(TCCState *S)
 
     sizeof_caller = S->tccgen_in_sizeof;
     S->tccgen_in_sizeof = 0;
+    /* a call which ends the postfix chain of the outermost unary of
+       'return ...;' can be a tail call */
+    tail_call = S->tccgen_tail_call;
+    S->tccgen_tail_call = 0;
     type.ref = NULL;
     /* XXX: GCC 2.95.3 does not generate a table although it should be
        better here */
@@ -5913,7 +7188,9 @@ ST_FUNC void unary(TCCState *S)
     case '!':
         next(S);
         unary(S);
+        n = vexpect(S);
         gen_test_zero(S, TOK_EQ);
+        vset_expect(S, n ? 3 - n : 0);
         break;
     case '~':
         next(S);
@@ -5963,9 +7240,34 @@ ST_FUNC void unary(TCCState *S)
         break;
 
     case TOK_builtin_expect:
-	/* __builtin_expect is a no-op for now */
-	parse_builtin_params(S, 0, "ee");
-	vpop(S);
+    case TOK_builtin_expect_with_probability:
+        /* the value of the first argument, with a hint for tests of it */
+        t = S->tok;
+        parse_builtin_params(S, 0, t == TOK_builtin_expect ? "ee" : "eee");
+        n = 1;
+        if (t != TOK_builtin_expect) {
+            n = 0;
+            if ((S->vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST) {
+                gen_cast_s(S, VT_DOUBLE);
+                n = (S->vtop->c.d > 0.5) - (S->vtop->c.d < 0.5);
+            }
+            vpop(S);
+        }
+        r = condition_3way(S);
+        vpop(S);
+        vset_expect(S, n && r >= 0 ? (r ^ (n < 0)) + 1 : 0);
+        break;
+    case TOK_builtin_popcount: case TOK_builtin_popcountl:
+    case TOK_builtin_popcountll: case TOK_builtin_ctz:
+    case TOK_builtin_ctzl: case TOK_builtin_ctzll:
+    case TOK_builtin_clz: case TOK_builtin_clzl:
+    case TOK_builtin_clzll: case TOK_builtin_ffs:
+    case TOK_builtin_ffsl: case TOK_builtin_ffsll:
+    case TOK_builtin_bswap16: case TOK_builtin_bswap32:
+    case TOK_builtin_bswap64:
+        t = S->tok;
+        parse_builtin_params(S, 0, "e");
+        builtin_bitop(S, t);
         break;
     case TOK_builtin_types_compatible_p:
 	parse_builtin_params(S, 0, "tt");
@@ -6088,6 +7390,18 @@ ST_FUNC void unary(TCCState *S)
 	break;
 #endif
 #endif
+#if defined TCC_TARGET_ARM64 || \
+    (defined TCC_TARGET_X86_64 && !defined TCC_TARGET_PE)
+    case TOK_builtin_va_arg: {
+	parse_builtin_params(S, 0, "et");
+	type = S->vtop->type;
+	vpop(S);
+        //xx check types
+        gen_va_arg(S, &type);
+        S->vtop->type = type;
+        break;
+    }
+#endif
 
 #ifdef TCC_TARGET_ARM64
     case TOK_builtin_va_start: {
@@ -6098,15 +7412,6 @@ ST_FUNC void unary(TCCState *S)
         S->vtop->type.t = VT_VOID;
         break;
     }
-    case TOK_builtin_va_arg: {
-	parse_builtin_params(S, 0, "et");
-	type = S->vtop->type;
-	vpop(S);
-        //xx check types
-        gen_va_arg(S, &type);
-        S->vtop->type = type;
-        break;
-    }
     case TOK___arm64_clear_cache: {
 	parse_builtin_params(S, 0, "ee");
         gen_clear_cache(S);
@@ -6142,6 +7447,16 @@ ST_FUNC void unary(TCCState *S)
         unary(S);
 	if (is_float(S->vtop->type.t)) {
             gen_opif(S, TOK_NEG);
+	} else if (IS_VECTOR(&S->vtop->type)
+                   && is_float(VECTOR_ELEM(&S->vtop->type)->t)) {
+            /* flip the sign bits, 0 - x would be wrong for 0.0 */
+            CType ct;
+            type = S->vtop->type;
+            vector_cmp_type(S, &ct, &type);
+            gen_cast(S, &ct);
+            vpushll(S, 1ULL << (type_size(VECTOR_ELEM(&ct), &align) * 8 - 1));
+            gen_op(S, '^');
+            gen_cast(S, &type);
 	} else {
             vpushi(S, 0);
             vswap(S);
@@ -6288,6 +7603,10 @@ special_math_val:
 
         if (r & VT_SYM) {
             S->vtop->c.i = 0;
+#ifdef CONFIG_TCC_TLS
+            if (s->a.tls)
+                tls_lvalue(S);
+#endif
         } else if (r == VT_CONST && IS_ENUM_VAL(s->type.t)) {
             S->vtop->c.i = s->enum_val;
         }
@@ -6315,7 +7634,7 @@ special_math_val:
             next(S);
             if (S->tok == TOK_CINT || S->tok == TOK_CUINT)
                 expect(S, "field name");
-	    s = find_field(&S->vtop->type, S->tok, &cumofs);
+	    s = find_field(S, &S->vtop->type, S->tok, &cumofs);
             if (!s)
                 tcc_error(S, "field not found: %s",  get_tok_str(S, S->tok & ~SYM_FIELD, &S->tokc));
             /* add field offset to pointer */
@@ -6337,6 +7656,17 @@ special_math_val:
             next(S);
         } else if (S->tok == '[') {
             next(S);
+            if (IS_VECTOR(&S->vtop->type)) {
+                /* vector element: index its address */
+                test_lvalue(S);
+                if (S->vtop->sym)
+                    S->vtop->sym->a.addrtaken = 1;
+                type = *VECTOR_ELEM(&S->vtop->type);
+                type.t |= S->vtop->type.t & (VT_CONSTANT | VT_VOLATILE);
+                mk_pointer(S, &type);
+                gaddrof(S);
+                S->vtop->type = type;
+            }
             gexpr(S);
             gen_op(S, '+');
             indir(S);
@@ -6363,6 +7693,8 @@ special_math_val:
             /* get return type */
             s = S->vtop->type.ref;
             next(S);
+            if (inline_call(S, s))
+                continue;
             sa = s->next; /* first parameter */
             nb_args = regsize = 0;
             ret.r2 = VT_CONST;
@@ -6424,11 +7756,18 @@ special_math_val:
             if (sa)
                 tcc_error(S, "too few arguments to function");
             skip(S, ')');
+#ifdef CONFIG_TCC_TAILCALL
+            if (tail_call && S->tok == ';' && !S->nocode_wanted)
+                S->tccgen_tail_call = tail_call_ok(S, &s->type);
+#endif
             gfunc_call(S, nb_args);
+            if (S->tccgen_tail_call == 2)
+                tail_call = 2; /* done, what follows is dead code */
+            S->tccgen_tail_call = 0;
 
             if (ret_nregs < 0) {
                 vsetc(S, &ret.type, ret.r, &ret.c);
-#ifdef TCC_TARGET_RISCV64
+#if defined TCC_TARGET_RISCV64 || defined TCC_TARGET_X86_64
                 arch_transfer_ret_regs(S, 1);
 #endif
             } else {
@@ -6476,7 +7815,7 @@ special_math_val:
 #endif
                 }
             }
-            if (s->f.func_noreturn) {
+            if (s->f.func_noreturn || tail_call == 2) {
                 if (S->tccgen_debug_modes)
 	            tcc_tcov_block_end (S, S->tccgen_tcov_data.line);
                 CODE_OFF();
@@ -6666,8 +8005,11 @@ static int condition_3way(TCCState *S)
 
 static void expr_landor(TCCState *S, int op)
 {
-    int t = 0, cc = 1, f = 0, i = op == TOK_LAND, c;
+    int t = 0, cc = 1, f = 0, i = op == TOK_LAND, c, e = vexpect(S), e2;
     for(;;) {
+        /* '&&' is likely if all operands are, unlikely if one is */
+        e2 = vexpect(S);
+        e = e == 2 - i || e2 == 2 - i ? 2 - i : e == e2 ? e : 0;
         c = f ? i : condition_3way(S);
         if (c < 0)
             save_regs(S, 1), cc = 0;
@@ -6689,6 +8031,7 @@ static void expr_landor(TCCState *S, int op)
         S->nocode_wanted -= f;
     } else {
         gvtst_set(S, i, t);
+        vset_expect(S, e);
     }
 }
 
@@ -6702,6 +8045,121 @@ static int is_cond_bool(SValue *sv)
     return 0;
 }
 
+#ifdef CONFIG_TCC_SELECT
+/* true if the token 't' is a constant or a scalar variable which can
+   be loaded without side effects, even when it is not selected */
+static int select_operand(TCCState *S, int t)
+{
+    Sym *s;
+    int bt, r;
+
+    if (t >= TOK_CCHAR && t <= TOK_CULONG)
+        return 1;
+    if (t < TOK_UIDENT || !(s = sym_find(S, t)) || IS_ASM_SYM(s))
+        return 0;
+    r = s->r & ~VT_LVAL;
+    if (r == VT_CONST && IS_ENUM_VAL(s->type.t))
+        return 1;
+    bt = s->type.t & VT_BTYPE;
+    return (r == VT_LOCAL || r == VT_REGVAR || r == (VT_CONST | VT_SYM))
+        && !(s->type.t & (VT_TYPEDEF | VT_VOLATILE | VT_VLA))
+        && !s->a.weak && !s->a.tls
+        && (bt == VT_BYTE || bt == VT_SHORT || bt == VT_INT
+            || bt == VT_LLONG || bt == VT_PTR || bt == VT_BOOL);
+}
+
+/* true if the '?:' whose condition is in vtop can be computed without
+   jumps, with its operands at the current token being simple enough
+   to be both evaluated: "c ? x : 1" for example */
+static int select_wanted(TCCState *S)
+{
+    TokenString *str;
+    int i, t, ok = 0, bt = S->vtop->type.t & VT_BTYPE;
+
+    if (!S->optimize || S->nocode_wanted || vexpect(S)
+#ifdef CONFIG_TCC_BCHECK
+        || S->do_bounds_check
+#endif
+        )
+        return 0;
+    if (S->vtop->r == VT_CMP
+        ? S->vtop->jtrue || S->vtop->jfalse
+        : bt != VT_BYTE && bt != VT_SHORT && bt != VT_INT
+          && bt != VT_LLONG && bt != VT_PTR && bt != VT_BOOL)
+        return 0;
+    /* look at "[-]x : [-]y" and the token after, then push them back */
+    str = tok_str_alloc(S);
+    for (i = 0; i < 2; i++) {
+        if (S->tok == '-') {
+            tok_str_add_tok(S, str);
+            next(S);
+            if (S->tok < TOK_CCHAR || S->tok > TOK_CULONG)
+                break;
+        }
+        t = S->tok;
+        tok_str_add_tok(S, str);
+        next(S);
+        if (!select_operand(S, t))
+            break;
+        t = S->tok;
+        if (i == 0) {
+            if (t != ':')
+                break;
+            tok_str_add_tok(S, str);
+            next(S);
+        } else {
+            ok = t == ')' || t == ';' || t == ',' || t == ']'
+                || t == '}' || t == ':';
+        }
+    }
+    tok_str_add(S, str, 0);
+    unget_tok(S, 0);
+    begin_macro(S, str, 1);
+    next(S);
+    return ok;
+}
+
+/* 'c ? x : y' with simple operands, see select_wanted() */
+static void expr_select(TCCState *S)
+{
+    SValue sv;
+    CType type;
+    int rc;
+#ifdef TCC_TARGET_X86_64
+    SValue cond;
+#endif
+
+    if (S->vtop->r != VT_CMP)
+        gen_test_zero(S, TOK_NE);
+#ifdef TCC_TARGET_X86_64
+    /* keep the cpu flags out of sight of vcheck_cmp() */
+    cond = *S->vtop--;
+#else
+    /* the condition as 0/1 in a register, kept on the value stack */
+    gv(S, RC_INT);
+#endif
+    gexpr(S);
+    sv = *S->vtop--;
+    skip(S, ':');
+    expr_cond(S);
+    if (!combine_types(S, &type, &sv, S->vtop, '?'))
+        type_incompatibility_error(S, &sv.type, &S->vtop->type,
+            "type mismatch in conditional expression (have '%s' and '%s')");
+    rc = RC_TYPE(S, type.t);
+    gen_cast(S, &type);
+    vpushv(S, &sv);
+    gen_cast(S, &type);
+    gv2(S, rc, rc);
+#ifdef TCC_TARGET_X86_64
+    gen_select(S, &cond);
+#else
+    gen_select(S, S->vtop - 2);
+    vswap(S);
+    vpop(S);
+#endif
+}
+#endif
+
 static void expr_cond(TCCState *S)
 {
     int tt, u, r1, r2, rc, t1, t2, islv, c, g;
@@ -6714,6 +8172,12 @@ static void expr_cond(TCCState *S)
         next(S);
 	c = condition_3way(S);
         g = (S->tok == ':' && gnu_ext);
+#ifdef CONFIG_TCC_SELECT
+        if (c < 0 && !g && select_wanted(S)) {
+            expr_select(S);
+            return;
+        }
+#endif
         tt = 0;
         if (!g) {
             if (c < 0) {
@@ -6792,7 +8256,7 @@ static void expr_cond(TCCState *S)
               gaddrof(S);
         }
 
-        rc = RC_TYPE(type.t);
+        rc = RC_TYPE(S, type.t);
         /* for long longs, we use fixed registers to avoid having
            to handle a complicated move */
         if (USING_TWO_WORDS(type.t))
@@ -6856,6 +8320,7 @@ ST_FUNC void gexpr(TCCState *S)
         if (S->tok != ',')
             break;
         vpop(S);
+        S->tccgen_expect = 0;
         next(S);
     }
 }
@@ -6906,7 +8371,7 @@ static void gfunc_return(TCCState *S, CType *func_type)
         ret_nregs = gfunc_sret(S, func_type, S->tccgen_func_var, &ret_type,
                                &ret_align, &regsize);
         if (ret_nregs < 0) {
-#ifdef TCC_TARGET_RISCV64
+#if defined TCC_TARGET_RISCV64 || defined TCC_TARGET_X86_64
             arch_transfer_ret_regs(S, 0);
 #endif
         } else if (0 == ret_nregs) {
@@ -7054,6 +8519,74 @@ static void gcase(TCCState *S, struct case_t **base, int len, int *bsym)
     *bsym = gjmp(S, *bsym);
 }
 
+#ifdef CONFIG_TCC_JMPTABLE
+/* switches with at least JMPTABLE_MIN_CASES cases which cover at least
+   1/JMPTABLE_DENSITY of their value range use a jump table */
+#define JMPTABLE_MIN_CASES 5
+#define JMPTABLE_DENSITY   3
+#define JMPTABLE_MAX_SIZE  0x4000
+
+/* dispatch through a table in rodata holding the case offsets relative
+   to the table start.  Return 0 if the switch is not dense enough. */
+static int gcase_table(TCCState *S, struct case_t **base, int len, int def_sym, int *bsym)
+{
+    int ll = (S->vtop->type.t & VT_BTYPE) == VT_LLONG;
+    uint64_t mask = ll ? ~(uint64_t)0 : 0xffffffff;
+    uint64_t lo, span, i, j, k;
+    unsigned long tab;
+    int *targets, dflt;
+    Sym *tsym, *csym;
+
+    if (len < JMPTABLE_MIN_CASES || S->nocode_wanted)
+        return 0;
+    lo = base[0]->v1;
+    span = (base[len - 1]->v2 - lo) & mask;
+    if (span >= (uint64_t)len * JMPTABLE_DENSITY || span >= JMPTABLE_MAX_SIZE)
+        return 0;
+    for (i = 0; i < len; ++i)
+        if (((base[i]->v1 - lo) & mask) > ((base[i]->v2 - lo) & mask)
+            || ((base[i]->v2 - lo) & mask) > span)
+            return 0;
+
+    /* index = value - lo, out of range values go to default */
+    vdup(S);
+    gen_cast_s(S, ll ? VT_LLONG | VT_UNSIGNED : VT_INT | VT_UNSIGNED);
+    if (lo) {
+        vpush64(S, S->vtop->type.t, lo);
+        gen_op(S, '-');
+    }
+    vdup(S);
+    vpush64(S, S->vtop->type.t, span);
+    gen_op(S, TOK_UGT);
+    *bsym = gvtst(S, 0, *bsym);
+    gen_cast_s(S, VT_SIZE_T);
+
+    tab = section_add(S, rodata_section, (span + 1) * 4, 4);
+    tsym = get_sym_ref(S, &S->char_pointer_type, rodata_section, tab, (span + 1) * 4);
+    gen_jmptable(S, tsym);
+    if (def_sym) {
+        dflt = def_sym;
+        CODE_OFF();
+    } else {
+        dflt = S->ind;
+        *bsym = gjmp(S, *bsym);
+    }
+
+    targets = tcc_malloc(S, (span + 1) * sizeof (int));
+    for (i = 0; i <= span; ++i)
+        targets[i] = dflt;
+    for (i = 0; i < len; ++i)
+        for (j = (base[i]->v1 - lo) & mask, k = (base[i]->v2 - lo) & mask; j <= k; ++j)
+            targets[j] = base[i]->sym;
+    /* entry = target - &entry + 4 * index, i.e. target - table */
+    csym = get_sym_ref(S, &S->char_pointer_type, cur_text_section, 0, 0);
+    for (i = 0; i <= span; ++i)
+        greloca(S, rodata_section, csym, tab + 4 * i, R_DATA_PC32, targets[i] + 4 * i);
+    tcc_free(S, targets);
+    return 1;
+}
+#endif
+
 /* ------------------------------------------------------------------------- */
 /* __attribute__((cleanup(fn))) */
 
@@ -7140,6 +8673,264 @@ static void vla_leave(TCCState * S, scope_t *o)
       vla_restore(S, v->vla.locorig);
 }
 
+#if defined CONFIG_TCC_REGVARS || defined CONFIG_TCC_TAILCALL
+#define CONFIG_TCC_BODY_SCAN
+/* ------------------------------------------------------------------------- */
+/* register variables and tail calls (-O1)
+
+   Before code is generated, the saved tokens of a function body are
+   scanned once: every identifier gets a use count weighted by loop
+   nesting, and identifiers whose address is taken are excluded.
+   Scalar locals and parameters with enough uses are then kept in one
+   of the callee saved registers regvar_regs[] of the target instead of
+   a stack slot, for their whole scope.  The scan also tells whether
+   'return f(...);' may release the stack frame before jumping to f. */
+
+#define REGVAR_MIN_WEIGHT 3 /* weighted uses needed to get a register */
+#define REGVAR_MAX_LOOPS 16 /* loop nesting followed by the scan */
+
+static RegvarCand *regvar_cand(TCCState *S, int v, int add)
+{
+    RegvarCand *rc, *old;
+    int i, old_size;
+    unsigned h;
+
+    if (add && 2 * S->tccgen_nb_regvar_cand >= S->tccgen_regvar_cand_size) {
+        old = S->tccgen_regvar_cand;
+        old_size = S->tccgen_regvar_cand_size;
+        S->tccgen_regvar_cand_size = old_size ? old_size * 2 : 64;
+        S->tccgen_regvar_cand = tcc_mallocz(S,
+            S->tccgen_regvar_cand_size * sizeof *rc);
+        S->tccgen_nb_regvar_cand = 0;
+        for (i = 0; i < old_size; ++i)
+            if (old[i].v)
+                regvar_cand(S, old[i].v, 1)->weight = old[i].weight;
+        tcc_free(S, old);
+    }
+    if (!S->tccgen_regvar_cand_size)
+        return NULL;
+    for (h = v * 0x9E3779B1u;; ++h) {
+        rc = &S->tccgen_regvar_cand[h & (S->tccgen_regvar_cand_size - 1)];
+        if (rc->v == v)
+            return rc;
+        if (rc->v == 0) {
+            if (!add)
+                return NULL;
+            rc->v = v;
+            S->tccgen_nb_regvar_cand++;
+            return rc;
+        }
+    }
+}
+
+/* scan the tokens of a function body and return the number of
+   registers worth reserving for it */
+static int regvar_scan(TCCState *S, TokenString *func_str)
+{
+    /* state: 0 before the header of a for/while, 1 in the header,
+       2 before the body, 3 in a { } body, 4 in a single statement */
+    struct { int level, state; } loop[REGVAR_MAX_LOOPS];
+    int nl = 0, level = 0, amp = 0, prev = 0, t;
+#ifdef CONFIG_TCC_REGVARS
+    int n = 0, i;
+#endif
+    /* parentheses of if/for/while/switch: a ')' '{' which closes
+       another one starts a compound literal */
+    unsigned ctl = 0, ctl_closed = 0;
+    int np = 0;
+    RegvarCand *rc;
+    const char *name;
+
+    if (S->tccgen_regvar_cand)
+        memset(S->tccgen_regvar_cand, 0,
+               S->tccgen_regvar_cand_size * sizeof *rc);
+    S->tccgen_nb_regvar_cand = 0;
+    S->tccgen_tail_ok = 1;
+
+    begin_macro(S, func_str, 0);
+    for (next(S); (t = S->tok) != TOK_EOF; prev = t, next(S)) {
+        if (t == TOK_ASM1 || t == TOK_ASM2 || t == TOK_ASM3)
+            goto fail;
+        if (t == TOK_GOTO || (t == '{' && prev == ')' && !ctl_closed))
+            S->tccgen_tail_ok = 0;
+        if (nl && loop[nl - 1].state == 2)
+            loop[nl - 1].state = t == '{' ? 3 : 4;
+        if (t == '(') {
+            if (np < 32)
+                ctl = (ctl & ~(1u << np)) | (unsigned)(prev == TOK_IF
+                    || prev == TOK_FOR || prev == TOK_WHILE
+                    || prev == TOK_SWITCH) << np;
+            ++np;
+        } else if (t == ')' && np) {
+            --np;
+            ctl_closed = np < 32 && (ctl >> np & 1);
+        }
+        if (t == '(' || t == '[' || t == '{') {
+            if (nl && loop[nl - 1].state == 0)
+                loop[nl - 1].state = 1;
+            ++level;
+        } else if (t == ')' || t == ']' || t == '}' || t == ';') {
+            if (t != ';')
+                --level;
+            if (nl && level == loop[nl - 1].level) {
+                if (loop[nl - 1].state == 1) {
+                    loop[nl - 1].state = 2;
+                } else if (loop[nl - 1].state == (t == ';' ? 4 : 3)) {
+                    /* end of the body, and of the bodies which
+                       consisted of this loop alone */
+                    while (--nl && loop[nl - 1].state == 4
+                           && loop[nl - 1].level == level)
+                        ;
+                }
+            }
+        } else if (t == TOK_FOR || t == TOK_WHILE || t == TOK_DO) {
+            if (nl < REGVAR_MAX_LOOPS) {
+                loop[nl].level = level;
+                loop[nl++].state = t == TOK_DO ? 2 : 0;
+            }
+        } else if (t >= TOK_UIDENT) {
+            rc = regvar_cand(S, t, 1);
+            if (rc->weight == 0) {
+                name = get_tok_str(S, t, NULL);
+                if (strstr(name, "setjmp") || !strcmp(name, "vfork"))
+                    goto fail;
+                if (strstr(name, "alloca"))
+                    S->tccgen_tail_ok = 0;
+            }
+            if (amp)
+                rc->weight = -1;
+            else if (rc->weight >= 0)
+                rc->weight += 1 << 3 * (nl < 3 ? nl : 3);
+        }
+        /* '&' is unary unless it follows an operand, and ')' might
+           end a cast */
+        if (t == '&')
+            amp = !(prev >= TOK_UIDENT || prev == ']'
+                    || prev == TOK_INC || prev == TOK_DEC
+                    || (prev >= TOK_CCHAR && prev <= TOK_PPNUM));
+        else if (t != '(')
+            amp = 0;
+    }
+    end_macro(S);
+#ifdef CONFIG_TCC_REGVARS
+    for (i = 0; i < S->tccgen_regvar_cand_size; ++i)
+        if (S->tccgen_regvar_cand[i].weight >= REGVAR_MIN_WEIGHT)
+            ++n;
+    return n < NB_REGVARS ? n : NB_REGVARS;
+#else
+    return 0;
+#endif
+ fail:
+    end_macro(S);
+    S->tccgen_tail_ok = 0;
+    return 0;
+}
+
+static int regvar_wanted(TCCState *S)
+{
+#ifdef CONFIG_TCC_BCHECK
+    if (S->do_bounds_check)
+        return 0;
+#endif
+    return S->optimize > 0;
+}
+
+/* generate the function 'sym' whose body starts at the current token,
+   after scanning it */
+static void gen_function_regvars(TCCState *S, Sym *sym)
+{
+    TokenString *func_str;
+
+    skip_or_save_block(S, &func_str);
+    unget_tok(S, 0);
+    S->tccgen_regvar_nb = regvar_scan(S, func_str);
+    begin_macro(S, func_str, 1);
+    next(S);
+    gen_function(S, sym);
+    end_macro(S);
+    next(S);
+}
+#endif
+
+#ifdef CONFIG_TCC_REGVARS
+/* return a register for variable 'v' of type 'type' or -1 */
+static int regvar_alloc(TCCState *S, int v, CType *type)
+{
+    int bt = type->t & VT_BTYPE, i;
+    RegvarCand *rc;
+
+    if (!S->tccgen_regvar_nb
+        || (type->t & (VT_ARRAY | VT_VLA | VT_VOLATILE | VT_BITFIELD))
+        || (bt != VT_INT && bt != VT_LLONG && bt != VT_PTR))
+        return -1;
+    rc = regvar_cand(S, v, 0);
+    if (!rc || rc->weight < REGVAR_MIN_WEIGHT)
+        return -1;
+    for (i = 0; i < S->tccgen_regvar_nb; ++i)
+        if (!(S->tccgen_regvar_used & (1 << i))) {
+            S->tccgen_regvar_used |= 1 << i;
+            S->tccgen_regvar_saved |= 1 << i;
+            return regvar_regs[i];
+        }
+    return -1;
+}
+
+/* move the parameters declared by gfunc_prolog() to registers */
+static void regvar_params(TCCState *S)
+{
+    Sym *s;
+    CType type;
+    int reg;
+
+    for (s = S->local_stack; s && s->v != SYM_FIELD; s = s->prev) {
+        if (s->r != (VT_LOCAL | VT_LVAL))
+            continue;
+        reg = regvar_alloc(S, s->v, &s->type);
+        if (reg < 0)
+            continue;
+        type = s->type;
+        type.t &= ~VT_CONSTANT;
+        vset(S, &type, VT_REGVAR | VT_LVAL, reg);
+        vset(S, &type, s->r, s->c);
+        vstore(S);
+        vpop(S);
+        s->r = VT_REGVAR | VT_LVAL;
+        s->c = reg;
+    }
+}
+#endif
+
+#ifdef CONFIG_TCC_TAILCALL
+/* can 'return f(...);' leave the function before calling f: the call
+   result needs no conversion, and no object of the frame which is
+   still alive may be seen by f */
+static int tail_call_ok(TCCState *S, CType *ret)
+{
+    int t1 = ret->t & VT_BTYPE, t2 = S->tccgen_func_vt.t & VT_BTYPE;
+    RegvarCand *rc;
+    Sym *s;
+
+    if (t1 != t2 || (t1 != VT_VOID && t1 != VT_INT && t1 != VT_LLONG
+                     && t1 != VT_PTR && t1 != VT_FLOAT && t1 != VT_DOUBLE))
+        return 0;
+    if (S->tccgen_cur_scope->cl.s)
+        return 0; /* cleanups run after the call */
+    for (s = S->local_stack; s; s = s->prev) {
+        if ((s->v & (SYM_STRUCT | SYM_FIELD)) || (s->type.t & VT_TYPEDEF)
+            || ((s->r & VT_VALMASK) != VT_LOCAL
+                && (s->r & VT_VALMASK) != VT_LLOCAL))
+            continue;
+        if ((s->type.t & (VT_ARRAY | VT_VLA))
+            || (s->type.t & VT_BTYPE) == VT_STRUCT)
+            return 0;
+        rc = regvar_cand(S, s->v, 0);
+        if (rc && rc->weight < 0)
+            return 0;
+    }
+    return 1;
+}
+#endif
+
 /* ------------------------------------------------------------------------- */
 /* local scopes */
 
@@ -7155,6 +8946,7 @@ static void new_scope(TCCState *S, scope_t *o)
     o->lstk = S->local_stack;
     o->llstk = S->local_label_stack;
     ++S->local_scope;
+    o->regvars = S->tccgen_regvar_used;
 
     if (S->tccgen_debug_modes)
         tcc_debug_stabn(S, N_LBRAC, S->ind - S->tccgen_func_ind);
@@ -7180,6 +8972,10 @@ static void prev_scope(TCCState *S, scope_t *o, int is_expr)
 
     /* pop locally defined symbols */
     pop_local_syms(S, o->lstk, is_expr);
+    /* release registers of variables of this scope, except for
+       statement expressions as above */
+    if (!is_expr)
+        S->tccgen_regvar_used = o->regvars;
     S->tccgen_cur_scope = o->prev;
     --S->local_scope;
 
@@ -7196,6 +8992,214 @@ static void leave_scope(TCCState *S, scope_t *o)
     vla_leave(S, o);
 }
 
+/* ------------------------------------------------------------------------- */
+/* call site inlining of small static inline functions */
+
+#define INLINE_MAX_LEN   192 /* saved body size, in token string words */
+#define INLINE_MAX_ARGS  8
+#define INLINE_MAX_DEPTH 3
+
+/* check that the body can be replayed inside another function: no
+   statics, labels, asm or anything depending on the own frame */
+static int inline_scan(TCCState *S, TokenString *func_str)
+{
+    int t, prev = 0, prev2 = 0;
+    const char *name;
+
+    unget_tok(S, 0);
+    begin_macro(S, func_str, 0);
+    for (next(S); (t = S->tok) != TOK_EOF; prev2 = prev, prev = t, next(S)) {
+        if (t == TOK_STATIC || t == TOK_GOTO || t == TOK_LABEL
+            || t == TOK_ASM1 || t == TOK_ASM2 || t == TOK_ASM3
+            || t == TOK___FUNCTION__ || t == TOK___FUNC__
+            || t == TOK_builtin_frame_address
+            || t == TOK_builtin_return_address)
+            break;
+        if (t >= TOK_UIDENT) {
+            name = get_tok_str(S, t, NULL);
+            if (strstr(name, "setjmp") || strstr(name, "alloca")
+                || !strcmp(name, "vfork"))
+                break;
+        }
+        /* labels are per function */
+        if (t == ':' && prev >= TOK_UIDENT
+            && (prev2 == ';' || prev2 == '{' || prev2 == '}' || prev2 == ')'
+                || prev2 == TOK_ELSE || prev2 == TOK_DO))
+            break;
+    }
+    end_macro(S);
+    next(S);
+    return t == TOK_EOF;
+}
+
+static Sym **sym_ident_ptr(TCCState *S, Sym *s)
+{
+    int v = s->v;
+    TokenSym *ts;
+
+    if ((v & SYM_FIELD) || (v & ~SYM_STRUCT) >= SYM_FIRST_ANOM)
+        return NULL;
+    ts = S->tccpp_table_ident[(v & ~SYM_STRUCT) - TOK_IDENT];
+    return v & SYM_STRUCT ? &ts->sym_struct : &ts->sym_identifier;
+}
+
+/* The function on vtop, of type 's', is called with its arguments
+   following.  If it is a small static inline function, evaluate the
+   arguments into fresh locals and parse its saved body right here
+   instead of calling it.  Return 0 to generate a normal call. */
+static int inline_call(TCCState *S, Sym *s)
+{
+    InlineFunc *fn;
+    TokenString *str;
+    Sym *sym, *sa, *l, **ps, **hidden = NULL;
+    scope_t o, *saved_root_scope;
+    switch_t *saved_switch;
+    CType saved_vt, type;
+    int addr[INLINE_MAX_ARGS], n, i, size, align, nb_hidden = 0;
+    int saved_rsym, saved_level, saved_ret, saved_regvar_nb;
+    int saved_nocode_wanted;
+    char *saved_filename = NULL;
+
+    if (!S->optimize || S->nocode_wanted || S->tccgen_const_wanted
+        || S->test_coverage
+        || S->tccgen_inline_depth >= INLINE_MAX_DEPTH
+        || (S->vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) != (VT_CONST | VT_SYM)
+        || S->vtop->c.i != 0
+        || s->f.func_type != FUNC_NEW)
+        return 0;
+#ifdef CONFIG_TCC_BCHECK
+    if (S->do_bounds_check)
+        return 0;
+#endif
+    sym = S->vtop->sym;
+    if ((sym->type.t & (VT_STATIC | VT_INLINE)) != (VT_STATIC | VT_INLINE))
+        return 0;
+    for (n = 0, sa = s->next; sa; sa = sa->next)
+        if (++n > INLINE_MAX_ARGS)
+            return 0;
+    for (i = S->nb_inline_fns; --i >= 0;)
+        if (S->inline_fns[i]->sym == sym)
+            break;
+    if (i < 0)
+        return 0;
+    fn = S->inline_fns[i];
+    if (fn->func_str->len > INLINE_MAX_LEN)
+        return 0;
+    if (!fn->inline_ok)
+        fn->inline_ok = inline_scan(S, fn->func_str) ? 1 : -1;
+    if (fn->inline_ok < 0)
+        return 0;
+
+    /* arguments */
+    vpop(S);
+    for (i = 0, sa = s->next; sa; ++i, sa = sa->next) {
+        if (S->tok == ')')
+            tcc_error(S, "too few arguments to function");
+        if (i)
+            skip(S, ',');
+        expr_eq(S);
+        type = sa->type;
+        type.t &= ~VT_CONSTANT;
+        gen_assign_cast(S, &type);
+        size = type_size(&type, &align);
+        S->loc = (S->loc - size) & -align;
+        addr[i] = S->loc;
+        vset(S, &type, VT_LOCAL | VT_LVAL, addr[i]);
+        vswap(S);
+        vstore(S);
+        vpop(S);
+    }
+    if (S->tok == ',')
+        tcc_error(S, "too many arguments to function");
+    skip(S, ')');
+    save_regs(S, 0);
+
+    /* replay the body with the locals of the caller out of sight.  Its
+       line numbers are those of the file defining the function. */
+    if (strcmp(S->tccpp_file->filename, fn->filename)) {
+        saved_filename = tcc_strdup(S, S->tccpp_file->filename);
+        tcc_debug_putfile(S, fn->filename);
+    }
+    unget_tok(S, 0);
+    str = tok_str_alloc(S);
+    str->str = fn->func_str->str;
+    str->len = fn->func_str->len;
+    begin_macro(S, str, 2);
+    next(S);
+    for (l = S->local_stack; l; l = l->prev) {
+        ps = sym_ident_ptr(S, l);
+        if (ps && *ps == l) {
+            *ps = l->prev_tok;
+            dynarray_add(S, &hidden, &nb_hidden, l);
+        }
+    }
+    new_scope(S, &o);
+    o.bsym = o.csym = NULL;
+    ++S->local_scope;
+    for (i = 0, sa = s->next; sa; ++i, sa = sa->next)
+        sym_push(S, sa->v & ~SYM_FIELD, &sa->type, VT_LOCAL | VT_LVAL, addr[i]);
+    --S->local_scope;
+
+    saved_vt = S->tccgen_func_vt;
+    saved_root_scope = S->tccgen_root_scope;
+    saved_switch = S->tccgen_cur_switch;
+    saved_rsym = S->tccgen_rsym;
+    saved_level = S->tccgen_inline_level;
+    saved_ret = S->tccgen_inline_ret;
+    saved_regvar_nb = S->tccgen_regvar_nb;
+    saved_nocode_wanted = S->nocode_wanted;
+    S->tccgen_func_vt = s->type;
+    S->tccgen_func_vt.t &= ~(VT_CONSTANT | VT_VOLATILE);
+    if ((s->type.t & VT_BTYPE) != VT_VOID) {
+        size = type_size(&s->type, &align);
+        S->loc = (S->loc - size) & -align;
+        S->tccgen_inline_ret = S->loc;
+    }
+    S->tccgen_root_scope = &o;
+    S->tccgen_cur_switch = NULL;
+    S->tccgen_rsym = 0;
+    S->tccgen_inline_level = S->local_scope + 1;
+    /* register variables are allocated from the scan of the caller */
+    S->tccgen_regvar_nb = 0;
+    ++S->tccgen_inline_depth;
+
+    block(S, 0);
+    gsym(S, S->tccgen_rsym);
+
+    --S->tccgen_inline_depth;
+    S->nocode_wanted = saved_nocode_wanted;
+    type = S->tccgen_func_vt;
+    S->tccgen_func_vt = saved_vt;
+    S->tccgen_root_scope = saved_root_scope;
+    S->tccgen_cur_switch = saved_switch;
+    S->tccgen_rsym = saved_rsym;
+    S->tccgen_inline_level = saved_level;
+    S->tccgen_regvar_nb = saved_regvar_nb;
+    prev_scope(S, &o, 0);
+    for (i = nb_hidden; --i >= 0;)
+        *sym_ident_ptr(S, hidden[i]) = hidden[i];
+    tcc_free(S, hidden);
+    end_macro(S);
+    if (saved_filename) {
+        tcc_debug_putfile(S, saved_filename);
+        tcc_free(S, saved_filename);
+    }
+    next(S);
+    if (S->tccgen_debug_modes)
+        tcc_debug_line(S);
+
+    /* result */
+    if ((type.t & VT_BTYPE) == VT_VOID) {
+        vpush(S, &type);
+    } else {
+        vset(S, &type, VT_LOCAL | VT_LVAL, S->tccgen_inline_ret);
+        if ((type.t & VT_BTYPE) != VT_STRUCT)
+            gv(S, RC_TYPE(S, type.t));
+    }
+    S->tccgen_inline_ret = saved_ret;
+    return 1;
+}
+
 /* ------------------------------------------------------------------------- */
 /* call block from 'for do while' loops */
 
@@ -7216,12 +9220,147 @@ static void lblock(TCCState *S, int *bsym, int *csym)
     }
 }
 
+/* With -O, an 'if' in a compound statement whose test has a hint from
+   __builtin_expect() gets its unlikely branch compiled at the end of
+   the compound statement, so that the likely path falls through.
+   Return the hint if this is wanted for the test on the stack. */
+static int cold_wanted(TCCState *S)
+{
+    if (!S->optimize || S->tccgen_debug_modes || S->nocode_wanted
+        || S->vtop != vstack || condition_3way(S) >= 0)
+        return 0;
+    return vexpect(S);
+}
+
+/* save the tokens of the statement at the current token if it can be
+   compiled elsewhere.  Set '*noflow' if it surely ends with a jump. */
+static TokenString *cold_save(TCCState *S, int *noflow)
+{
+    TokenString *str;
+    int t = S->tok, level = 0, n = 0, base = t == '{', first = 1;
+
+    if (t == TOK_IF || t == TOK_FOR || t == TOK_WHILE || t == TOK_DO
+        || t == TOK_SWITCH || t == TOK_CASE || t == TOK_DEFAULT)
+        return NULL;
+    *noflow = 0;
+    str = tok_str_alloc(S);
+    do {
+        t = S->tok;
+        if (t == TOK_EOF)
+            tcc_error(S, "unexpected end of file");
+        tok_str_add_tok(S, str);
+        next(S);
+        if (n++ == 0 && t >= TOK_UIDENT && S->tok == ':') {
+            /* a label: push the tokens back */
+            tok_str_add(S, str, 0);
+            unget_tok(S, 0);
+            begin_macro(S, str, 1);
+            next(S);
+            return NULL;
+        }
+        if (level == base && first && t != '}')
+            *noflow = t == TOK_RETURN || t == TOK_GOTO
+                || t == TOK_BREAK || t == TOK_CONTINUE;
+        if (t == '{' || t == '(' || t == '[')
+            first = ++level == base && t == '{';
+        else if (t == '}' || t == ')' || t == ']')
+            first = --level == base && t == '}';
+        else
+            first = level == base && t == ';';
+    } while (level > 0 || (t != ';' && t != '}'));
+    tok_str_add(S, str, -1);
+    tok_str_add(S, str, 0);
+    return str;
+}
+
+/* remember the statement 'str', jumped to by 'jmp', for cold_flush() */
+static void cold_push(TCCState *S, TokenString *str, int jmp)
+{
+    cold_t *cb = tcc_malloc(S, sizeof *cb);
+
+    cb->str = str;
+    cb->jmp = jmp;
+    cb->join = -1;
+    cb->scope = S->tccgen_cur_scope;
+    cb->sc = *S->tccgen_cur_scope;
+    cb->lstk = S->local_stack;
+    cb->prev = S->tccgen_cold;
+    S->tccgen_cold = cb;
+}
+
+/* set the point where the last pushed statement resumes, unless
+   neither branch of its 'if' gets there */
+static void cold_join(TCCState *S, int noflow)
+{
+    if (!S->nocode_wanted || !noflow)
+        S->tccgen_cold->join = gind(S);
+}
+
+/* compile the unlikely statements of the current compound statement,
+   each in the scope state of its 'if' and jumping back after it */
+static void cold_flush(TCCState *S)
+{
+    cold_t *cb, *list = NULL;
+    scope_t sc;
+    Sym **hidden = NULL, *l, **ps;
+    int nb_hidden = 0, over = 0, i;
+
+    while ((cb = S->tccgen_cold) && cb->scope == S->tccgen_cur_scope) {
+        S->tccgen_cold = cb->prev;
+        cb->prev = list;
+        list = cb;
+    }
+    if (!list)
+        return;
+    if (!S->nocode_wanted)
+        over = gjmp(S, 0);
+    sc = *S->tccgen_cur_scope;
+    while ((cb = list) != NULL) {
+        list = cb->prev;
+        *S->tccgen_cur_scope = cb->sc;
+        /* the symbols declared after the 'if' are out of sight */
+        for (l = S->local_stack; l != cb->lstk; l = l->prev) {
+            ps = sym_ident_ptr(S, l);
+            if (ps && *ps == l) {
+                *ps = l->prev_tok;
+                dynarray_add(S, &hidden, &nb_hidden, l);
+            }
+        }
+        gsym(S, cb->jmp);
+        unget_tok(S, 0);
+        begin_macro(S, cb->str, 1);
+        next(S);
+        block(S, 0);
+        end_macro(S);
+        next(S);
+        if (!S->nocode_wanted && cb->join >= 0)
+            gjmp_addr(S, cb->join);
+        for (i = nb_hidden; --i >= 0;)
+            *sym_ident_ptr(S, hidden[i]) = hidden[i];
+        tcc_free(S, hidden);
+        hidden = NULL, nb_hidden = 0;
+        tcc_free(S, cb);
+    }
+    *S->tccgen_cur_scope = sc;
+    if (over && S->nocode_wanted) {
+        /* the unlikely code ends in a jump: nothing falls through to
+           here, see gjmp_acs() */
+        S->tccgen_cold_over_ind = gind(S);
+        S->tccgen_cold_over = over;
+    } else
+        gsym(S, over);
+}
+
 static void block(TCCState *S, int is_expr)
 {
-    int a, b, c, d, e, t;
+    int a, b, c, d, e, t, f;
     scope_t o;
     Sym *s;
+    TokenString *str;
+    /* a statement of a compound statement */
+    int in_compound = S->tccgen_cold_scope == S->tccgen_cur_scope;
 
+    S->tccgen_cold_scope = NULL;
     if (is_expr) {
         /* default return value is (void) */
         vpushi(S, 0);
@@ -7241,22 +9380,40 @@ again:
 
     if (t == TOK_IF) {
         skip(S, '(');
+        S->tccgen_expect = 0;
         gexpr(S);
         skip(S, ')');
-        a = gvtst(S, 1, 0);
-        block(S, 0);
-        if (S->tok == TOK_ELSE) {
-            d = gjmp(S, 0);
-            gsym(S, a);
-            next(S);
-            block(S, 0);
-            gsym(S, d); /* patch else jmp */
+        e = in_compound ? cold_wanted(S) : 0;
+        if (e == 1 && (str = cold_save(S, &f)) != NULL) {
+            /* unlikely: the else branch, if any, falls through */
+            a = gvtst(S, 0, 0);
+            cold_push(S, str, a);
+            if (S->tok == TOK_ELSE) {
+                next(S);
+                block(S, 0);
+            }
+            cold_join(S, f);
         } else {
-            gsym(S, a);
+            a = gvtst(S, 1, 0);
+            block(S, 0);
+            if (S->tok == TOK_ELSE) {
+                next(S);
+                if (e == 2 && (str = cold_save(S, &f)) != NULL) {
+                    cold_push(S, str, a);
+                    cold_join(S, f);
+                } else {
+                    d = gjmp(S, 0);
+                    gsym(S, a);
+                    block(S, 0);
+                    gsym(S, d); /* patch else jmp */
+                }
+            } else {
+                gsym(S, a);
+            }
         }
 
     } else if (t == TOK_WHILE) {
-        d = gind(S);
+        d = gind_loop(S);
         skip(S, '(');
         gexpr(S);
         skip(S, ')');
@@ -7287,10 +9444,12 @@ again:
             if (S->tok != '}') {
                 if (is_expr)
                     vpop(S);
+                S->tccgen_cold_scope = S->tccgen_cur_scope;
                 block(S, is_expr);
             }
         }
 
+        cold_flush(S);
         prev_scope(S, &o, is_expr);
         if (S->local_scope)
             next(S);
@@ -7300,6 +9459,11 @@ again:
     } else if (t == TOK_RETURN) {
         b = (S->tccgen_func_vt.t & VT_BTYPE) != VT_VOID;
         if (S->tok != ';') {
+#ifdef CONFIG_TCC_TAILCALL
+            /* seen by the unary() of the returned expression */
+            S->tccgen_tail_call = S->tccgen_tail_ok
+                && !S->tccgen_inline_level && !(S->tccgen_debug_modes & 2);
+#endif
             gexpr(S);
             if (b) {
                 gen_assign_cast(S, &S->tccgen_func_vt);
@@ -7313,11 +9477,18 @@ again:
             b = 0;
         }
         leave_scope(S, S->tccgen_root_scope);
-        if (b)
+        if (b && S->tccgen_inline_level) {
+            vset(S, &S->tccgen_func_vt, VT_LOCAL | VT_LVAL, S->tccgen_inline_ret);
+            vswap(S);
+            vstore(S);
+            vpop(S);
+        } else if (b)
             gfunc_return(S, &S->tccgen_func_vt);
         skip(S, ';');
         /* jump unless last stmt in top-level block */
-        if (S->tok != '}' || S->local_scope != 1)
+        if (S->tok != '}' || S->local_scope != (S->tccgen_inline_level
+                                                ? S->tccgen_inline_level : 1)
+            || S->tccgen_cold)
             S->tccgen_rsym = gjmp(S, S->tccgen_rsym);
         if (S->tccgen_debug_modes)
 	    tcc_tcov_block_end (S, S->tccgen_tcov_data.line);
@@ -7356,7 +9527,7 @@ again:
         }
         skip(S, ';');
         a = b = 0;
-        c = d = gind(S);
+        c = d = gind_loop(S);
         if (S->tok != ';') {
             gexpr(S);
             a = gvtst(S, 1, 0);
@@ -7379,7 +9550,7 @@ again:
 
     } else if (t == TOK_DO) {
         a = b = 0;
-        d = gind(S);
+        d = gind_loop(S);
         lblock(S, &a, &b);
         gsym(S, b);
         skip(S, TOK_WHILE);
@@ -7425,7 +9596,11 @@ again:
 
         vpushv(S, &sw->sv);
         gv(S, RC_INT);
-        d = 0, gcase(S, sw->p, sw->n, &d);
+        d = 0;
+#ifdef CONFIG_TCC_JMPTABLE
+        if (!gcase_table(S, sw->p, sw->n, sw->def_sym, &d))
+#endif
+            gcase(S, sw->p, sw->n, &d);
         vpop(S);
         if (sw->def_sym)
             gsym_addr(S, d, sw->def_sym);
@@ -7645,6 +9820,11 @@ static void init_putz(TCCState *S, init_params *p, unsigned long c, int size)
     init_assert(S, p, c + size);
     if (p->sec) {
         /* nothing to do because globals are already set to zero */
+#ifdef STRUCT_INLINE_MAX
+    } else if (size <= STRUCT_INLINE_MAX) {
+        vseti(S, VT_LOCAL, c);
+        gen_struct_clear(S, size);
+#endif
     } else {
         vpush_helper_func(S, TOK_memset);
         vseti(S, VT_LOCAL, c);
@@ -7751,7 +9931,7 @@ static int decl_designator(TCCState *S, init_params *p, CType *type, unsigned lo
             if ((type->t & VT_BTYPE) != VT_STRUCT)
                 expect(S, "struct/union type");
             cumofs = 0;
-	    f = find_field(type, l, &cumofs);
+	    f = find_field(S, type, l, &cumofs);
             if (!f)
                 expect(S, "field");
             if (cur_field)
@@ -7992,6 +10172,12 @@ static void init_putv(TCCState *S, init_params *p, CType *type, unsigned long c)
             case VT_INT:
                 write32le(ptr, val);
                 break;
+#ifdef CONFIG_TCC_INT128
+            case VT_QLONG:
+                write64le(ptr, val);
+                write64le(ptr + 8, S->vtop->c.q[1]);
+                break;
+#endif
 #else
 	    case VT_LLONG:
                 write64le(ptr, val);
@@ -8220,6 +10406,47 @@ static void decl_initializer(TCCState *S, init_params *p, CType *type, unsigned
     }
 }
 
+/* a section of its own for the definition of 'v' (-ffunction-sections,
+   -fdata-sections), such that the linker can drop it if unused */
+static Section *sym_section(TCCState *S, Section *sec, int v)
+{
+    char buf[256];
+    Section *s;
+
+    snprintf(buf, sizeof buf, "%s.%s", sec->name, get_tok_str(S, v, NULL));
+    s = new_section(S, buf, sec->sh_type, sec->sh_flags);
+    /* only as aligned as its contents, so that merging the sections
+       again in the linker adds no padding */
+    s->sh_addralign = 1;
+    return s;
+}
+
+/* the section for thread-local variables, .tdata or .tbss */
+static Section *tls_section(TCCState *S, int has_init)
+{
+    const char *name = has_init ? ".tdata" : ".tbss";
+    Section *sec = find_section_create(S, name, 0);
+
+    if (!sec)
+        sec = new_section(S, name, has_init ? SHT_PROGBITS : SHT_NOBITS,
+                          SHF_ALLOC | SHF_WRITE | SHF_TLS);
+    return sec;
+}
+
+/* the section for the code of function 'sym', cold and hot functions
+   are grouped apart from the others */
+static Section *func_section(TCCState *S, Sym *sym)
+{
+    Section *sec = text_section;
+
+    if (sym->type.ref->f.func_cold || sym->type.ref->f.func_hot) {
+        sec = find_section(S, sym->type.ref->f.func_cold
+                           ? ".text.unlikely" : ".text.hot");
+        sec->sh_flags |= SHF_EXECINSTR;
+    }
+    return S->function_sections ? sym_section(S, sec, sym->v) : sec;
+}
+
 /* parse an initializer for type 't' if 'has_init' is non zero, and
    allocate space in local or global data space ('r' is either
    VT_LOCAL or VT_CONST). If 'v' is non zero, then an associated
@@ -8238,7 +10465,7 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
     Sym *sym;
     int saved_nocode_wanted = S->nocode_wanted;
 #ifdef CONFIG_TCC_BCHECK
-    int bcheck = S->do_bounds_check && !NODATA_WANTED;
+    int bcheck = S->do_bounds_check && !NODATA_WANTED && !ad->a.tls;
 #endif
     init_params p = {0};
 
@@ -8347,6 +10574,17 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
 		if (reg >= 0)
 		    r = (r & ~VT_VALMASK) | reg;
 	    }
+#endif
+#ifdef CONFIG_TCC_REGVARS
+            if (!ad->asm_label && !ad->cleanup_func
+                && (has_init != 1 || S->tok != '{')) {
+                int reg = regvar_alloc(S, v, type);
+                if (reg >= 0) {
+                    /* give back the stack slot */
+                    S->loc = p.local_offset;
+                    r = VT_REGVAR | VT_LVAL, addr = reg;
+                }
+            }
 #endif
             sym = sym_push(S, v, type, r, addr);
 	    if (ad->cleanup_func) {
@@ -8390,7 +10628,9 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
             CType *tp = type;
             while ((tp->t & (VT_BTYPE|VT_ARRAY)) == (VT_PTR|VT_ARRAY))
                 tp = &tp->ref->type;
-            if (tp->t & VT_CONSTANT) {
+            if (ad->a.tls) {
+                sec = tls_section(S, has_init);
+            } else if (tp->t & VT_CONSTANT) {
 		sec = rodata_section;
             } else if (has_init) {
 		sec = data_section;
@@ -8398,6 +10638,8 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
                     tcc_warning(S, "rw data: %s", get_tok_str(v, 0));*/
             } else if (S->nocommon)
                 sec = bss_section;
+            if (sec && v && S->data_sections)
+                sec = sym_section(S, sec, v);
         }
 
         if (sec) {
@@ -8469,6 +10711,19 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
         S->tccgen_cur_scope->vla.num++;
     } else if (has_init) {
         p.sec = sec;
+#ifdef CONFIG_TCC_REGVARS
+        if ((r & VT_VALMASK) == VT_REGVAR) {
+            /* scalar in a register: a plain assignment */
+            CType dtype = *type;
+            dtype.t &= ~VT_CONSTANT;
+            if (S->tccgen_debug_modes)
+                tcc_debug_line(S), tcc_tcov_check_line (S, 1);
+            vset(S, &dtype, r, addr);
+            expr_eq(S);
+            vstore(S);
+            vpop(S);
+        } else
+#endif
         decl_initializer(S, &p, type, addr, DIF_FIRST);
         /* patch flexible array member size back to -1, */
         /* for possible subsequent similar declarations */
@@ -8491,12 +10746,15 @@ static void decl_initializer_alloc(TCCState *S, CType *type, AttributeDef *ad, i
 static void gen_function(TCCState *S, Sym *sym)
 {
     scope_t f = { 0 };
+    int align;
     S->tccgen_cur_scope = S->tccgen_root_scope = &f;
     S->nocode_wanted = 0;
     S->ind = cur_text_section->data_offset;
-    if (sym->a.aligned) {
-	size_t newoff = section_add(S, cur_text_section, 0,
-				    1 << (sym->a.aligned - 1));
+    align = sym->a.aligned ? 1 << (sym->a.aligned - 1) : 0;
+    if (align < S->align_functions)
+        align = S->align_functions;
+    if (align > 1) {
+	size_t newoff = section_add(S, cur_text_section, 0, align);
 	gen_fill_nops(S, newoff - S->ind);
     }
     /* NOTE: we patch the symbol size later */
@@ -8516,19 +10774,27 @@ static void gen_function(TCCState *S, Sym *sym)
     /* push a dummy symbol to enable local sym storage */
     sym_push2(S, &S->local_stack, SYM_FIELD, 0, 0);
     S->local_scope = 1; /* for function parameters */
+#ifdef CONFIG_TCC_REGVARS
+    S->tccgen_regvar_used = S->tccgen_regvar_saved = 0;
+#endif
     gfunc_prolog(S, sym);
     S->local_scope = 0;
+#ifdef CONFIG_TCC_REGVARS
+    regvar_params(S);
+#endif
     S->tccgen_rsym = 0;
     clear_temp_local_var_list(S);
     block(S, 0);
     gsym(S, S->tccgen_rsym);
+    cold_over(S);
     S->nocode_wanted = 0;
     /* reset local stack */
     pop_local_syms(S, NULL, 0);
+    /* before the epilog which may still move code around */
+    label_pop(S, &S->tccgen_global_label_stack, NULL, 0);
     gfunc_epilog(S);
     cur_text_section->data_offset = S->ind;
     S->local_scope = 0;
-    label_pop(S, &S->tccgen_global_label_stack, NULL, 0);
     sym_pop(S, &S->tccgen_all_cleanups, NULL, 0);
     /* patch symbol size */
     elfsym(S, sym)->st_size = S->ind - S->tccgen_func_ind;
@@ -8539,6 +10805,10 @@ static void gen_function(TCCState *S, Sym *sym)
     S->tccgen_funcname = ""; /* for safety */
     S->tccgen_func_vt.t = VT_VOID; /* for safety */
     S->tccgen_func_var = 0; /* for safety */
+#ifdef CONFIG_TCC_BODY_SCAN
+    S->tccgen_regvar_nb = 0;
+    S->tccgen_tail_ok = 0;
+#endif
     S->ind = 0; /* for safety */
     S->nocode_wanted = 0x80000000;
     check_vstack(S);
@@ -8564,9 +10834,13 @@ static void gen_inline_functions(TCCState *S)
                    generate its code and convert it to a normal function */
                 fn->sym = NULL;
                 tcc_debug_putfile(S, fn->filename);
+#ifdef CONFIG_TCC_BODY_SCAN
+                if (regvar_wanted(S))
+                    S->tccgen_regvar_nb = regvar_scan(S, fn->func_str);
+#endif
                 begin_macro(S, fn->func_str, 1);
                 next(S);
-                cur_text_section = text_section;
+                cur_text_section = func_section(S, sym);
                 gen_function(S, sym);
                 end_macro(S);
 
@@ -8706,6 +10980,13 @@ static int decl0(TCCState *S, int l, int is_for_loop_init, Sym *func_sym)
                 tcc_warning(S, "type defaults to int");
             }
 
+            if (ad.a.tls && ((type.t & VT_BTYPE) == VT_FUNC
+                             || (type.t & VT_TYPEDEF)
+                             || (l == VT_LOCAL
+                                 && !(type.t & (VT_STATIC|VT_EXTERN)))))
+                tcc_error(S, "'%s' cannot be thread-local",
+                    get_tok_str(S, v, NULL));
+
             if (gnu_ext && (S->tok == TOK_ASM1 || S->tok == TOK_ASM2 || S->tok == TOK_ASM3)) {
                 ad.asm_label = asm_label_instr(S);
                 /* parse one last attribute list, after asm label */
@@ -8765,6 +11046,7 @@ static int decl0(TCCState *S, int l, int is_for_loop_init, Sym *func_sym)
                     fn = tcc_malloc(S, sizeof *fn + strlen(S->tccpp_file->filename));
                     strcpy(fn->filename, S->tccpp_file->filename);
                     fn->sym = sym;
+                    fn->inline_ok = 0;
 		    skip_or_save_block(S, &fn->func_str);
                     dynarray_add(S, &S->inline_fns,
 				 &S->nb_inline_fns, fn);
@@ -8772,7 +11054,12 @@ static int decl0(TCCState *S, int l, int is_for_loop_init, Sym *func_sym)
                     /* compute text section */
                     cur_text_section = ad.section;
                     if (!cur_text_section)
-                        cur_text_section = text_section;
+                        cur_text_section = func_section(S, sym);
+#ifdef CONFIG_TCC_BODY_SCAN
+                    if (regvar_wanted(S))
+                        gen_function_regvars(S, sym);
+                    else
+#endif
                     gen_function(S, sym);
                 }
                 break;
@@ -1060,6 +1060,7 @@ ST_INLN void tok_str_new(TokenString *s)
     s->len = s->lastlen = 0;
     s->allocated_len = 0;
     s->last_line_num = -1;
+    s->last_pack = -1;
 }
 
 ST_FUNC TokenString *tok_str_alloc(TCCState *S)
@@ -1124,6 +1125,7 @@ ST_FUNC void begin_macro(TCCState *S, TokenString *str, int alloc)
     str->prev = S->tccpp_macro_stack;
     str->prev_ptr = S->tccpp_macro_ptr;
     str->save_line_num = S->tccpp_file->line_num;
+    str->save_pack = *S->pack_stack_ptr << 1 | S->ms_bitfields;
     S->tccpp_macro_ptr = str->str;
     S->tccpp_macro_stack = str;
 }
@@ -1134,6 +1136,9 @@ ST_FUNC void end_macro(TCCState *S)
     S->tccpp_macro_stack = str->prev;
     S->tccpp_macro_ptr = str->prev_ptr;
     S->tccpp_file->line_num = str->save_line_num;
+    /* a replayed function body must not leave its own layout state */
+    *S->pack_stack_ptr = str->save_pack >> 1;
+    S->ms_bitfields = str->save_pack & 1;
     if (str->alloc != 0) {
         if (str->alloc == 2)
             str->str = NULL; /* don't free */
@@ -1218,6 +1223,7 @@ static void tok_str_add2(TCCState *S, TokenString *s, int t, CValue *cv)
 ST_FUNC void tok_str_add_tok(TCCState *S, TokenString *s)
 {
     CValue cval;
+    int pack;
 
     /* save line number info */
     if (S->tccpp_file->line_num != s->last_line_num) {
@@ -1225,6 +1231,14 @@ ST_FUNC void tok_str_add_tok(TCCState *S, TokenString *s)
         cval.i = s->last_line_num;
         tok_str_add2(S, s, TOK_LINENUM, &cval);
     }
+    /* save struct layout state, which a #pragma inside of a saved
+       function body may change before the body is compiled */
+    pack = *S->pack_stack_ptr << 1 | S->ms_bitfields;
+    if (pack != s->last_pack) {
+        s->last_pack = pack;
+        tok_str_add(S, s, TOK_PACK);
+        tok_str_add(S, s, pack);
+    }
     tok_str_add2(S, s, S->tok, &S->tokc);
 }
 
@@ -1593,15 +1607,11 @@ bad_twosharp:
     define_push(S, v, t, tok_str_dup(S, &S->tokstr_buf), first);
 }
 
-static CachedInclude *search_cached_include(TCCState *S, const char *filename, int add)
+static unsigned int cached_include_hash(const char *filename)
 {
-    const unsigned char *s;
-    unsigned int h;
-    CachedInclude *e;
-    int i;
+    const unsigned char *s = (const unsigned char *) filename;
+    unsigned int h = TOK_HASH_INIT;
 
-    h = TOK_HASH_INIT;
-    s = (unsigned char *) filename;
     while (*s) {
 #ifdef _WIN32
         h = TOK_HASH_FUNC(h, toup(*s));
@@ -1610,31 +1620,99 @@ static CachedInclude *search_cached_include(TCCState *S, const char *filename, i
 #endif
         s++;
     }
-    h &= (CACHED_INCLUDES_HASH_SIZE - 1);
+    return h;
+}
 
-    i = S->cached_includes_hash[h];
-    for(;;) {
-        if (i == 0)
-            break;
+static unsigned int cached_include_id_hash(unsigned long long dev, unsigned long long ino)
+{
+    return (unsigned int)(ino ^ (ino >> 32) ^ (dev * 0x9E3779B1u));
+}
+
+/* link entry 'n' (index + 1) into both hash tables */
+static void cached_include_link(TCCState *S, int n)
+{
+    CachedInclude *e = S->cached_includes[n - 1];
+    unsigned int mask = S->cached_includes_hash_size - 1;
+    int *h = S->cached_includes_hash;
+
+    h += cached_include_hash(e->filename) & mask;
+    e->hash_next = *h, *h = n;
+    if (e->file == e && (e->dev | e->ino)) {
+        h = S->cached_includes_hash + S->cached_includes_hash_size;
+        h += cached_include_id_hash(e->dev, e->ino) & mask;
+        e->id_next = *h, *h = n;
+    }
+}
+
+/* double the hash tables before they get fuller than they are large */
+static void cached_include_grow(TCCState *S)
+{
+    int i, size = S->cached_includes_hash_size;
+
+    if (S->nb_cached_includes < size)
+        return;
+    size *= 2;
+    tcc_free(S, S->cached_includes_hash);
+    S->cached_includes_hash = tcc_mallocz(S, 2 * size * sizeof (int));
+    S->cached_includes_hash_size = size;
+    for (i = 1; i <= S->nb_cached_includes; ++i)
+        cached_include_link(S, i);
+}
+
+/* Return the guard state for 'filename'.  Unknown paths are looked up by
+   file identity so that e.g. "foo.h", "./foo.h" and a symlink to it share
+   one entry.  If the file cannot be stat'ed, NULL is returned unless 'add'
+   is set, in which case a path-only entry is created. */
+static CachedInclude *search_cached_include(TCCState *S, const char *filename, int add)
+{
+    CachedInclude *e, *f;
+    unsigned long long dev = 0, ino = 0;
+    unsigned int mask = S->cached_includes_hash_size - 1;
+    int i;
+
+    i = S->cached_includes_hash[cached_include_hash(filename) & mask];
+    while (i) {
         e = S->cached_includes[i - 1];
         if (0 == PATHCMP(e->filename, filename))
-            return e;
+            return e->file;
         i = e->hash_next;
     }
+
+    f = NULL;
+#ifndef _WIN32
+    {
+        struct stat st;
+        if (stat(filename, &st) == 0) {
+            dev = st.st_dev, ino = st.st_ino;
+            i = S->cached_includes_hash[S->cached_includes_hash_size
+                + (cached_include_id_hash(dev, ino) & mask)];
+            while (i) {
+                e = S->cached_includes[i - 1];
+                if (e->dev == dev && e->ino == ino) {
+                    f = e;
+                    break;
+                }
+                i = e->id_next;
+            }
+            add = 1;
+        }
+    }
+#endif
     if (!add)
         return NULL;
 
     e = tcc_malloc(S, sizeof(CachedInclude) + strlen(filename));
     strcpy(e->filename, filename);
     e->ifndef_macro = e->once = 0;
+    e->file = f ? f : e;
+    e->dev = dev, e->ino = ino;
+    cached_include_grow(S);
     dynarray_add(S, &S->cached_includes, &S->nb_cached_includes, e);
-    /* add in hash table */
-    e->hash_next = S->cached_includes_hash[h];
-    S->cached_includes_hash[h] = S->nb_cached_includes;
+    cached_include_link(S, S->nb_cached_includes);
 #ifdef INC_DEBUG
-    printf("adding cached '%s'\n", filename);
+    printf("adding cached '%s'%s\n", filename, f ? " (alias)" : "");
 #endif
-    return e;
+    return e->file;
 }
 
 static void pragma_parse(TCCState *S)
@@ -1669,7 +1747,7 @@ static void pragma_parse(TCCState *S)
         S->tccpp_pp_debug_tok = t, S->tccpp_pp_debug_symv = v;
 
     } else if (S->tok == TOK_once) {
-        search_cached_include(S, S->tccpp_file->filename, 1)->once = S->tccpp_pp_once;
+        search_cached_include(S, S->tccpp_file->true_filename, 1)->once = S->tccpp_pp_once;
 
     } else if (S->output_type == TCC_OUTPUT_PREPROCESS) {
         /* tcc -E: keep pragmas below unchanged */
@@ -2663,7 +2741,7 @@ static inline void next_nomacro1(TCCState *S)
 #ifdef INC_DEBUG
                     printf("#endif %s\n", get_tok_str(S, S->tccpp_file->ifndef_macro_saved, NULL));
 #endif
-                    search_cached_include(S, S->tccpp_file->filename, 1)
+                    search_cached_include(S, S->tccpp_file->true_filename, 1)
                         ->ifndef_macro = S->tccpp_file->ifndef_macro_saved;
                     S->tok_flags &= ~TOK_FLAG_ENDIF;
                 }
@@ -3561,6 +3639,12 @@ static void next_nomacro(TCCState *S)
         } else {
             S->tccpp_macro_ptr++;
             if (t < TOK_IDENT) {
+                if (t == TOK_PACK) {
+                    t = *S->tccpp_macro_ptr++;
+                    *S->pack_stack_ptr = t >> 1;
+                    S->ms_bitfields = t & 1;
+                    goto redo;
+                }
                 if (!(S->tccpp_parse_flags & PARSE_FLAG_SPACES)
                     && (S->tccpp_isidnum_table[t - CH_EOF] & IS_SPC))
                     goto redo;
@@ -3677,6 +3761,10 @@ static void tcc_predefs(TCCState *S, CString *cs, int is_asm)
 #ifdef TCC_TARGET_ARM
     if (S->float_abi == ARM_HARD_FLOAT)
       putdef(S, cs, "__ARM_PCS_VFP");
+#endif
+#ifdef TCC_TARGET_I386
+    if (S->sse2)
+      putdef(S, cs, "__SSE2_MATH__");
 #endif
     if (is_asm)
       putdef(S, cs, "__ASSEMBLER__");
@@ -3783,7 +3871,8 @@ ST_FUNC void tccpp_new(TCCState *S)
     tal_new(S, &S->tokstr_alloc, TOKSTR_TAL_LIMIT, TOKSTR_TAL_SIZE);
 
     memset(S->tccpp_hash_ident, 0, TOK_HASH_SIZE * sizeof(TokenSym *));
-    memset(S->cached_includes_hash, 0, sizeof S->cached_includes_hash);
+    S->cached_includes_hash_size = CACHED_INCLUDES_HASH_SIZE;
+    S->cached_includes_hash = tcc_mallocz(S, 2 * CACHED_INCLUDES_HASH_SIZE * sizeof (int));
 
     cstr_new(S, &S->tccpp_cstr_buf);
     cstr_realloc(S, &S->tccpp_cstr_buf, STRING_MAX_SIZE);
@@ -3817,6 +3906,8 @@ ST_FUNC void tccpp_delete(TCCState *S)
     int i, n;
 
     dynarray_reset(S, &S->cached_includes, &S->nb_cached_includes);
+    tcc_free(S, S->cached_includes_hash);
+    S->cached_includes_hash = NULL;
 
     /* free tokens */
     n = S->tok_ident - TOK_IDENT;
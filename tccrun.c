@@ -243,6 +243,11 @@ static int tcc_relocate_ex(TCCState *S, void *ptr, addr_t ptr_diff)
 #else
         tcc_add_runtime(S);
 	resolve_common_syms(S);
+        for (i = 1; i < S->nb_sections; i++)
+            if (S->sections[i]->sh_flags & SHF_TLS) {
+                tcc_error_noabort(S, "thread-local variables are not supported with -run");
+                return -1;
+            }
         build_got_entries(S);
 #endif
         if (S->nb_errors)
@@ -58,6 +58,8 @@
      DEF(TOK_ALIGNOF2, "__alignof__")
      DEF(TOK_ALIGNOF3, "_Alignof")
      DEF(TOK_ALIGNAS, "_Alignas")
+     DEF(TOK_THREAD1, "_Thread_local")
+     DEF(TOK_THREAD2, "__thread") /* gcc keyword */
      DEF(TOK_TYPEOF1, "typeof")
      DEF(TOK_TYPEOF2, "__typeof")
      DEF(TOK_TYPEOF3, "__typeof__")
@@ -66,9 +68,13 @@
      DEF(TOK_ASM2, "__asm")
      DEF(TOK_ASM3, "__asm__")
 
-#ifdef TCC_TARGET_ARM64
+#if defined TCC_TARGET_ARM64 || defined CONFIG_TCC_INT128
      DEF(TOK_UINT128, "__uint128_t")
 #endif
+#ifdef CONFIG_TCC_INT128
+     DEF(TOK_INT128, "__int128")
+     DEF(TOK_INT128_T, "__int128_t")
+#endif
 
 /*********************************************************************/
 /* the following are not keywords. They are included to ease parsing */
@@ -140,6 +146,12 @@
      DEF(TOK_DESTRUCTOR2, "__destructor__")
      DEF(TOK_ALWAYS_INLINE1, "always_inline")
      DEF(TOK_ALWAYS_INLINE2, "__always_inline__")
+     DEF(TOK_VECTOR_SIZE1, "vector_size")
+     DEF(TOK_VECTOR_SIZE2, "__vector_size__")
+     DEF(TOK_COLD1, "cold")
+     DEF(TOK_COLD2, "__cold__")
+     DEF(TOK_HOT1, "hot")
+     DEF(TOK_HOT2, "__hot__")
 
      DEF(TOK_MODE, "__mode__")
      DEF(TOK_MODE_QI, "__QI__")
@@ -163,11 +175,29 @@
      DEF(TOK_builtin_frame_address, "__builtin_frame_address")
      DEF(TOK_builtin_return_address, "__builtin_return_address")
      DEF(TOK_builtin_expect, "__builtin_expect")
+     DEF(TOK_builtin_expect_with_probability, "__builtin_expect_with_probability")
+     /* keep in this order, see builtin_bitop() */
+     DEF(TOK_builtin_popcount, "__builtin_popcount")
+     DEF(TOK_builtin_popcountl, "__builtin_popcountl")
+     DEF(TOK_builtin_popcountll, "__builtin_popcountll")
+     DEF(TOK_builtin_ctz, "__builtin_ctz")
+     DEF(TOK_builtin_ctzl, "__builtin_ctzl")
+     DEF(TOK_builtin_ctzll, "__builtin_ctzll")
+     DEF(TOK_builtin_clz, "__builtin_clz")
+     DEF(TOK_builtin_clzl, "__builtin_clzl")
+     DEF(TOK_builtin_clzll, "__builtin_clzll")
+     DEF(TOK_builtin_ffs, "__builtin_ffs")
+     DEF(TOK_builtin_ffsl, "__builtin_ffsl")
+     DEF(TOK_builtin_ffsll, "__builtin_ffsll")
+     DEF(TOK_builtin_bswap16, "__builtin_bswap16")
+     DEF(TOK_builtin_bswap32, "__builtin_bswap32")
+     DEF(TOK_builtin_bswap64, "__builtin_bswap64")
      /*DEF(TOK_builtin_va_list, "__builtin_va_list")*/
 #if defined TCC_TARGET_PE && defined TCC_TARGET_X86_64
      DEF(TOK_builtin_va_start, "__builtin_va_start")
 #elif defined TCC_TARGET_X86_64
      DEF(TOK_builtin_va_arg_types, "__builtin_va_arg_types")
+     DEF(TOK_builtin_va_arg, "__builtin_va_arg")
 #elif defined TCC_TARGET_ARM64
      DEF(TOK_builtin_va_start, "__builtin_va_start")
      DEF(TOK_builtin_va_arg, "__builtin_va_arg")
@@ -288,6 +318,40 @@
 
 #if defined TCC_TARGET_PE
      DEF(TOK___chkstk, "__chkstk")
+#elif defined TCC_TARGET_X86_64
+     DEF(TOK___va_arg, "__va_arg")
+#endif
+#ifdef CONFIG_TCC_INT128
+     DEF(TOK___divti3, "__divti3")
+     DEF(TOK___modti3, "__modti3")
+     DEF(TOK___udivti3, "__udivti3")
+     DEF(TOK___umodti3, "__umodti3")
+     DEF(TOK___ashrti3, "__ashrti3")
+     DEF(TOK___lshrti3, "__lshrti3")
+     DEF(TOK___ashlti3, "__ashlti3")
+     /* in this order, see gen_cast() */
+     DEF(TOK___floattisf, "__floattisf")
+     DEF(TOK___floatuntisf, "__floatuntisf")
+     DEF(TOK___floattidf, "__floattidf")
+     DEF(TOK___floatuntidf, "__floatuntidf")
+# ifdef TCC_TARGET_ARM64
+     DEF(TOK___floattitf, "__floattitf")
+     DEF(TOK___floatuntitf, "__floatuntitf")
+# else
+     DEF(TOK___floattixf, "__floattixf")
+     DEF(TOK___floatuntixf, "__floatuntixf")
+# endif
+     DEF(TOK___fixsfti, "__fixsfti")
+     DEF(TOK___fixunssfti, "__fixunssfti")
+     DEF(TOK___fixdfti, "__fixdfti")
+     DEF(TOK___fixunsdfti, "__fixunsdfti")
+# ifdef TCC_TARGET_ARM64
+     DEF(TOK___fixtfti, "__fixtfti")
+     DEF(TOK___fixunstfti, "__fixunstfti")
+# else
+     DEF(TOK___fixxfti, "__fixxfti")
+     DEF(TOK___fixunsxfti, "__fixunsxfti")
+# endif
 #endif
 #if defined TCC_TARGET_ARM64 || defined TCC_TARGET_RISCV64
      DEF(TOK___arm64_clear_cache, "__arm64_clear_cache")
@@ -82,6 +82,30 @@ int main(int argc, char **argv)
     return 1;
 }
 
+/* ------------------------------------------------------- */
+#elif defined test_backtrace_relax
+
+/* line numbers must follow the code when jumps are shortened */
+int tcc_backtrace(const char *fmt, ...);
+
+int f1(int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; i++)
+        if (i & 1 && (i & 2 || i & 4 || i & 8 || i & 16))
+            s += i;
+        else if (i & 32 || i & 64 || i & 128 || i & 256)
+            s -= 2 * i;
+    printf("* f1()\n"), fflush(stdout);
+    tcc_backtrace("s = %d", s);
+    return s;
+}
+int main(int argc, char **argv)
+{
+    printf("* main\n"), fflush(stdout);
+    return f1(argc + 8) > 0;
+}
+
 /* ------------------------------------------------------- */
 #else
 #include <stdlib.h>
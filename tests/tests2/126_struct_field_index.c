@@ -0,0 +1,42 @@
+/* Member lookup in structs large enough to get a hash index,
+   including members of anonymous sub-structs and unions. */
+extern int printf (const char *, ...);
+
+#define F4(p) int p##0, p##1, p##2, p##3;
+#define F16(p) F4(p##0) F4(p##1) F4(p##2) F4(p##3)
+
+struct big {
+    F16(a)
+    union {
+        struct { char c1, c2; };
+        long long ll;
+        F16(u)
+    };
+    F16(b)
+    struct { F16(s) } named;
+    int last;
+};
+
+static struct big g = { .a00 = 1, .b33 = 2, .c2 = 3, .named.s12 = 4, .last = 5 };
+
+int main(void)
+{
+    struct big l = g, *p = &l;
+    int i, s = 0;
+
+    {
+        /* a local struct with the same member names */
+        struct big { F16(b) F16(a) char last; } x = { .last = 'x' };
+        x.a33 = 7;
+        printf("%c %d %d\n", x.last, x.a33, (int)((char*)&x.a00 - (char*)&x));
+    }
+    p->a21 = 6, p->u01 = 0x0201;
+    for (i = 0; i < 16; ++i)
+        s += (&p->a00)[i];
+    printf("%d %d %d %d %d %d\n", s, l.b33, l.c1, l.c2, l.named.s12, l.last);
+    printf("%d %d %d\n",
+        (int)((char*)&l.ll - (char*)&l),
+        (int)((char*)&l.u33 - (char*)&l.c1),
+        (int)((char*)&l.last - (char*)&l.named.s00));
+    return 0;
+}
@@ -0,0 +1,61 @@
+/* Dense switches, dispatched through a jump table where supported */
+extern int printf (const char *, ...);
+
+static int interp(const unsigned char *pc)
+{
+    int acc = 0;
+    for (;;) {
+        switch (*pc++) {
+        case 0: return acc;
+        case 1: acc += 1; break;
+        case 2: acc *= 2; break;
+        case 3: acc -= 3; break;
+        case 4: acc = -acc; /* fall through */
+        case 5: acc += 5; break;
+        case 7: acc ^= 0x55; break;
+        case 8 ... 10: acc += pc[-1]; break;
+        default: acc += 1000; break;
+        }
+    }
+}
+
+static const char *sign(long long x)
+{
+    switch (x) {
+    case -4: return "m4";
+    case -3: return "m3";
+    case -1: return "m1";
+    case 0: return "z";
+    case 1: return "p1";
+    case 3: return "p3";
+    }
+    return "-";
+}
+
+static int uswitch(unsigned u)
+{
+    switch (u) {
+    case 0xfffffffa: return 1;
+    case 0xfffffffb: return 2;
+    case 0xfffffffc: return 3;
+    case 0xfffffffd: return 4;
+    case 0xfffffffe: return 5;
+    case 0xffffffff: return 6;
+    default: return 0;
+    }
+}
+
+int main(void)
+{
+    static const unsigned char prog[] = { 1, 2, 2, 3, 4, 5, 6, 7, 8, 10, 11, 0 };
+    int i;
+
+    printf("%d\n", interp(prog));
+    for (i = -6; i <= 5; ++i)
+        printf("%s ", sign(i));
+    printf("%s\n", sign(0x100000000LL));
+    for (i = -8; i <= 1; ++i)
+        printf("%d", uswitch(i));
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* local variables in registers, compiled with -O1 */
+#include <stdio.h>
+
+static int sum(const int *a, int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    return s;
+}
+
+static long long fib(int n)
+{
+    long long a = 0, b = 1, t;
+    while (n-- > 0)
+        t = a + b, a = b, b = t;
+    return a;
+}
+
+/* more candidates than registers, some of them address taken */
+static unsigned mix(unsigned x, unsigned y)
+{
+    unsigned a = x, b = y, c = x ^ y, d = x + y, e = x * y, f = 1, g = 2;
+    unsigned *p = &f;
+    int k;
+    for (k = 0; k < 8; k++) {
+        a += b, b ^= c, c -= d, d += e, e ^= a;
+        *p += a + b + c + d + e + g;
+        g = g * 3 + (&g != 0);
+    }
+    return a ^ b ^ c ^ d ^ e ^ f ^ g;
+}
+
+/* narrowing casts of a register variable */
+static int narrow(int v)
+{
+    int i, r = 0;
+    for (i = 0; i < 2; i++)
+        r += (signed char)v + (unsigned char)v + (short)v + (unsigned short)v;
+    return r;
+}
+
+/* registers are reused by sibling scopes */
+static int scopes(int n)
+{
+    int total = 0;
+    {
+        int a = n, b = 2 * n, c = 3 * n;
+        for (; a < b; a++)
+            total += a + c;
+    }
+    {
+        int x = -n, y = n, z = ({ int q = n; q * q + q; });
+        while (x < y)
+            total += x++ * z;
+    }
+    return total;
+}
+
+static int recurse(int n)
+{
+    int i, r = 1;
+    for (i = 0; i < n; i++)
+        r += recurse(i);
+    return r;
+}
+
+struct pk { char c; int i; };
+
+static int pack_inside(void)
+{
+    int i, n = 0;
+#pragma pack(push, 1)
+    struct p1 { char c; int i; };
+#pragma pack(pop)
+    for (i = 0; i < 3; i++)
+        n += sizeof(struct p1) + sizeof(struct pk);
+    return n;
+}
+
+int main(void)
+{
+    int a[100], i;
+    const int m = 7;
+    char *s = "register";
+    const char *q;
+
+    for (i = 0; i < 100; i++)
+        a[i] = i * i - 50 * i;
+    printf("%d %lld\n", sum(a, 100), fib(90));
+    printf("%u\n", mix(12345, 678910));
+    printf("%d %d\n", narrow(0x1234fe80), narrow(-3));
+    printf("%d %d\n", scopes(5), recurse(10));
+    printf("%d\n", pack_inside());
+    for (q = s, i = 0; *q; q++)
+        i += *q * m;
+    printf("%d\n", i);
+    return 0;
+}
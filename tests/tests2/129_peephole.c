@@ -0,0 +1,85 @@
+/* code patterns touched by the x86_64 peephole optimizer (built with -O1) */
+#include <stdio.h>
+
+int nested(int a, int b)
+{
+    int r = 0;
+    if (a) {
+        if (b)
+            r = 1;
+    } else {
+        r = 2;
+    }
+    return r;
+}
+
+int empty_else(int a)
+{
+    int r = a;
+    if (a > 5) {
+        r = r * 2;
+    } else {
+    }
+    return r;
+}
+
+int loops(int n)
+{
+    int i, j, s = 0;
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            if (j == i)
+                continue;
+            if (j > i + 2)
+                break;
+            s += i * j;
+        }
+    }
+    while (n > 0) {
+        if (n & 1) {
+            n -= 3;
+        } else {
+        }
+        n--;
+    }
+    return s + n;
+}
+
+long long store_load(long long a, int b)
+{
+    volatile int v = b;
+    long long x = a + b;
+    int y;
+    y = (int)x;
+    x = x + y;
+    b = v;
+    return x + b;
+}
+
+int jumps(int x)
+{
+    if (x == 0)
+        goto l1;
+    if (x == 1)
+        goto l2;
+    return 100;
+l1:
+    goto l2;
+l2:
+    return x > 0 ? x : -1;
+}
+
+int tern(int a, int b, int c)
+{
+    return a ? (b ? 1 : 2) : (c ? 3 : 4);
+}
+
+int main()
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        printf("%d %d %d %d %d\n", nested(i & 1, i & 2), empty_else(i * 3),
+               loops(i + 3), jumps(i), tern(i & 1, i & 2, i == 0));
+    printf("%lld\n", store_load(1000000000000LL, 7));
+    return 0;
+}
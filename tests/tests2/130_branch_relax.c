@@ -0,0 +1,79 @@
+/* forward and backward jumps around the short/long displacement limit,
+   float compares, computed gotos and switch tables, all of which must
+   survive the compaction of the function after branch relaxation */
+#include <stdio.h>
+
+#define PAD4(x) x = x * 3 + 1; x = x ^ (x >> 3); x = x + 7; x = x * 5;
+#define PAD16(x) PAD4(x) PAD4(x) PAD4(x) PAD4(x)
+
+unsigned span(unsigned a, int n)
+{
+    unsigned x = a;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (x & 1)
+            continue;
+        if (x & 2) {
+            PAD4(x)
+        } else if (x & 4) {
+            PAD16(x)
+        } else {
+            PAD16(x) PAD4(x)
+        }
+        if (x & 8)
+            break;
+    }
+    return x;
+}
+
+int fcmp(double a, double b)
+{
+    int r = 0;
+    if (a == b) r |= 1;
+    if (a != b) r |= 2;
+    if (a < b) r |= 4;
+    if (!(a >= b)) r |= 8;
+    return r;
+}
+
+unsigned cgoto(int n)
+{
+    static void *tab[] = { &&l0, &&l1, &&l2 };
+    unsigned x = 1;
+    goto *tab[n % 3];
+l0:
+    if (n > 10) goto out;
+    PAD4(x)
+l1:
+    if (n > 20) goto out;
+    PAD16(x)
+l2:
+    x += n;
+out:
+    return x;
+}
+
+unsigned sw(int v)
+{
+    unsigned x = v;
+    switch (v) {
+    case 0: x += 1; break;
+    case 1: PAD4(x) break;
+    case 2: PAD16(x) break;
+    case 3: x -= 3;
+    case 4: if (x > 2) break; x = 4; break;
+    case 5: PAD16(x) PAD4(x) break;
+    case 6: return 66;
+    }
+    return x;
+}
+
+int main()
+{
+    int i;
+    double nan = 0.0 / 0.0;
+    for (i = 0; i < 8; i++)
+        printf("%u %u %u %u\n", span(i, i + 1), cgoto(i * 5), sw(i), sw(i - 1));
+    printf("%d %d %d %d\n", fcmp(1, 1), fcmp(1, 2), fcmp(2, 1), fcmp(nan, 1));
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* division and modulo by constants, checked against real divisions */
+#include <stdio.h>
+#include <limits.h>
+
+typedef long long ll;
+typedef unsigned long long ull;
+
+static unsigned seed = 1;
+
+static ull rnd(void)
+{
+    ull r = 0;
+    int i;
+    for (i = 0; i < 4; i++) {
+        seed = seed * 1103515245 + 12345;
+        r = r << 16 | (seed >> 8 & 0xffff);
+    }
+    /* mix in some small numbers */
+    switch (r & 3) {
+    case 0: return r >> (r >> 2 & 63);
+    case 1: return -(r >> (r >> 2 & 63));
+    }
+    return r;
+}
+
+#define NVAL 3000
+static ull val[NVAL];
+
+static void init(void)
+{
+    static const ull edge[] = {
+        0, 1, 2, 3, 7, 8, 9, 99, 100, 101, 1000000007,
+        0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff,
+        0x100000000ull, 0x7fffffffffffffffull, 0x8000000000000000ull,
+        0x8000000000000001ull, 0xfffffffffffffffeull, 0xffffffffffffffffull,
+    };
+    int i, n = sizeof edge / sizeof edge[0];
+    for (i = 0; i < n; i++) {
+        val[2 * i] = edge[i];
+        val[2 * i + 1] = -edge[i];
+    }
+    for (i = 2 * n; i < NVAL; i++)
+        val[i] = rnd();
+}
+
+static int errors;
+
+#define TEST(T, name, C) do { \
+    volatile T vd = (T)(C); \
+    T d = vd; \
+    int i; \
+    for (i = 0; i < NVAL; i++) { \
+        T x = (T)val[i]; \
+        T q, r; \
+        if ((T)-1 < 0 && d == (T)-1 \
+            && x == (T)(1ull << (sizeof(T) * 8 - 1))) \
+            continue; /* overflow */ \
+        q = x / (T)(C); \
+        r = x % (T)(C); \
+        if (q != x / d || r != x % d) { \
+            if (errors++ < 10) \
+                printf("%s %s: %lld / %lld\n", name, #C, (ll)x, (ll)d); \
+        } \
+    } \
+} while (0)
+
+#define TEST_ALL(C) do { \
+    TEST(int, "int", C); \
+    TEST(unsigned, "unsigned", C); \
+    TEST(ll, "long long", C); \
+    TEST(ull, "unsigned long long", C); \
+} while (0)
+
+struct s3 { char c[3]; };
+struct s12 { int i[3]; };
+struct s24 { ll l[3]; };
+struct s40 { char c[40]; };
+
+int main(void)
+{
+    static struct s3 a3[100];
+    static struct s12 a12[100];
+    static struct s24 a24[100];
+    static struct s40 a40[100];
+    volatile int i0 = 17, i1 = 93;
+
+    init();
+
+    TEST_ALL(2); TEST_ALL(3); TEST_ALL(4); TEST_ALL(5); TEST_ALL(6);
+    TEST_ALL(7); TEST_ALL(9); TEST_ALL(10); TEST_ALL(11); TEST_ALL(12);
+    TEST_ALL(13); TEST_ALL(14); TEST_ALL(16); TEST_ALL(19); TEST_ALL(25);
+    TEST_ALL(60); TEST_ALL(100); TEST_ALL(125); TEST_ALL(641);
+    TEST_ALL(1000); TEST_ALL(4096); TEST_ALL(6700417); TEST_ALL(1000000007);
+    TEST_ALL(-1); TEST_ALL(-2); TEST_ALL(-3); TEST_ALL(-5); TEST_ALL(-7);
+    TEST_ALL(-8); TEST_ALL(-10); TEST_ALL(-1000); TEST_ALL(-1000000007);
+    TEST_ALL(0x7fffffff); TEST_ALL(INT_MIN); TEST_ALL(0x40000000);
+    TEST_ALL(0x55555555);
+
+    TEST(unsigned, "unsigned", 0x80000001u);
+    TEST(unsigned, "unsigned", 0xfffffffeu);
+    TEST(unsigned, "unsigned", 0xffffffffu);
+    TEST(unsigned, "unsigned", 0x80000000u);
+    TEST(ll, "long long", 0x123456789ll);
+    TEST(ll, "long long", -0x123456789ll);
+    TEST(ll, "long long", 0x7fffffffffffffffll);
+    TEST(ll, "long long", LLONG_MIN);
+    TEST(ll, "long long", 1ll << 40);
+    TEST(ll, "long long", -(1ll << 40));
+    TEST(ll, "long long", 10000000000000000ll);
+    TEST(ull, "unsigned long long", 0x123456789ull);
+    TEST(ull, "unsigned long long", 0x8000000000000001ull);
+    TEST(ull, "unsigned long long", 0xfffffffffffffffeull);
+    TEST(ull, "unsigned long long", 0xffffffffffffffffull);
+    TEST(ull, "unsigned long long", 1ull << 63);
+    TEST(ull, "unsigned long long", 10000000000000000000ull);
+
+    /* pointer differences divide exactly */
+    printf("%d %d\n", (int)(&a3[i0] - &a3[i1]), (int)(&a3[i1] - &a3[i0]));
+    printf("%d %d\n", (int)(&a12[i0] - &a12[i1]), (int)(&a12[i1] - &a12[i0]));
+    printf("%d %d\n", (int)(&a24[i0] - &a24[i1]), (int)(&a24[i1] - &a24[i0]));
+    printf("%d %d\n", (int)(&a40[i0] - &a40[i1]), (int)(&a40[i1] - &a40[i0]));
+
+    printf("%d errors\n", errors);
+    return 0;
+}
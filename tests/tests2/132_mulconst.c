@@ -0,0 +1,61 @@
+/* multiplication by constants */
+#include <stdio.h>
+
+typedef long long ll;
+typedef unsigned long long ull;
+
+#define MUL(T, C) \
+    static T mul_##T##_##C(T x) { return x * C; }
+#define MUL_ALL(C) MUL(int, C) MUL(unsigned, C) MUL(ll, C) MUL(ull, C)
+
+MUL_ALL(3) MUL_ALL(5) MUL_ALL(6) MUL_ALL(7) MUL_ALL(9) MUL_ALL(10)
+MUL_ALL(12) MUL_ALL(15) MUL_ALL(17) MUL_ALL(24) MUL_ALL(25) MUL_ALL(27)
+MUL_ALL(31) MUL_ALL(33) MUL_ALL(40) MUL_ALL(45) MUL_ALL(63) MUL_ALL(81)
+MUL_ALL(100) MUL_ALL(127) MUL_ALL(1000) MUL_ALL(2047) MUL_ALL(65537)
+MUL_ALL(1000000007)
+
+struct s3 { char c[3]; };
+struct s12 { int i[3]; };
+struct s20 { int i[5]; };
+struct s36 { int i[9]; };
+
+static struct s3 a3[10];
+static struct s12 a12[10];
+static struct s20 a20[10];
+static struct s36 a36[10];
+
+int main(void)
+{
+    static const ull v[] = {
+        0, 1, 2, 7, 100, 12345, 0x7fffffff, 0x80000000, 0xffffffff,
+        0x123456789abcdefull, 0x7fffffffffffffffull, 0x8000000000000000ull,
+        0xffffffffffffffffull, 0xfedcba9876543210ull
+    };
+    unsigned h = 0;
+    int i;
+
+#define T(C) \
+    h = h * 31 + mul_int_##C((int)v[i]); \
+    h = h * 31 + mul_unsigned_##C((unsigned)v[i]); \
+    h = h * 31 + (unsigned)(mul_ll_##C((ll)v[i]) >> 17); \
+    h = h * 31 + (unsigned)mul_ull_##C(v[i]); \
+    h = h * 31 + (unsigned)(mul_ll_##C(-(ll)v[i]) >> 29);
+
+    for (i = 0; i < sizeof v / sizeof v[0]; i++) {
+        T(3) T(5) T(6) T(7) T(9) T(10) T(12) T(15) T(17) T(24) T(25) T(27)
+        T(31) T(33) T(40) T(45) T(63) T(81) T(100) T(127) T(1000) T(2047)
+        T(65537) T(1000000007)
+        printf("%08x\n", h);
+    }
+
+    for (i = 0; i < 10; i++) {
+        a3[i].c[1] = i;
+        a12[i].i[2] = i * 2;
+        a20[i].i[3] = i * 3;
+        a36[i].i[8] = i * 4;
+    }
+    for (i = 9; i >= 0; i -= 3)
+        printf("%d %d %d %d\n", a3[i].c[1], a12[i].i[2], a20[i].i[3],
+               a36[i].i[8]);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* struct copies and zero initialization of many sizes */
+#include <stdio.h>
+#include <string.h>
+
+#define S(n) struct s##n { unsigned char c[n]; };
+#define ALL(X) X(1) X(2) X(3) X(4) X(5) X(7) X(8) X(9) X(15) X(16) X(17) \
+    X(23) X(24) X(31) X(32) X(33) X(48) X(63) X(64) X(65) X(100) X(127) \
+    X(128) X(129) X(200)
+
+ALL(S)
+
+static unsigned sum;
+
+static void check(const void *p, int n, int start)
+{
+    const unsigned char *c = p;
+    int i;
+    for (i = 0; i < n; i++)
+        sum = sum * 7 + c[i] + (c[i] != (unsigned char)(start + i));
+}
+
+#define T(n) { \
+    struct s##n a, b, c, *pa = &a, *pb = &b; \
+    struct s##n z = { { 1 } }; \
+    static struct s##n g; \
+    unsigned char guard1[8]; \
+    int i; \
+    memset(guard1, 0x55, sizeof guard1); \
+    for (i = 0; i < n; i++) \
+        a.c[i] = i + n; \
+    memset(&b, 0xaa, sizeof b); \
+    b = a; \
+    check(&b, n, n); \
+    memset(&b, 0xaa, sizeof b); \
+    *pb = *pa; \
+    check(pb, n, n); \
+    c = g = *pb; \
+    check(&g, n, n); \
+    check(&c, n, n); \
+    *pa = *pa; \
+    check(pa, n, n); \
+    for (i = 1; i < n; i++) \
+        if (z.c[i]) \
+            printf("struct s%d not cleared at %d\n", n, i); \
+    if (z.c[0] != 1) \
+        printf("struct s%d lost initializer\n", n); \
+    for (i = 0; i < 8; i++) \
+        if (guard1[i] != 0x55) \
+            printf("struct s%d clobbered guard\n", n); \
+}
+
+struct mixed {
+    char c;
+    int i;
+    double d;
+    struct { short s[3]; } in;
+    long long l;
+};
+
+static struct mixed ret_mixed(int x)
+{
+    struct mixed m = { x, x * 2, x * 0.5, { { x, x + 1, x + 2 } }, x * 1000LL };
+    return m;
+}
+
+int main(void)
+{
+    struct mixed m[3], *p = m;
+    int k;
+
+    ALL(T)
+    printf("%08x\n", sum);
+
+    for (k = 0; k < 3; k++)
+        m[k] = ret_mixed(k + 1);
+    p[2] = p[0];
+    for (k = 0; k < 3; k++)
+        printf("%d %d %g %d %d %d %lld\n", m[k].c, m[k].i, m[k].d,
+               m[k].in.s[0], m[k].in.s[1], m[k].in.s[2], m[k].l);
+    {
+        int a[20] = { [3] = 3 }, sa = 0;
+        for (k = 0; k < 20; k++)
+            sa += a[k] * (k + 1);
+        printf("%d\n", sa);
+    }
+    return 0;
+}
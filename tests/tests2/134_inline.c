@@ -0,0 +1,124 @@
+/* call site inlining of static inline functions (run with -O1) */
+#include <stdio.h>
+
+struct pt { int x, y; };
+
+static int g = 5;
+static int calls;
+
+static inline int add(int a, int b) { return a + b + g; }
+static inline int sq(int x) { if (x < 0) return -x * x; return x * x; }
+static inline void bump(int *p) { ++*p; }
+static inline int twice(int x) { return add(x, x) - g; }
+static inline int next(void) { return ++calls; }
+static inline struct pt mkpt(int x, int y) { struct pt p = { x, y }; return p; }
+static inline int dot(struct pt a, struct pt b) { return a.x * b.x + a.y * b.y; }
+static inline double avg(double a, double b) { return (a + b) / 2; }
+static inline long double half(long double x) { return x / 2; }
+static inline unsigned char low(unsigned char c) { return c; }
+static inline const char *pick(int c, const char *a, const char *b)
+{ return c ? a : b; }
+static inline int addr(int x) { int *p = &x; *p += 1; return x; }
+static inline int fact(int n) { return n <= 1 ? 1 : n * fact(n - 1); }
+static inline void set(int *p, const int v) { *p = v; }
+
+static inline int find(const int *a, int n, int v)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        if (a[i] == v)
+            return i;
+        if (a[i] > v)
+            break;
+    }
+    return -1;
+}
+
+static inline int classify(int c)
+{
+    switch (c) {
+    case 0: return 10;
+    case 1: case 2: return 20;
+    default: break;
+    }
+    return 30;
+}
+
+static inline int sum_to(int n)
+{
+    int s = 0;
+    while (n > 0) {
+        if (n == 100)
+            { n--; continue; }
+        s += n--;
+    }
+    return s;
+}
+
+static inline int stmt_expr(int x) { return ({ int y = x * 3; y + 1; }); }
+
+static inline int uses_static(void) { static int n; return ++n; }
+
+static inline int big(int x)
+{
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1; x = x * 3 + 1;
+    return x;
+}
+
+int main(void)
+{
+    int g = 100, i, j, s = 0, k;
+    static const int arr[] = { 1, 3, 5, 7, 9, 11 };
+    int (*fp)(int) = sq;
+    struct pt p;
+
+    for (i = -3; i < 4; i++) {
+        s += add(i, g) * sq(i);
+        bump(&s);
+    }
+    printf("%d %d\n", s, g);
+
+    /* arguments are evaluated once */
+    calls = 0;
+    i = add(next(), 10);
+    i += add(next() * 10, 1);
+    printf("%d %d\n", i, calls);
+    printf("%d %d %d\n", twice(7), fp(-4), sq(sq(2)));
+
+    p = mkpt(3, 4);
+    printf("%d %d %d\n", p.x, p.y, dot(p, mkpt(5, -6)));
+    printf("%g %Lg %d\n", avg(1, 2.5), half(7.0L), low(0x1234));
+    printf("%s %s\n", pick(1, "yes", "no"), pick(0, "yes", "no"));
+    printf("%d %d\n", addr(41), fact(6));
+
+    for (i = 0; i < 13; i++) {
+        k = find(arr, 6, i);
+        if (k == 4)
+            break;
+        if (k < 0)
+            continue;
+        printf("found %d at %d\n", i, k);
+    }
+    for (i = 0; i < 4; i++)
+        switch (i) {
+        case 1:
+            printf("classify %d\n", classify(i));
+            break;
+        default:
+            printf("classify %d %d\n", classify(i + 1), classify(i - 1));
+        }
+    printf("%d %d\n", sum_to(5), sum_to(101));
+    printf("%d %d\n", stmt_expr(4), stmt_expr(-1));
+    i = uses_static();
+    i = i * 10 + uses_static();
+    printf("%d\n", i);
+    printf("%d\n", big(1) & 0xffff);
+    set(&j, 9);
+    printf("%d %d\n", j, 3 + sq(3) * 2 + (i < 10 ? add(1, 2) : 0));
+    return 0;
+}
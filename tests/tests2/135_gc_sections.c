@@ -0,0 +1,28 @@
+/* per function/variable sections and --gc-sections */
+extern int printf(const char *, ...); /* no <stdio.h>: keep __attribute__ */
+
+int used_data = 42;
+int unused_data[1000] = { 1 };
+static const char used_str[] = "kept";
+static int bss_counter;
+const int ro_table[4] = { 1, 2, 3, 4 };
+
+static int helper(int x) { return x + bss_counter++; }
+static int unused_helper(int x) { return x * unused_data[0]; }
+int unused_global(int x) { return unused_helper(x) + 1; }
+
+static int (*fp)(int) = helper;
+
+static void __attribute__((constructor)) ctor(void)
+{
+    bss_counter = 10;
+}
+
+int main(void)
+{
+    int i, s = 0;
+    for (i = 0; i < 4; i++)
+        s += fp(ro_table[i]);
+    printf("%s %d %d %d\n", used_str, used_data, s, bss_counter);
+    return 0;
+}
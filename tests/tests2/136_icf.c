@@ -0,0 +1,43 @@
+/* identical code folding of macro generated functions (--icf) */
+#include <stdio.h>
+
+#define GEN(T, N) \
+static T sum_##N(const T *p, int n) \
+{ T s = 0; while (n--) s += *p++; return s; } \
+static T twice_##N(const T *p, int n) { return 2 * sum_##N(p, n); }
+
+GEN(int, a) GEN(int, b) GEN(unsigned, c) GEN(long, d) GEN(double, e)
+
+static int fact1(int n) { return n < 2 ? 1 : n * fact1(n - 1); }
+static int fact2(int n) { return n < 2 ? 1 : n * fact2(n - 1); }
+
+/* same code, different data */
+static int tab1[3] = { 1, 2, 3 }, tab2[3] = { 4, 5, 6 };
+static int get1(int i) { return tab1[i]; }
+static int get2(int i) { return tab2[i]; }
+static const char *name1(void) { return "one"; }
+static const char *name2(void) { return "two"; }
+
+/* functions whose address is seen must stay distinct */
+static int one1(void) { return 1; }
+static int one2(void) { return 1; }
+int one3(void) { return 1; }
+int one4(void) { return 1; }
+
+int main(void)
+{
+    int v[] = { 1, 2, 3 };
+    unsigned u[] = { 4, 5, 6 };
+    long l[] = { 7, 8, 9 };
+    double d[] = { 0.5, 0.25 };
+    int (*f)(const int *, int) = twice_b;
+    int (*g[])(void) = { one1, one2 };
+
+    printf("%d %d %u %ld %g\n", twice_a(v, 3), f(v, 2), twice_c(u, 3),
+           twice_d(l, 3), twice_e(d, 2));
+    printf("%d %d\n", fact1(5), fact2(6));
+    printf("%d %d %s %s\n", get1(2), get2(2), name1(), name2());
+    printf("%d %d %d\n", g[0]() + g[1]() + one3() + one4(),
+           g[0] != g[1], one3 != one4);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/* return f(...) as a tail call (-O1), and returns which must stay calls */
+#include <stdio.h>
+#include <string.h>
+
+/* deep recursion: runs out of stack without tail calls */
+static int is_odd(unsigned n);
+static int is_even(unsigned n) { if (n == 0) return 1; return is_odd(n - 1); }
+static int is_odd(unsigned n) { if (n == 0) return 0; return is_even(n - 1); }
+
+static long sum_to(long n, long acc) { if (!n) return acc; return sum_to(n - 1, acc + n); }
+
+typedef int (*state_fn)(const char *p, int n);
+static int st_a(const char *p, int n);
+static int st_b(const char *p, int n);
+static int st_a(const char *p, int n) { if (!*p) return n; return (*p == 'a' ? st_a : st_b)(p + 1, n + 1); }
+static int st_b(const char *p, int n) { if (!*p) return -n; state_fn f = *p == 'b' ? st_b : st_a; return f(p + 1, n + 2); }
+
+/* must not be tail calls */
+static int peek(const int *p) { return *p; }
+static int addr_taken(int x) { int y = x * 2; return peek(&y); }
+static int arr(int x) { int a[4]; a[0] = x; a[1] = x + 1; return peek(a + 1); }
+struct pt { int x, y; };
+static int by_ptr(const struct pt *p) { return p->x + p->y; }
+static int local_struct(int v) { struct pt q = { v, v }; return by_ptr(&q); }
+static int clit(int v) { return peek((int[]){ v, v + 3 }); }
+static int clit2(int v) { const int *p = (int[]){ v * 5 }; return peek(p); }
+static double todouble(int x) { return x / 2.0; }
+static int conv(int x) { return todouble(x); }
+static char ch(int x) { return x; }
+static int conv2(int x) { return ch(x); }
+static int many(int a, int b, int c, int d, int e, int f, int g, int h)
+{ return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8; }
+static int stack_args(int x) { return many(x, 1, 2, 3, 4, 5, 6, 7); }
+static int later_addr(int n)
+{
+    int x = n, *p = 0, r = 0;
+    while (n--) {
+        if (p) return peek(p) + r;
+        p = &x;
+        r++;
+    }
+    return -1;
+}
+static double dsum(double a, double b) { return a + b; }
+static double dtail(double a) { return dsum(a, 0.25); }
+static void vtail2(int *p) { *p += 1; }
+static void vtail(int *p) { return vtail2(p); }
+static int side;
+static int with_comma(int x) { return side = x, peek(&side); }
+/* 't' gets a register in the loop after the tail call, which must
+   restore it on the second round */
+static int noinline_id(int x) { return x; }
+static int loop_tail(int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        if (i == 2)
+            return noinline_id(i);
+        {
+            int t = i * 3;
+            t += t * t; t ^= t >> 1; t += t * 7;
+            side += t;
+        }
+    }
+    return -1;
+}
+static int regs_kept(int n)
+{
+    int a = n, b = n + 1, c = n + 2, k;
+    for (k = 0; k < 3; k++)
+        a += k, b += a, c += b;
+    loop_tail(a);
+    return a + b + c;
+}
+
+int main(void)
+{
+    char buf[4001];
+    int i, z = 5;
+    memset(buf, 'a', 4000); buf[4000] = 0;
+    for (i = 0; i < 4000; i += 3) buf[i] = 'b';
+    printf("%d %d\n", is_even(1000000), is_odd(1000001));
+    printf("%ld\n", sum_to(1000000, 0));
+    printf("%d\n", st_a(buf, 0));
+    printf("%d %d %d %d %d\n", addr_taken(21), arr(7), local_struct(4), clit(9), clit2(3));
+    printf("%d %d %d %d\n", conv(7), conv2(300), stack_args(1), later_addr(3));
+    vtail(&z);
+    printf("%g %d %d\n", dtail(1.5), z, with_comma(11));
+    printf("%d\n", regs_kept(10));
+    return 0;
+}
@@ -0,0 +1,38 @@
+/* leaf functions without a frame (-O1): arguments, locals in the red
+   zone, stack arguments and the scratch uses of the stack */
+#include <stdio.h>
+
+struct pt { int x, y; };
+struct big { long a[4]; };
+
+static int add(int a, int b) { return a + b; }
+static long last(long a, long b, long c, long d, long e, long f, long g, long h)
+{
+    return g * 10 + h;
+}
+static int dot(struct pt p, struct pt q) { return p.x * q.x + p.y * q.y; }
+static long third(struct big b) { return b.a[2]; }
+static struct pt swap(struct pt p) { struct pt q; q.x = p.y; q.y = p.x; return q; }
+static long double widen(int i) { return i; }
+static long double widen_u(unsigned u) { return u; }
+static double mix(float f, int i) { return f * i; }
+static int fill(int k) { char buf[80]; int i; for (i = 0; i < 80; i++) buf[i] = i ^ k; return buf[k] + buf[79]; }
+static int big_frame(int k) { int a[40]; int i; for (i = 0; i < 40; i++) a[i] = i * k; return a[k]; }
+static void *frame(void) { return __builtin_frame_address(0); }
+static int nested(int x) { return add(x, 1) * 2; }
+
+int main(void)
+{
+    struct pt p = { 3, 4 }, q = { 5, 6 }, r;
+    struct big b = { { 1, 2, 3, 4 } };
+    int i, s = 0;
+
+    for (i = 0; i < 100; i++)
+        s += add(i, s & 7) ^ fill(i & 63);
+    r = swap(p);
+    printf("%d %ld %d %ld %d %d\n", s, last(1, 2, 3, 4, 5, 6, 7, 8),
+           dot(p, q), third(b), r.x, r.y);
+    printf("%.1Lf %.1Lf %.1f %d %d %d\n", widen(-7), widen_u(4000000000u),
+           mix(1.5f, 3), big_frame(5), frame() != 0, nested(20));
+    return 0;
+}
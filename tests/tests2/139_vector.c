@@ -0,0 +1,138 @@
+/* GCC vector extensions */
+int printf(const char *, ...);
+
+typedef int v4si __attribute__((vector_size(16)));
+typedef unsigned v4su __attribute__((vector_size(16)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef signed char v16qi __attribute__((vector_size(16)));
+typedef unsigned char v16qu __attribute__((vector_size(16)));
+typedef long long v2di __attribute__((vector_size(16)));
+typedef float v4sf __attribute__((vector_size(16)));
+typedef double v2df __attribute__((vector_size(16)));
+typedef int v2si __attribute__((vector_size(8)));
+typedef float v2sf __attribute__((vector_size(8)));
+typedef int v8si __attribute__((vector_size(32)));
+typedef double v4df __attribute__((vector_size(32)));
+
+#define PR(v, n, f) do { int i_; for (i_ = 0; i_ < n; i_++) \
+    printf(f, (v)[i_]); printf("\n"); } while (0)
+
+static v4si gi = { 1, 2, 3, 4 };
+static v4sf gf = { 0.5, 1.5, -2.5, 3.25 };
+
+v4si add4(v4si a, v4si b) { return a + b; }
+v4sf madd(v4sf a, v4sf b, v4sf c) { return a * b + c; }
+v2df sub2(v2df a, v2df b) { return a - b; }
+v2si mul2(v2si a, v2si b) { return a * b; }
+v8si add8(v8si a, v8si b) { return a + b; }
+v4df div4(v4df a, v4df b) { return a / b; }
+
+/* more vector arguments than registers */
+v4si sum9(v4si a, v4si b, v4si c, v4si d, v4si e, v4si f, v4si g,
+          v4si h, v4si i)
+{
+    return a + b + c + d + e + f + g + h + i;
+}
+
+struct sv { v4si v; int x; };
+
+int main(void)
+{
+    v4si a = { 1, -2, 3, -4 }, b = { 10, 20, 30, 40 }, c, *p = &c;
+    v4su ua = { 1, 0xffffffff, 7, 0x80000000 }, ub = { 2, 1, 7, 1 };
+    v8hi h = { 1, 2, 3, 4, 5, 6, 7, -8 }, h2 = { 3, 3, 3, 3, -3, -3, -3, 3 };
+    v16qi q = { 1, -1, 2, -2, 3, -3, 4, -4, 5, -5, 6, -6, 7, -7, 127, -128 };
+    v16qu uq = { 255, 0, 1, 200 };
+    v2di l = { 1LL << 40, -5 }, l2 = { 3, 7 };
+    v4sf f = { 1.5, -2, 0.25, 8 }, f2 = { 2, 2, -0.5, 0 };
+    v2df d = { 1.0 / 3, -7.5 }, d2 = { 2, 2.5 };
+    v2si s = { 6, -7 };
+    v2sf sf = { 1.25, 2.5 };
+    v8si e = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    v4df df = { 1, 2, 3, 4 };
+    struct sv st;
+    int i, k = 3;
+
+    printf("%d %d %d\n", (int)sizeof(v4si), (int)sizeof(v2si), (int)sizeof(v8si));
+    printf("%d %d\n", (int)__alignof__(v4sf), (int)__alignof__(v2sf));
+
+    c = a + b; PR(c, 4, "%d ");
+    c = a - b; PR(c, 4, "%d ");
+    c = a * b; PR(c, 4, "%d ");
+    c = b / a; PR(c, 4, "%d ");
+    c = b % a; PR(c, 4, "%d ");
+    c = a & b; PR(c, 4, "%d ");
+    c = a | b; PR(c, 4, "%d ");
+    c = a ^ b; PR(c, 4, "%d ");
+    c = b << 2; PR(c, 4, "%d ");
+    c = a >> 1; PR(c, 4, "%d ");
+    c = a == (v4si){ 1, 2, 3, 4 }; PR(c, 4, "%d ");
+    c = a != (v4si){ 1, 2, 3, 4 }; PR(c, 4, "%d ");
+    c = a < b; PR(c, 4, "%d ");
+    c = a > 0; PR(c, 4, "%d ");
+    c = a <= -2; PR(c, 4, "%d ");
+    c = a >= 3; PR(c, 4, "%d ");
+    c = -a; PR(c, 4, "%d ");
+    c = ~a; PR(c, 4, "%d ");
+    c = +a; PR(c, 4, "%d ");
+    c = a + k; PR(c, 4, "%d ");
+    c = 100 - a; PR(c, 4, "%d ");
+    c += a; PR(c, 4, "%d ");
+    c *= 2; PR(*p, 4, "%d ");
+    c[2] = 42; (*p)[0]++; PR(c, 4, "%d ");
+    printf("%d\n", a[k] + a[1]);
+
+    ua = ua >> 1; PR(ua, 4, "%u ");
+    c = ua < ub; PR(c, 4, "%d ");
+    c = ua > ub; PR(c, 4, "%d ");
+    c = ua == ub; PR(c, 4, "%d ");
+
+    h = h * h2; PR(h, 8, "%d ");
+    h = h + h2; PR(h, 8, "%d ");
+    h = h - 1; PR(h, 8, "%d ");
+    PR(h > h2, 8, "%d ");
+    PR(h <= h2, 8, "%d ");
+    q = q + q; PR(q, 16, "%d ");
+    q = q < 0; PR(q, 16, "%d ");
+    uq = uq + 100; PR(uq, 16, "%d ");
+    PR(uq > 150, 16, "%d ");
+    l = l + l2; PR(l, 2, "%lld ");
+    l = l * l2; PR(l, 2, "%lld ");
+    PR(l > 0, 2, "%lld ");
+    PR(l == l, 2, "%lld ");
+    l = l << 3; PR(l, 2, "%lld ");
+
+    f = f + f2; PR(f, 4, "%g ");
+    f = f * f2; PR(f, 4, "%g ");
+    f = f / f2; PR(f, 4, "%g ");
+    f = f - 1; PR(f, 4, "%g ");
+    f = -f; PR(f, 4, "%g ");
+    PR(f < f2, 4, "%d ");
+    PR(f >= f2, 4, "%d ");
+    PR(f == f2, 4, "%d ");
+    PR(f != f2, 4, "%d ");
+    PR(f > 0, 4, "%d ");
+    f = -(v4sf){ 0, 1, -0.0, 2 }; PR(f, 4, "%g ");
+    d = d * d2 + 1; PR(d, 2, "%g ");
+    PR(d <= d2, 2, "%lld ");
+    d = sub2(d, d2); PR(d, 2, "%g ");
+    s = mul2(s, s + 1); PR(s, 2, "%d ");
+    sf = sf * 2; PR(sf, 2, "%g ");
+    e = add8(e, e * 3); PR(e, 8, "%d ");
+    df = div4(df, df + 1); PR(df, 4, "%g ");
+
+    c = add4(a, b); PR(c, 4, "%d ");
+    f = madd(gf, gf, f2); PR(f, 4, "%g ");
+    c = sum9(a, b, c, gi, a, b, c, gi, a); PR(c, 4, "%d ");
+    gi = gi * gi; PR(gi, 4, "%d ");
+    st.v = gi + 1; st.x = 5; PR(st.v, 4, "%d ");
+    p = &st.v; PR(*p - st.x, 4, "%d ");
+
+    c = (v4si)f; PR(c, 4, "%08x ");
+    l = (v2di)a; PR(l, 2, "%llx ");
+    i = ((v4si)(long long __attribute__((vector_size(16)))){ 3, 4 })[2];
+    printf("%d\n", i);
+    s = (v2si)0x500000007LL; PR(s, 2, "%d ");
+    printf("%llx\n", (long long)(v2si){ 1, 2 });
+    return 0;
+}
@@ -0,0 +1,192 @@
+/* __builtin_expect, cold and hot functions */
+int printf(const char *, ...);
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+static int nb_errors;
+
+__attribute__((cold)) static void error(const char *msg, int v)
+{
+    nb_errors++;
+    printf("error: %s %d\n", msg, v);
+}
+
+__attribute__((hot)) static int sum(const int *p, int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; i++) {
+        if (unlikely(p[i] < 0)) {
+            error("negative", p[i]);
+            continue;
+        }
+        if (unlikely(p[i] == 99))
+            break;
+        s += p[i];
+    }
+    return s;
+}
+
+static int parse(const char *s)
+{
+    int v = 0;
+    while (*s) {
+        if (likely(*s >= '0' && *s <= '9'))
+            v = v * 10 + *s - '0';
+        else if (*s == '_')
+            ;
+        else
+            goto fail;
+        s++;
+    }
+    return v;
+fail:
+    error("bad char", *s);
+    return -1;
+}
+
+/* names declared after the 'if' don't hide those before it */
+static int shadow(int x)
+{
+    int y = 10;
+    {
+        if (unlikely(x > 5))
+            return y + x;
+        int y = 20;
+        if (__builtin_expect(x == 3, 0)) {
+            int z = y * 2;
+            return z;
+        }
+        return y;
+    }
+}
+
+/* the likely branch returns before the unlikely one */
+static int pick(int x)
+{
+    if (unlikely(x & 1))
+        return x * 3;
+    else
+        return x / 2;
+}
+
+static int cleanups;
+static void done(int *p) { cleanups += *p; }
+
+static int cleanup(int x)
+{
+    if (unlikely(x == 1))
+        return -1;
+    int __attribute__((cleanup(done))) a = x;
+    if (unlikely(x == 2))
+        return -2;
+    int __attribute__((cleanup(done))) b = 100;
+    if (unlikely(x == 3))
+        return -3;
+    return a + b;
+}
+
+static int sw(int x)
+{
+    int r = 0;
+    switch (x) {
+    case 1:
+        if (unlikely(r == 0)) {
+            r = 11;
+            break;
+        }
+        r = 12;
+        break;
+    case 2:
+        if (likely(x))
+            r = 21;
+        else {
+    case 3:
+            r = 31;
+        }
+        break;
+    case 4: {
+        /* the break after the block is reached by the jump over the
+           cold code only */
+        if (unlikely(x == 4)) {
+            r = 41;
+            break;
+        }
+        r = 42;
+        }
+        break;
+    }
+    return r;
+}
+
+static int conds(int a, int b)
+{
+    int r = 0;
+    if (unlikely(a) || unlikely(b))
+        r |= 1;
+    if (likely(a) && likely(b))
+        r |= 2;
+    else
+        r |= 4;
+    if (!unlikely(a))
+        r |= 8;
+    if (__builtin_expect_with_probability(a + b, 3, 0.05))
+        r |= 16;
+    else
+        r |= 32;
+    if (__builtin_expect(a, 0))
+        lbl: r |= 64;
+    if (unlikely(b == 7)) {
+        b = 0;
+        goto lbl;
+    }
+    return r + __builtin_expect(b, 1);
+}
+
+static int vla(int n)
+{
+    int s = 0, i;
+    for (i = 0; i < n; i++) {
+        if (unlikely(i == 3)) {
+            int v[i + 1];
+            v[i] = 1000;
+            s += v[i];
+            continue;
+        }
+        int w[n];
+        w[i] = i;
+        s += w[i];
+    }
+    return s;
+}
+
+int main(void)
+{
+    int a[] = { 1, 2, -3, 4, 99, 5 };
+    int i;
+
+    printf("%d\n", sum(a, 6));
+    printf("%d %d %d\n", parse("12_34"), parse("12x"), parse(""));
+    for (i = 0; i < 8; i++)
+        printf("%d ", shadow(i));
+    printf("\n");
+    for (i = 0; i < 5; i++)
+        printf("%d ", cleanup(i));
+    printf("%d\n", cleanups);
+    for (i = 0; i < 5; i++)
+        printf("%d ", sw(i));
+    printf("\n");
+    for (i = 0; i < 9; i++)
+        printf("%d ", conds(i % 3, i / 3 * 3 + 1));
+    printf("%d\n", conds(0, 7));
+    printf("%d\n", vla(6));
+    printf("%d %d\n", pick(6), pick(7));
+    printf("%d errors\n", nb_errors);
+#ifdef __TINYC__
+    /* cold code is placed after the other code */
+    printf("%d\n", (char *)error > (char *)main);
+#else
+    printf("1\n");
+#endif
+    return 0;
+}
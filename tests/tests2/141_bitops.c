@@ -0,0 +1,76 @@
+/* __builtin_popcount, ctz, clz, ffs and bswap */
+#include <stdio.h>
+
+typedef unsigned long long ull;
+
+static const ull vals[] = {
+    1, 2, 3, 0x80, 0xff, 0x100, 0x1234, 0x8000, 0xffff, 0x10000,
+    0x12345678, 0x7fffffff, 0x80000000, 0xdeadbeef, 0xffffffff,
+    0x100000000ull, 0x123456789abcdef0ull, 0x7fffffffffffffffull,
+    0x8000000000000000ull, 0xfedcba9876543210ull, 0xffffffffffffffffull,
+    0x0000000100000001ull, 0x4000000000000000ull, 0x0f0f0f0f0f0f0f0full,
+};
+
+static unsigned h;
+
+static void mix(unsigned long long x)
+{
+    h = (h ^ (unsigned)x ^ (unsigned)(x >> 32)) * 16777619;
+}
+
+int main(void)
+{
+    int i, n = sizeof vals / sizeof vals[0];
+    /* constant arguments fold to constants */
+    static int c[] = {
+        __builtin_popcount(0x0f0f), __builtin_popcountll(~0ull),
+        __builtin_ctz(0x100), __builtin_ctzll(1ull << 40),
+        __builtin_clz(1), __builtin_clzll(0x80ull), __builtin_ffs(0),
+        __builtin_ffs(0x30), __builtin_ffsll(1ull << 63),
+        __builtin_bswap16(0x1234), (int)__builtin_bswap32(0x11223344),
+        (int)(__builtin_bswap64(0x0102030405060708ull) >> 32),
+    };
+    char a[__builtin_popcountl(7)];
+
+    for (i = 0; i < sizeof c / sizeof c[0]; i++)
+        printf("%x ", c[i]);
+    printf("%d\n", (int)sizeof a);
+
+    for (i = 0; i < n; i++) {
+        volatile ull v = vals[i];
+        ull x = v;
+        unsigned u = x;
+        unsigned long l = x;
+        unsigned short s = x;
+
+        mix(__builtin_popcount(u));
+        mix(__builtin_popcountl(l));
+        mix(__builtin_popcountll(x));
+        if (u) {
+            mix(__builtin_ctz(u));
+            mix(__builtin_clz(u));
+        }
+        if (l) {
+            mix(__builtin_ctzl(l));
+            mix(__builtin_clzl(l));
+        }
+        mix(__builtin_ctzll(x));
+        mix(__builtin_clzll(x));
+        mix(__builtin_ffs(u));
+        mix(__builtin_ffsl(l));
+        mix(__builtin_ffsll(x));
+        mix(__builtin_ffs(0 * u));
+        mix(__builtin_bswap16(s));
+        mix(__builtin_bswap32(u));
+        mix(__builtin_bswap64(x));
+        /* the results have the types of gcc */
+        mix(__builtin_bswap16(s) + 0x10000 * __builtin_bswap16(~s));
+        mix(__builtin_bswap32(u) >> 28);
+        mix(__builtin_popcount(u) - 40 < 0);
+        printf("%016llx %2d %2d %2d %2d %08x\n", x, __builtin_popcountll(x),
+               __builtin_ctzll(x), __builtin_clzll(x), __builtin_ffsll(x),
+               __builtin_bswap32(u));
+    }
+    printf("%08x\n", h);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/* inline atomic operations on all integer sizes and memory orders */
+#include <stdio.h>
+#include <stdatomic.h>
+
+#define T(ty, fmt) { \
+    ty a = (ty)0x5a, e, r; \
+    int ok; \
+    r = atomic_fetch_add_explicit(&a, (ty)3, memory_order_seq_cst); \
+    printf(#ty " add " fmt " " fmt "\n", r, a); \
+    r = atomic_fetch_sub_explicit(&a, (ty)0x70, memory_order_relaxed); \
+    printf(#ty " sub " fmt " " fmt "\n", r, a); \
+    r = atomic_fetch_or_explicit(&a, (ty)0x81, memory_order_acquire); \
+    printf(#ty " or " fmt " " fmt "\n", r, a); \
+    r = atomic_fetch_xor_explicit(&a, (ty)0xff, memory_order_release); \
+    printf(#ty " xor " fmt " " fmt "\n", r, a); \
+    r = atomic_fetch_and_explicit(&a, (ty)0xf3, memory_order_acq_rel); \
+    printf(#ty " and " fmt " " fmt "\n", r, a); \
+    r = atomic_exchange_explicit(&a, (ty)-7, memory_order_seq_cst); \
+    printf(#ty " xchg " fmt " " fmt "\n", r, a); \
+    atomic_store_explicit(&a, (ty)-2, memory_order_seq_cst); \
+    r = atomic_load_explicit(&a, memory_order_acquire); \
+    printf(#ty " store/load " fmt "\n", r); \
+    atomic_store_explicit(&a, (ty)9, memory_order_relaxed); \
+    r = atomic_load_explicit(&a, memory_order_relaxed); \
+    printf(#ty " store/load " fmt "\n", r); \
+    e = 3; \
+    ok = atomic_compare_exchange_strong(&a, &e, (ty)-100); \
+    printf(#ty " cas %d " fmt " " fmt "\n", ok, e, a); \
+    ok = atomic_compare_exchange_strong(&a, &e, (ty)-100); \
+    printf(#ty " cas %d " fmt " " fmt "\n", ok, e, a); \
+    while (!atomic_compare_exchange_weak_explicit(&a, &e, (ty)1, \
+            memory_order_acquire, memory_order_relaxed)) \
+        ; \
+    printf(#ty " cas " fmt " " fmt "\n", e, a); \
+}
+
+struct s { char c; short s[3]; } st = { 1, { 2, 3, 4 } };
+
+int main(void)
+{
+    T(char, "%d")
+    T(signed char, "%d")
+    T(unsigned char, "%d")
+    T(short, "%d")
+    T(unsigned short, "%d")
+    T(int, "%d")
+    T(unsigned, "%u")
+    T(long, "%ld")
+    T(unsigned long long, "%llu")
+    {
+        _Bool b = 0;
+        printf("%d ", atomic_exchange(&b, 1));
+        printf("%d\n", b);
+    }
+    {
+        int x = 1, y = 2, *p = &x, *q;
+        q = atomic_exchange(&p, &y);
+        printf("%d %d\n", *q, *p);
+    }
+    /* neighbours of sub-word objects stay untouched */
+    atomic_fetch_add(&st.s[1], 0x7fff);
+    atomic_fetch_xor(&st.c, -1);
+    if (atomic_compare_exchange_strong(&st.s[2], &st.s[0], 5))
+        printf("bad\n");
+    printf("%d %d %d %d\n", st.c, st.s[0], st.s[1], st.s[2]);
+    return 0;
+}
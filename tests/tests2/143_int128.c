@@ -0,0 +1,133 @@
+/* __int128 arithmetic */
+#include <stdio.h>
+
+typedef __int128 i128;
+typedef unsigned __int128 u128;
+typedef unsigned long long u64;
+
+static void pr(const char *s, u128 x)
+{
+    printf("%s %016llx%016llx\n", s, (u64)(x >> 64), (u64)x);
+}
+
+/* wyhash / mum style 64x64->128 multiply and fold */
+static u64 mum(u64 a, u64 b)
+{
+    u128 r = (u128)a * b;
+    return (u64)r ^ (u64)(r >> 64);
+}
+
+static u128 mix(u128 a, u128 b, u128 c, u128 d, u128 e)
+{
+    return a * 3 + b - c * d + (e ^ a);
+}
+
+static i128 sdiv(i128 a, i128 b) { return a / b; }
+static i128 smod(i128 a, i128 b) { return a % b; }
+static u128 shl(u128 a, int n) { return a << n; }
+static u128 shr(u128 a, int n) { return a >> n; }
+static i128 sar(i128 a, int n) { return a >> n; }
+
+static const u128 tab[] = {
+    0, 1, (u128)1 << 64, ((u128)0x0123456789abcdefULL << 64) | 0xfedcba9876543210ULL,
+    -(u128)1, (u128)-5
+};
+static i128 g = -1000000000000LL * 1000000;
+
+struct s { char c; i128 x; };
+
+int main(void)
+{
+    u128 a = ((u128)0x0123456789abcdefULL << 64) | 0xfedcba9876543210ULL;
+    u128 b = 0xffffffffffffffffULL;
+    i128 n = -12345678901234567LL;
+    volatile int k;
+    int i;
+    u64 h = 0;
+    struct s st;
+
+    pr("a", a);
+    pr("a+b", a + b);
+    pr("a-b", a - b);
+    pr("b-a", b - a);
+    pr("a*b", a * b);
+    pr("a*a", a * a);
+    pr("a&b", a & b);
+    pr("a|b", a | b);
+    pr("a^b", a ^ b);
+    pr("~a", ~a);
+    pr("-a", -a);
+    pr("a*8", a * 8);
+    pr("a*10", a * 10);
+    pr("a/16", a / 16);
+    pr("a/b", a / b);
+    pr("a%b", a % b);
+    pr("a/10", a / 10);
+    pr("a%10", a % 10);
+    pr("n/7", sdiv(n * n * n, 7));
+    pr("n%7", smod(n * n * n, 7));
+    pr("n/-7", sdiv(n * n, -7));
+    for (k = 0; k < 128; k += 13) {
+        printf("%3d", k);
+        pr(" <<", shl(a, k));
+        pr("    >>", shr(a, k));
+        pr("    sar", sar(-(i128)a, k));
+        pr("    <<v", a << k);
+    }
+    pr("<<1", a << 1);
+    pr("<<63", a << 63);
+    pr("<<64", a << 64);
+    pr("<<100", a << 100);
+    pr(">>1", a >> 1);
+    pr(">>64", a >> 64);
+    pr(">>70", a >> 70);
+    pr("sar>>70", (i128)-a >> 70);
+    pr("sar>>64", (i128)-a >> 64);
+    printf("%d %d %d %d\n", a > b, a < b, a == a, a != a);
+    printf("%d %d %d\n", n < 0, (u128)n < 0, -(i128)a < (i128)b);
+    printf("%d %d\n", (i128)1 << 100 > (i128)1 << 99, !(a - a));
+    for (i = 0; i < 6; i++) {
+        pr("tab", tab[i]);
+        h = h * 31 + mum(h + (u64)tab[i], 0x9e3779b97f4a7c15ULL);
+    }
+    printf("%016llx\n", h);
+    pr("g", g);
+    pr("mix", mix(a, b, tab[3], tab[5], a + 7));
+    st.c = 1;
+    st.x = n;
+    printf("%d %d\n", (int)sizeof(st), (int)_Alignof(i128));
+    pr("st.x", st.x);
+    printf("%lld %llu %d %d\n", (long long)n, (u64)(u128)-1, (int)(a >> 120),
+           (_Bool)(a << 64 >> 64 == 0));
+    printf("%.1f %.1f %.1f\n", (double)((u128)1 << 100), (double)n,
+           (double)(i128)-1);
+    pr("dbl", (u128)1e30);
+    pr("dbl", (i128)-1e20);
+    pr("dbl", (i128)(double)n);
+    {
+        double d = 3e25;
+        float f = -7.5e18f;
+        pr("d", (u128)d);
+        pr("f", (i128)f);
+        printf("%.1f\n", (double)(i128)f);
+    }
+    {
+        /* rounded once, as gcc does */
+        volatile u128 x = ((u128)1 << 64) + ((u128)1 << 11) + 1;
+        volatile u128 y = ((u128)0x8000000000000001ULL << 64) | 1ULL << 63;
+        volatile i128 z = -(((i128)0x123456789abcdefLL << 64) | 0x8000000001ULL);
+        volatile long double l = 1.2345678901234567891e30L;
+        volatile float f = 1.7e38f;
+
+        printf("%a %a %La\n", (double)x, (float)x, (long double)x);
+        printf("%La %a %a %La\n", (long double)y, (double)z, (float)z,
+               (long double)z);
+        printf("%a %a\n", (double)(u128)(((u128)1 << 64) + ((u128)1 << 11) + 1),
+               (float)(u128)-1);
+        pr("ld", (u128)1.2345678901234567891e30L);
+        pr("ld", (u128)l);
+        pr("ld", (i128)-l);
+        pr("f", (u128)f);
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* va_arg of all kinds of types, in registers and on the stack */
+#include <stdio.h>
+#include <stdarg.h>
+
+struct s1 { char c; };
+struct s2 { int a, b; };
+struct s3 { long long a, b; };
+struct s4 { double d; };
+struct s5 { double a, b; };
+struct s6 { long long a, b, c; };
+
+static void ints(int n, ...)
+{
+    va_list ap;
+    long long sum = 0;
+    int i;
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++) {
+        switch (i % 4) {
+        case 0: sum = sum * 3 + va_arg(ap, int); break;
+        case 1: sum = sum * 3 + va_arg(ap, long long); break;
+        case 2: sum = sum * 3 + (long)va_arg(ap, char *); break;
+        case 3: sum = sum * 3 + va_arg(ap, unsigned); break;
+        }
+    }
+    va_end(ap);
+    printf("%d: %lld\n", n, sum);
+}
+
+static void doubles(int n, ...)
+{
+    va_list ap, aq;
+    double sum = 0;
+    int i;
+
+    va_start(ap, n);
+    va_copy(aq, ap);
+    for (i = 0; i < n; i++)
+        sum = sum * 0.5 + va_arg(ap, double);
+    printf("%d: %g", n, sum);
+    sum = 0;
+    for (i = 0; i < n; i++)
+        sum += va_arg(aq, double) * i;
+    printf(" %g\n", sum);
+    va_end(aq);
+    va_end(ap);
+}
+
+static void mixed(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    for (; *fmt; fmt++) {
+        switch (*fmt) {
+        case 'i': printf(" %d", va_arg(ap, int)); break;
+        case 'l': printf(" %lld", va_arg(ap, long long)); break;
+        case 'd': printf(" %g", va_arg(ap, double)); break;
+        case 'L': printf(" %Lg", va_arg(ap, long double)); break;
+        case '1': printf(" %c", va_arg(ap, struct s1).c); break;
+        case '2': {
+            struct s2 s = va_arg(ap, struct s2);
+            printf(" %d/%d", s.a, s.b);
+            break;
+        }
+        case '3': {
+            struct s3 s = va_arg(ap, struct s3);
+            printf(" %lld/%lld", s.a, s.b);
+            break;
+        }
+#ifdef __SIZEOF_INT128__
+        case 'q': {
+            unsigned __int128 q = va_arg(ap, unsigned __int128);
+            printf(" %llx:%llx", (long long)(q >> 64), (long long)q);
+            break;
+        }
+#endif
+        case '4': printf(" %g", va_arg(ap, struct s4).d); break;
+        case '5': {
+            struct s5 s = va_arg(ap, struct s5);
+            printf(" %g/%g", s.a, s.b);
+            break;
+        }
+        case '6': {
+            struct s6 s = va_arg(ap, struct s6);
+            printf(" %lld/%lld/%lld", s.a, s.b, s.c);
+            break;
+        }
+        }
+    }
+    va_end(ap);
+    printf("\n");
+}
+
+static void pass(va_list ap)
+{
+    int a = va_arg(ap, int);
+    double d = va_arg(ap, double);
+    printf("pass %d %g\n", a, d);
+}
+
+static void outer(int n, ...)
+{
+    va_list ap;
+    va_start(ap, n);
+    pass(ap);
+    pass(ap);
+    va_end(ap);
+}
+
+int main(void)
+{
+    struct s1 s1 = { 'x' };
+    struct s2 s2 = { 1, 2 };
+    struct s3 s3 = { 3, 4 };
+    struct s4 s4 = { 5.5 };
+    struct s5 s5 = { 6.5, 7.5 };
+    struct s6 s6 = { 8, 9, 10 };
+
+    ints(3, 1, 2LL, (char *)3);
+    ints(12, 1, 2LL, (char *)3, 4u, 5, 6LL, (char *)7, 8u,
+         9, 10LL, (char *)11, 12u);
+    doubles(2, 1.0, 2.0);
+    doubles(12, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0,
+            11.0, 12.0);
+    mixed("idlLi", 1, 2.5, 3LL, 4.25L, 5);
+    mixed("123456", s1, s2, s3, s4, s5, s6);
+    mixed("iiiiii12d3d4i5d6dLi", 1, 2, 3, 4, 5, 6, s1, s2, 7.5, s3, 8.5,
+          s4, 9, s5, 10.5, s6, 11.5, 12.75L, 13);
+    mixed("dddddddd2i4d", 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, s2, 9,
+          s4, 10.0);
+#ifdef __SIZEOF_INT128__
+    mixed("iqiqiqi", 1, (unsigned __int128)2 << 64 | 3, 4,
+          (unsigned __int128)5 << 64 | 6, 7, (unsigned __int128)8 << 64 | 9, 10);
+#endif
+    outer(0, 1, 2.0, 3, 4.0);
+    return 0;
+}
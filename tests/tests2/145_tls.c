@@ -0,0 +1,39 @@
+/* __thread and _Thread_local variables */
+#include <stdio.h>
+#include <pthread.h>
+
+__thread int counter = 5;
+_Thread_local char name[8] = "main";
+static __thread long sum[4];
+static __thread struct { int a; double d; } st = { 1, 2.5 };
+
+static void *run(void *arg)
+{
+    int id = (int)(long)arg, i;
+    int *p = &counter;
+
+    for (i = 0; i < 100; i++) {
+        counter += i;
+        sum[i & 3] += i * id;
+    }
+    *p *= 2;
+    name[0] = '0' + id;
+    st.a += id, st.d *= id;
+    printf("%d: %d %ld %ld %s %d %g\n", id,
+           counter, sum[0], sum[3], name, st.a, st.d);
+    return arg;
+}
+
+int main(void)
+{
+    pthread_t t[4];
+    long i;
+
+    for (i = 0; i < 4; i++) {
+        pthread_create(&t[i], NULL, run, (void *)(i + 1));
+        pthread_join(t[i], NULL);
+    }
+    run(0);
+    printf("%d %s %d\n", counter, name, (int)sizeof st);
+    return 0;
+}
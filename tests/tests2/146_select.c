@@ -0,0 +1,45 @@
+/* '?:' with simple operands, computed without branches with -O */
+#include <stdio.h>
+
+enum { LO = -3, HI = 7 };
+int g1 = 11, g2 = -22;
+static long long gl = 1LL << 40;
+unsigned char uc = 200;
+signed char sc = -100;
+short sh = -30000;
+_Bool bb = 1;
+int arr[3];
+
+static int imin(int a, int b) { return a < b ? a : b; }
+static unsigned umax(unsigned a, unsigned b) { return a > b ? a : b; }
+static long long lmin(long long a, long long b) { return a <= b ? a : b; }
+static int clamp(int x) { x = x < LO ? LO : x; return x > HI ? HI : x; }
+static int sel(int c, int a) { return c ? a : -1; }
+static int *psel(int c, int *p) { return c ? p : 0; }
+static long long mix(int c) { return c ? gl : uc; }
+static int chars(int c) { return c > 0 ? sc : c < 0 ? sh : bb; }
+static int both(int a, int b) { return a && b ? 5 : 6; }
+static int deref(int *p) { return p ? *p : -1; }
+
+static int flt(double a, double b) { return a < b ? 1 : 2; }
+static int fne(double a, double b) { return a != b ? g1 : g2; }
+static int fnoteq(double a, double b) { return !(a == b) ? g1 : g2; }
+static int fnotlt(double a, double b) { return !(a < b) ? g1 : g2; }
+
+int main(void)
+{
+    int i;
+    double nan = 0.0 / 0.0;
+
+    for (i = -10; i <= 10; i += 5)
+        printf("%d %d %u %lld %d %d %d %lld %d %d %d\n",
+               imin(i, 3), clamp(i), umax(i, 3), lmin(i, -5), sel(i, i * 2),
+               psel(i, arr) == arr, psel(i & 4, arr) == arr, mix(i),
+               chars(i), both(i, i + 5), deref(i ? &g1 : 0));
+    printf("%d %d %d %d\n", flt(1, 2), flt(2, 1), flt(nan, 1), flt(1, nan));
+    printf("%d %d %d\n", fne(1, 1), fne(1, 2), fne(nan, nan));
+    printf("%d %d %d\n", fnoteq(1, 1), fnoteq(1, 2), fnoteq(nan, nan));
+    printf("%d %d %d\n", fnotlt(1, 1), fnotlt(1, 2), fnotlt(nan, 1));
+    printf("%d %d\n", g1 > 0 ? HI : LO, (g1 < g2 ? g1 : g2) + 1);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/* float and double math with -msse2 on i386 */
+#include <stdio.h>
+#include <stdarg.h>
+
+#if defined __i386__ && !defined __SSE2_MATH__
+#error "no -msse2"
+#endif
+
+double gd = 1.5, gd2 = -2.25, zero;
+float gf = 3.25f, gf2 = 0.1f;
+long double gl = 7.125L;
+unsigned gu = 4000000000u;
+long long gll = -123456789012345LL;
+
+static double add3(double a, float b, double c) { return a + b * c; }
+static float fmul(float a, float b) { return a * b; }
+static long double ladd(long double a, double b) { return a + b; }
+
+static double sum(int n, ...)
+{
+    va_list ap;
+    double s = 0;
+    int i;
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++)
+        s = s * 3 + va_arg(ap, double);
+    va_end(ap);
+    return s;
+}
+
+/* more live values than xmm registers */
+static double many(double a, double b)
+{
+    double c = a + 1, d = b * 2, e = a - b, f = a / b, g = c * d, h = e + f,
+           i = g - h, j = i * a, k = j / 3, l = k + c;
+    return (a + b) * (c - d) + (e * f) - (g / h) + i * j - k * l
+        + c * d * e * f * g * h;
+}
+
+static int cmps(double a, double b)
+{
+    return (a < b) | (a <= b) << 1 | (a > b) << 2 | (a >= b) << 3
+        | (a == b) << 4 | (a != b) << 5;
+}
+
+static int brs(float a, float b)
+{
+    int r = 0;
+    if (a < b) r |= 1;
+    if (a <= b) r |= 2;
+    if (a > b) r |= 4;
+    if (a >= b) r |= 8;
+    if (a == b) r |= 16;
+    if (a != b) r |= 32;
+    return r;
+}
+
+int main(void)
+{
+    double d = gd, e = gd2, nan = zero / zero;
+    double v[] = { 1, -1, 0, -0.0 };
+    float f = gf, g = gf2;
+    int i, j;
+
+    printf("%.17g %.17g %.17g %.17g %g %g\n", d + e, d - e, d * e, d / e, -d, -zero);
+    printf("%.9g %.9g %.9g %.9g %g\n", f + g, f - g, f * g, f / g, -f);
+    printf("%.17g %.17g %.17g\n", d * 0.1, 1 / 3.0 + d, f * 3.0f + g);
+    printf("%.17g %.9g %.17g\n", add3(d, f, e), fmul(f, g), sum(4, 1.0, d, e, (double)f));
+    printf("%.17g %.9g\n", (double)ladd(gl, d), (float)(gl * e));
+    printf("%.17g %.17g\n", many(d, e), many(3.3, -0.7));
+    for (i = 0; i < 5; i++)
+        for (j = 0; j < 5; j++) {
+            double a = i < 4 ? v[i] : nan, b = j < 4 ? v[j] : nan;
+            printf("%d %d ", cmps(a, b), brs(a, b));
+        }
+    printf("\n%d %d %d %u %lld %d\n", (int)d, (int)e, (int)-2.9f,
+           (unsigned)3.99e9, (long long)-1e15, (short)-1234.5);
+    printf("%.17g %.17g %.9g %.9g\n", (double)gu, (double)gll, (float)gu, (float)-7);
+    printf("%.17g %.9g %.17g\n", (double)f, (float)d, (double)(float)0.1);
+    d += 1.5, d *= f, d -= e, d /= 3;
+    f += 1, f *= 2, f = -f;
+    printf("%.17g %.9g %.17g\n", d, f, d > e ? d - e : e - d);
+    printf("%d %d %d\n", d > e && f < g, nan != nan, nan == nan);
+    return 0;
+}
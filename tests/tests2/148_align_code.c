@@ -0,0 +1,57 @@
+/* -falign-functions and -falign-loops */
+#include <stdio.h>
+#include <stdint.h>
+
+static int sum(int n)
+{
+    int s = 0, i;
+    for (i = 0; i < n; i++)
+        s += i & 1 ? i : -i;
+    return s;
+}
+
+static int collatz(int n)
+{
+    int k = 0;
+    while (n != 1) {
+        n = n & 1 ? 3 * n + 1 : n / 2;
+        k++;
+    }
+    return k;
+}
+
+static int digits(unsigned n)
+{
+    int k = 0;
+    do
+        k++;
+    while (n /= 10);
+    return k;
+}
+
+/* the address of a label at the head of a loop is aligned too */
+static int loop_head(int n)
+{
+    uintptr_t p = 0;
+    do {
+    head:
+        p += (uintptr_t)&&head & 31;
+    } while (--n);
+    return p;
+}
+
+int main(void)
+{
+    int (*fn[])(int) = { sum, collatz };
+    int i, j, s = 0;
+
+    for (i = 0; i < 2; i++)
+        printf("%d", (int)((uintptr_t)fn[i] & 63));
+    printf(" %d\n%d %d %d %d\n", loop_head(3),
+           sum(1000), collatz(27), digits(0), digits(4000000000u));
+    for (i = 0; i < 10; i++)
+        for (j = 0; j < i; j++)
+            s += collatz(i + j + 1);
+    printf("%d\n", s);
+    return 0;
+}
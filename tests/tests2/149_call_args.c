@@ -0,0 +1,69 @@
+/* integer arguments loaded straight into their registers */
+#include <stdio.h>
+
+struct s2 { int a, b; };
+struct s3 { char c[3]; };
+
+static long g = 77;
+static int gi = -5;
+
+static void f6(long a, long b, long c, long d, long e, long f)
+{
+    printf("%ld %ld %ld %ld %ld %ld\n", a, b, c, d, e, f);
+}
+
+static void fn(signed char a, short b, unsigned char c, unsigned short d,
+               int e, unsigned f)
+{
+    printf("%d %d %d %d %d %u\n", a, b, c, d, e, f);
+}
+
+static void fp(const char *s, int *p, long *q, struct s2 t, struct s3 u,
+               double x)
+{
+    printf("%s %d %ld %d/%d %.3s %g\n", s, *p, *q, t.a, t.b, u.c, x);
+}
+
+static void f8(long a, long b, long c, long d, long e, long f, long h,
+               long i)
+{
+    printf("%ld %ld %ld %ld %ld %ld %ld %ld\n", a, b, c, d, e, f, h, i);
+}
+
+#ifdef __SIZEOF_INT128__
+static void fq(int a, unsigned __int128 q, int b, long c)
+{
+    printf("%d %llx:%llx %d %ld\n", a, (unsigned long long)(q >> 64),
+           (unsigned long long)q, b, c);
+}
+#endif
+
+static long id(long x) { return x; }
+
+int main(int argc, char **argv)
+{
+    long x = argc + 9, y = argc * 20;
+    volatile long v1 = 10, v2 = 20, v3 = 30;
+    int loc = 42;
+    struct s2 t = { 3, 4 };
+    struct s3 u = { { 'a', 'b', 'c' } };
+    signed char c = -7;
+
+    f6(1, 2, 3, 4, 5, 6);
+    f6(-1, -2, 0x7fffffff, 0x80000000, -0x80000000L, 1L << 40);
+    f6(x, y, x + y, y - x, loc, g);
+    f6(y, x, y, x, y, x);
+    f6(1, v3 + 1, v1 + 1, v2 + 1, 5, 6);
+    f6(v3 * 2, v1 * 3, v2 * 4, 7, v3 - v1, 9);
+    f6(id(1), x, id(2), y, id(3), loc);
+    fn(c, -300, 200, 60000, gi, -1);
+    fn(loc, loc, loc, loc, loc, loc);
+    fp("str", &loc, &g, t, u, 1.5);
+    f8(x, 2, y, 4, loc, 6, x + y, g);
+#ifdef __SIZEOF_INT128__
+    fq(1, (unsigned __int128)2 << 64 | 3, 4, x);
+    fq(loc, (unsigned __int128)x << 64 | y, gi, v1 + v2);
+#endif
+    printf("%d %ld %s %c\n", loc, x, "end", c + 'z');
+    return 0;
+}
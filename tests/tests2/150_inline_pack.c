@@ -0,0 +1,22 @@
+/* #pragma pack state is not changed by inlined calls (run with -O1) */
+#include <stdio.h>
+
+static inline int f(int x) { return x + 1; }
+
+#pragma pack(1)
+struct p1 { char c; int i; };
+static inline int g(struct p1 *p) { return p->c + p->i; }
+int h(int y) { return f(y); }
+struct s1 { char c; int i; };
+
+#pragma pack()
+int k(struct p1 *p) { return g(p) + f(1); }
+struct s2 { char c; int i; };
+
+int main(void)
+{
+    struct p1 p = { 1, 2 };
+    printf("%d %d\n", (int)sizeof(struct s1), (int)sizeof(struct s2));
+    printf("%d %d\n", h(1), k(&p));
+    return 0;
+}
@@ -0,0 +1,15 @@
+#include <stdio.h>
+
+/* #pragma once must hold for a header however its path is spelled */
+
+int main()
+{
+    int n_once = 0;
+
+#include "151_include_alias.h"
+#include "./151_include_alias.h"
+#include "../tests2/151_include_alias.h"
+#include ".//151_include_alias.h"
+    printf("once: %d\n", n_once);
+    return 0;
+}
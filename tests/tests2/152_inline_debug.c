@@ -0,0 +1,18 @@
+#include <stdio.h>
+#include "152_inline_debug.h"
+
+/* with -g, the inlined bodies keep the file and line numbers where
+   they were written, and the caller gets its own back after them */
+
+static inline int twice(int x)
+{
+    return traced(x) * 2;
+}
+
+int main()
+{
+    int r = twice(20);
+    tcc_backtrace("r = %d", r);
+    printf("%d\n", twice(r));
+    return 0;
+}
@@ -0,0 +1,8 @@
+/* included by 152_inline_debug.c */
+int tcc_backtrace(const char *fmt, ...);
+
+static inline int traced(int x)
+{
+    tcc_backtrace("traced(%d)", x);
+    return x + 1;
+}
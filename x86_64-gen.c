@@ -26,6 +26,18 @@
 #define NB_REGS         25
 #define NB_ASM_REGS     16
 #define CONFIG_TCC_ASM
+#define CONFIG_TCC_JMPTABLE
+#define CONFIG_TCC_SELECT /* branchless '?:' with cmov, see gen_select() */
+#define CONFIG_TCC_ALIGN_CODE /* padding kept by gen_relax() */
+#ifndef TCC_TARGET_PE
+#define CONFIG_TCC_REGVARS
+#define NB_REGVARS      5 /* callee saved registers for -O1 variables */
+#define CONFIG_TCC_TAILCALL
+#define CONFIG_TCC_INT128 /* __int128 in register pairs */
+#ifndef TCC_TARGET_MACHO
+#define CONFIG_TCC_TLS /* __thread variables, see gen_tls_addr() */
+#endif
+#endif
 
 /* a register can belong to several classes. The classes must be
    sorted from more general to more precise (see gv2() code which does
@@ -58,7 +70,9 @@ enum {
     TREG_RAX = 0,
     TREG_RCX = 1,
     TREG_RDX = 2,
+    TREG_RBX = 3,
     TREG_RSP = 4,
+    TREG_RBP = 5,
     TREG_RSI = 6,
     TREG_RDI = 7,
 
@@ -66,6 +80,10 @@ enum {
     TREG_R9  = 9,
     TREG_R10 = 10,
     TREG_R11 = 11,
+    TREG_R12 = 12,
+    TREG_R13 = 13,
+    TREG_R14 = 14,
+    TREG_R15 = 15,
 
     TREG_XMM0 = 16,
     TREG_XMM1 = 17,
@@ -102,6 +120,9 @@ enum {
 /* maximum alignment (for aligned attribute support) */
 #define MAX_ALIGN     16
 
+/* structs up to this size are copied and cleared inline */
+#define STRUCT_INLINE_MAX 128
+
 /* define if return values need to be extended explicitely
    at caller side (for interfacing with non-TCC compilers) */
 #define PROMOTE_RET
@@ -148,6 +169,12 @@ ST_DATA const int reg_classes[NB_REGS] = {
     /* st0 */ RC_ST0
 };
 
+#ifdef CONFIG_TCC_REGVARS
+ST_DATA const int regvar_regs[NB_REGVARS] = {
+    TREG_RBX, TREG_R12, TREG_R13, TREG_R14, TREG_R15
+};
+#endif
+
 /* XXX: make it faster ? */
 ST_FUNC void g(TCCState *S, int c)
 {
@@ -206,17 +233,422 @@ static void orex(TCCState *S, int ll, int r, int r2, int b)
     o(S, b);
 }
 
+/* ------------------------------------------------------------------------- */
+/* branch relaxation: jumps are emitted with 32-bit displacements and
+   recorded.  At the end of the function, those whose final distance fits
+   are shrunk to the 8-bit form, and the code is compacted. */
+
+#define RELAX_JMP    0  /* jmp rel32 */
+#define RELAX_JCC    1  /* jcc rel32 */
+#define RELAX_JCC_JP 2  /* jcc rel32 skipped by a preceding 'jp +6' */
+#define RELAX_JMP8   3  /* jmp rel8 */
+#define RELAX_HOLE   4  /* unused bytes */
+#define RELAX_SIB    5  /* SIB byte of a 'disp(%rbp)', see gen_frame_refs() */
+#define RELAX_ALIGN  6  /* nops up to a multiple of 'target' */
+
+struct relax_jump {
+    int pos, kind, size; /* old offset, RELAX_xxx, old size */
+    int target, nsize;   /* old target, new size */
+    int shrink;          /* bytes removed up to and including this one */
+};
+
+static void relax_add(TCCState *S, int pos, int kind, int size)
+{
+    struct relax_jump *r;
+    int n = S->x86_64_gen_nb_relax;
+
+    if (S->nocode_wanted)
+        return;
+    if (n >= S->x86_64_gen_relax_size) {
+        S->x86_64_gen_relax_size = n * 2 + 64;
+        S->x86_64_gen_relax = tcc_realloc(S, S->x86_64_gen_relax,
+            S->x86_64_gen_relax_size * sizeof (struct relax_jump));
+    }
+    /* keep them sorted */
+    r = S->x86_64_gen_relax + n;
+    while (r > S->x86_64_gen_relax && r[-1].pos > pos)
+        r[0] = r[-1], --r;
+    r->pos = pos, r->kind = kind, r->size = size;
+    S->x86_64_gen_nb_relax = n + 1;
+}
+
+/* forget the jumps at and after 'ind', which were removed */
+static void relax_drop(TCCState *S)
+{
+    while (S->x86_64_gen_nb_relax
+           && S->x86_64_gen_relax[S->x86_64_gen_nb_relax - 1].pos >= S->ind)
+        --S->x86_64_gen_nb_relax;
+}
+
+/* start recording for a new function */
+static void relax_start(TCCState *S)
+{
+    S->x86_64_gen_nb_relax = S->x86_64_gen_nb_relax_tab = 0;
+    S->x86_64_gen_relax_sym = symtab_section->data_offset / sizeof (ElfW(Sym));
+    S->x86_64_gen_relax_rel = cur_text_section->reloc
+        ? cur_text_section->reloc->data_offset : 0;
+    S->x86_64_gen_relax_asm = S->tccasm_nb_inline;
+    S->x86_64_gen_relax_stab = stab_section ? stab_section->data_offset : 0;
+    S->x86_64_gen_peep_ind = S->x86_64_gen_peep_nb_jmp = 0;
+    S->x86_64_gen_peep_jmp_ind = -1;
+}
+
+/* new offset of the old offset 'a' */
+static int relax_map(struct relax_jump *rj, int n, int a)
+{
+    int lo = 0, hi = n, m;
+    while (lo < hi) {
+        m = (lo + hi) >> 1;
+        if (rj[m].pos < a)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo ? a - rj[lo - 1].shrink : a;
+}
+
+/* scopes of the function, pending until tcc_debug_funcend() */
+static void relax_debug_info(struct relax_jump *rj, int n, int start,
+                             debug_info_t *d)
+{
+    for (; d; d = d->next) {
+        d->start = relax_map(rj, n, start + d->start) - start;
+        d->end = relax_map(rj, n, start + d->end) - start;
+        relax_debug_info(rj, n, start, d->child);
+    }
+}
+
+/* line numbers are relative to the function, N_SOL entries are
+   section offsets */
+static void relax_debug(TCCState *S, struct relax_jump *rj, int n, int start)
+{
+    Stab_Sym *st, *st_end;
+
+    if (S->do_debug) {
+        st = (Stab_Sym *)(stab_section->data + S->x86_64_gen_relax_stab);
+        st_end = (Stab_Sym *)(stab_section->data + stab_section->data_offset);
+        for (; st < st_end; st++)
+            if (st->n_type == N_SLINE)
+                st->n_value = relax_map(rj, n, start + st->n_value) - start;
+            else if (st->n_type == N_SOL && st->n_value > start)
+                st->n_value = relax_map(rj, n, st->n_value);
+        relax_debug_info(rj, n, start, S->debug_info_root);
+    }
+    if (S->tccgen_tcov_data.ind > start)
+        S->tccgen_tcov_data.ind = relax_map(rj, n, S->tccgen_tcov_data.ind);
+}
+
+static void gen_relax(TCCState *S)
+{
+    struct relax_jump *rj = S->x86_64_gen_relax, *r;
+    int n = S->x86_64_gen_nb_relax, start = S->tccgen_func_ind;
+    int i, d, changed, src, dst, len, op;
+    unsigned char *p = cur_text_section->data;
+    ElfW(Sym) *sym, *sym_end;
+    ElfW_Rel *rel, *rel_end;
+    Section *sr;
+
+    S->x86_64_gen_nb_relax = 0;
+    /* asm code may hold its own displacements */
+    if (!n || S->x86_64_gen_relax_asm != S->tccasm_nb_inline)
+        return;
+    for (r = rj; r < rj + n; r++) {
+        r->nsize = r->size;
+        if (r->kind == RELAX_ALIGN) {
+            /* assume the largest padding until the jumps are done */
+            r->nsize = r->target - 1;
+            continue;
+        }
+        if (r->kind >= RELAX_HOLE) {
+            r->nsize = 0;
+            r->target = r->pos;
+            continue;
+        }
+        if (r->kind == RELAX_JMP8)
+            r->target = r->pos + 2 + (signed char)p[r->pos + 1];
+        else
+            r->target = r->pos + r->size + (int)read32le(p + r->pos + r->size - 4);
+        if (r->target < start || r->target > S->ind)
+            return; /* not resolved, should not happen */
+        if (r->target == r->pos + r->size)
+            r->nsize = 0; /* jump to the next instruction */
+    }
+    do {
+        for (d = 0, r = rj; r < rj + n; r++)
+            r->shrink = d += r->size - r->nsize;
+        changed = 0;
+        for (r = rj; r < rj + n; r++) {
+            if (r->nsize <= 2 || r->kind == RELAX_ALIGN)
+                continue;
+            d = relax_map(rj, n, r->target) - relax_map(rj, n, r->pos)
+                - (r->target > r->pos ? r->size : 2);
+            if (d == (signed char)d)
+                r->nsize = 2, changed = 1;
+        }
+    } while (changed);
+    /* now the padding, which only makes the jumps shorter */
+    for (d = 0, r = rj; r < rj + n; r++) {
+        if (r->kind == RELAX_ALIGN)
+            r->nsize = (d - r->pos) & (r->target - 1);
+        r->shrink = d += r->size - r->nsize;
+    }
+    if (!rj[n - 1].shrink)
+        return;
+
+    /* move the code */
+    src = dst = rj[0].pos;
+    for (r = rj; r < rj + n; r++) {
+        len = r->pos - src;
+        memmove(p + dst, p + src, len);
+        dst += len, src = r->pos;
+        op = p[src] == 0x0f ? p[src + 1] - 0x10 : p[src];
+        if (r->kind == RELAX_SIB)
+            p[dst - 1] = (p[dst - 1] & ~7) | 5; /* modrm without SIB */
+        if (r->kind == RELAX_JCC_JP)
+            p[dst - 1] = r->nsize; /* jp +n */
+        if (r->kind == RELAX_ALIGN) {
+            i = S->ind, S->ind = dst;
+            gen_fill_nops(S, r->nsize);
+            S->ind = i;
+        } else if (r->nsize == 2) {
+            p[dst] = op == 0xe9 ? 0xeb : op;
+            p[dst + 1] = relax_map(rj, n, r->target) - dst - 2;
+        } else if (r->nsize) {
+            memmove(p + dst, p + src, r->size - 4);
+            write32le(p + dst + r->size - 4,
+                      relax_map(rj, n, r->target) - dst - r->size);
+        }
+        src += r->size, dst += r->nsize;
+    }
+    len = S->ind - src;
+    memmove(p + dst, p + src, len);
+
+    /* relocations and symbols of the function */
+    sr = cur_text_section->reloc;
+    if (sr) {
+        rel = (ElfW_Rel *)(sr->data + S->x86_64_gen_relax_rel);
+        rel_end = (ElfW_Rel *)(sr->data + sr->data_offset);
+        for (; rel < rel_end; rel++)
+            if (rel->r_offset > start && rel->r_offset < S->ind)
+                rel->r_offset = relax_map(rj, n, rel->r_offset);
+    }
+    sym = (ElfW(Sym) *)symtab_section->data + S->x86_64_gen_relax_sym;
+    sym_end = (ElfW(Sym) *)(symtab_section->data + symtab_section->data_offset);
+    for (; sym < sym_end; sym++)
+        if (sym->st_shndx == cur_text_section->sh_num
+            && sym->st_value > start && sym->st_value <= S->ind)
+            sym->st_value = relax_map(rj, n, sym->st_value);
+    if (S->tccgen_debug_modes)
+        relax_debug(S, rj, n, start);
+    /* switch tables hold 'target + 4 * index' relative to the section,
+       see gcase_table() */
+    for (i = 0; i < S->x86_64_gen_nb_relax_tab; i++) {
+        sym = (ElfW(Sym) *)symtab_section->data + S->x86_64_gen_relax_tab[i];
+        sr = rodata_section->reloc;
+        rel = (ElfW_Rel *)sr->data;
+        rel_end = (ElfW_Rel *)(sr->data + sr->data_offset);
+        for (; rel < rel_end; rel++) {
+            d = rel->r_offset - sym->st_value;
+            if (d >= 0 && d < sym->st_size
+                && rel->r_addend - d >= start && rel->r_addend - d <= S->ind)
+                rel->r_addend = relax_map(rj, n, rel->r_addend - d) + d;
+        }
+    }
+    S->ind = dst + len;
+}
+
+/* ------------------------------------------------------------------------- */
+/* frame pointer omission: with -O, the stack slots are addressed as
+   'disp(%rbp)' with a SIB byte, and recorded.  If the function turns out
+   to be a leaf whose frame fits in the red zone, no frame is set up and
+   they become 'disp(%rsp)'.  Otherwise gen_relax() drops the SIB bytes.
+
+   Without a frame, the locals end 24 bytes below the %rsp of the entry,
+   so that the scratch uses of -0x10(%rsp) and the push/pop pairs of
+   gen_cvt_itof() do not overwrite them.  The stack arguments are at
+   8(%rsp) instead of 16(%rbp). */
+
+#define FP_RED_ZONE 128
+#define FP_LOCALS   24
+
+static void fp_ref_add(TCCState *S, int pos)
+{
+    int *p, n = S->x86_64_gen_nb_fp_ref;
+
+    if (n >= S->x86_64_gen_fp_ref_size) {
+        S->x86_64_gen_fp_ref_size = n * 2 + 64;
+        S->x86_64_gen_fp_ref = tcc_realloc(S, S->x86_64_gen_fp_ref,
+            S->x86_64_gen_fp_ref_size * sizeof (int));
+    }
+    /* keep them sorted, the register saves are written last */
+    p = S->x86_64_gen_fp_ref + n;
+    while (p > S->x86_64_gen_fp_ref && p[-1] > pos)
+        p[0] = p[-1], --p;
+    *p = pos;
+    S->x86_64_gen_nb_fp_ref = n + 1;
+}
+
+/* modrm for 'c(%rbp)', 'op_reg' being already shifted */
+static void gen_modrm_local(TCCState *S, int op_reg, int c)
+{
+    int mod = c == (char)c ? 0x40 : 0x80;
+
+    if (c >= 0 && c < 16)
+        S->x86_64_gen_fp_needed = 1; /* saved %rbp or return address */
+    if (S->x86_64_gen_fp_omit && !S->nocode_wanted) {
+        fp_ref_add(S, S->ind);
+        o(S, 0x2504 | mod | op_reg); /* [sib] with %rbp as base */
+    } else {
+        g(S, 0x05 | mod | op_reg);
+    }
+    if (mod == 0x40)
+        g(S, c);
+    else
+        gen_le32(S, c);
+}
+
+#ifndef TCC_TARGET_PE
+/* rewrite the recorded stack slot references for the frame chosen by
+   gfunc_epilog() */
+static void gen_frame_refs(TCCState *S, int frame)
+{
+    int *ref = S->x86_64_gen_fp_ref, m = S->x86_64_gen_nb_fp_ref;
+    int n = S->x86_64_gen_nb_relax, i, j, k, c;
+    struct relax_jump *rj;
+    unsigned char *p;
+
+    S->x86_64_gen_nb_fp_ref = 0;
+    if (!frame) {
+        for (i = 0; i < m; i++) {
+            p = cur_text_section->data + ref[i];
+            p[1] = 0x24; /* %rsp as base */
+            c = (p[0] & 0xc0) == 0x40 ? (signed char)p[2] : (int)read32le(p + 2);
+            c -= c < 0 ? FP_LOCALS : 8;
+            if ((p[0] & 0xc0) == 0x40)
+                p[2] = c;
+            else
+                write32le(p + 2, c);
+        }
+        return;
+    }
+    /* merge the SIB bytes into the sorted relaxation entries */
+    if (n + m > S->x86_64_gen_relax_size) {
+        S->x86_64_gen_relax_size = n + m + 64;
+        S->x86_64_gen_relax = tcc_realloc(S, S->x86_64_gen_relax,
+            S->x86_64_gen_relax_size * sizeof (struct relax_jump));
+    }
+    rj = S->x86_64_gen_relax;
+    for (i = n - 1, j = m - 1, k = n + m - 1; j >= 0; k--) {
+        if (i >= 0 && rj[i].pos > ref[j])
+            rj[k] = rj[i--];
+        else
+            rj[k].pos = ref[j--] + 1, rj[k].kind = RELAX_SIB, rj[k].size = 1;
+    }
+    S->x86_64_gen_nb_relax = n + m;
+}
+#endif
+
+/* peephole optimizations on the emitted code, done with -O */
+static int peep_wanted(TCCState *S)
+{
+    return S->optimize > 0 && !S->tccgen_debug_modes;
+}
+
+/* true if 'a' is known to be a jump target */
+static int peep_label(TCCState *S, int a)
+{
+    return S->tccgen_label_ind == a
+        || (S->x86_64_gen_peep_jmp_ind == a && S->x86_64_gen_peep_nb_jmp);
+}
+
 /* output a symbol and patch all calls to it */
 ST_FUNC void gsym_addr(TCCState *S, int t, int a)
 {
+    unsigned char *data = cur_text_section->data;
+    uint32_t n;
+    int i, p;
+
+    if (a == S->ind && t && peep_wanted(S)) {
+        if (S->x86_64_gen_peep_jmp_ind != a)
+            S->x86_64_gen_peep_jmp_ind = a, S->x86_64_gen_peep_nb_jmp = 0;
+        /* drop a 'jmp' to the next instruction.  Other jumps to here
+           must be known so that they can be moved along. */
+        if (S->tccgen_label_ind != a)
+            for (n = t; n; n = read32le(data + n))
+                if (n + 4 == a && data[n - 1] == 0xe9) {
+                    a = S->ind -= 5;
+                    relax_drop(S);
+                    for (i = 0; i < S->x86_64_gen_peep_nb_jmp; i++) {
+                        p = S->x86_64_gen_peep_jmp[i];
+                        write32le(data + p, a - p - 4);
+                    }
+                    /* jumps to the removed 'jmp' now arrive here too */
+                    S->tccgen_label_ind = S->x86_64_gen_peep_jmp_ind = a;
+                    break;
+                }
+        /* remember the jumps to here for jump threading in gjmp() */
+        for (n = t; n; n = read32le(data + n)) {
+            if (n >= a)
+                continue;
+            if (S->x86_64_gen_peep_nb_jmp < countof(S->x86_64_gen_peep_jmp))
+                S->x86_64_gen_peep_jmp[S->x86_64_gen_peep_nb_jmp++] = n;
+            else
+                S->tccgen_label_ind = a;
+        }
+    }
     while (t) {
-        unsigned char *ptr = cur_text_section->data + t;
-        uint32_t n = read32le(ptr); /* next value */
-        write32le(ptr, a < 0 ? -a : a - t - 4);
+        unsigned char *ptr = data + t;
+        n = read32le(ptr); /* next value */
+        if (t < S->ind || a != S->ind)
+            write32le(ptr, a < 0 ? -a : a - t - 4);
         t = n;
     }
 }
 
+/* 4 or 8 for the integer values tracked by the store/load peephole,
+   0 for the others and for volatile ones, which must be reloaded */
+static int peep_size(int t)
+{
+    if (t & (VT_ARRAY | VT_BITFIELD | VT_VOLATILE))
+        return 0;
+    t &= VT_BTYPE;
+    if (t == VT_INT)
+        return 4;
+    if (t == VT_LLONG || t == VT_PTR)
+        return 8;
+    return 0;
+}
+
+/* remember that register 'r' was just stored to the lvalue 'fr'/'c' */
+static void peep_store(TCCState *S, int r, int fr, int c, int t)
+{
+    S->x86_64_gen_peep_ind = 0;
+    if (r < TREG_XMM0 && peep_size(t) && !S->nocode_wanted && peep_wanted(S)) {
+        S->x86_64_gen_peep_ind = S->ind;
+        S->x86_64_gen_peep_r = r;
+        S->x86_64_gen_peep_fr = fr;
+        S->x86_64_gen_peep_c = c;
+        S->x86_64_gen_peep_size = peep_size(t);
+    }
+}
+
+/* retarget the jumps to a 'jmp' emitted right at their target.  With
+   'a' >= 0 they go to that address, otherwise they are appended to the
+   chain 't', which is returned. */
+static int peep_thread_jumps(TCCState *S, int t, int a)
+{
+    int i, p;
+    if (S->x86_64_gen_peep_jmp_ind != S->ind || S->nocode_wanted)
+        return t;
+    for (i = 0; i < S->x86_64_gen_peep_nb_jmp; i++) {
+        p = S->x86_64_gen_peep_jmp[i];
+        write32le(cur_text_section->data + p, a >= 0 ? a - p - 4 : t);
+        t = p;
+    }
+    S->x86_64_gen_peep_nb_jmp = 0;
+    return a >= 0 ? 0 : t;
+}
+
 static int is64_type(int t)
 {
     return ((t & VT_BTYPE) == VT_PTR ||
@@ -302,13 +734,7 @@ static void gen_modrm_impl(TCCState *S, int op_reg, int r, Sym *sym, int c, int
 	}
     } else if ((r & VT_VALMASK) == VT_LOCAL) {
         /* currently, we use only ebp as base */
-        if (c == (char)c) {
-            /* short reference */
-            o(S, 0x45 | op_reg);
-            g(S, c);
-        } else {
-            oad(S, 0x85 | op_reg, c);
-        }
+        gen_modrm_local(S, op_reg, c);
     } else if ((r & VT_VALMASK) >= TREG_MEM) {
         if (c) {
             g(S, 0x80 | op_reg | REG_VALUE(r));
@@ -323,7 +749,7 @@ static void gen_modrm_impl(TCCState *S, int op_reg, int r, Sym *sym, int c, int
 
 /* generate a modrm reference. 'op_reg' contains the additional 3
    opcode bits */
-static void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c)
+ST_FUNC void gen_modrm(TCCState *S, int op_reg, int r, Sym *sym, int c)
 {
     gen_modrm_impl(S, op_reg, r, sym, c, 0);
 }
@@ -342,7 +768,7 @@ static void gen_modrm64(TCCState *S, int opcode, int op_reg, int r, Sym *sym, in
 /* load 'r' from value 'sv' */
 void load(TCCState *S, int r, SValue *sv)
 {
-    int v, t, ft, fc, fr;
+    int v, t, ft, fc, fr, b;
     SValue v1;
 
 #ifdef TCC_TARGET_PE
@@ -358,6 +784,46 @@ void load(TCCState *S, int r, SValue *sv)
 
     ft &= ~(VT_VOLATILE | VT_CONSTANT);
 
+    if (S->ind == S->x86_64_gen_peep_ind && !peep_label(S, S->ind)
+        && fr == S->x86_64_gen_peep_fr && fc == S->x86_64_gen_peep_c
+        && peep_size(sv->type.t) == S->x86_64_gen_peep_size && r < TREG_XMM0
+        && peep_wanted(S)) {
+        /* load right after a store of the same value */
+        v = S->x86_64_gen_peep_r;
+        if (v != r) {
+            orex(S, S->x86_64_gen_peep_size == 8, r, v, 0x89);
+            o(S, 0xc0 + REG_VALUE(r) + REG_VALUE(v) * 8); /* mov v, r */
+            S->x86_64_gen_peep_ind = S->ind;
+        }
+        return;
+    }
+
+#ifdef CONFIG_TCC_REGVARS
+    if ((fr & VT_VALMASK) == VT_REGVAR) {
+        /* register variable: the value may have been narrowed by a
+           cast (see ALLOW_SUBTYPE_ACCESS in gen_cast) */
+        v = fc;
+        if (!(fr & VT_LVAL))
+            tcc_internal_error(S, "address of register variable");
+        if ((ft & VT_TYPE) == VT_BYTE || (ft & VT_TYPE) == VT_BOOL)
+            b = 0xbe0f;   /* movsbl */
+        else if ((ft & VT_TYPE) == (VT_BYTE | VT_UNSIGNED))
+            b = 0xb60f;   /* movzbl */
+        else if ((ft & VT_TYPE) == VT_SHORT)
+            b = 0xbf0f;   /* movswl */
+        else if ((ft & VT_TYPE) == (VT_SHORT | VT_UNSIGNED))
+            b = 0xb70f;   /* movzwl */
+        else {
+            orex(S, is64_type(ft), r, v, 0x89);
+            o(S, 0xc0 + REG_VALUE(r) + REG_VALUE(v) * 8); /* mov v, r */
+            return;
+        }
+        orex(S, 0, v, r, b);
+        o(S, 0xc0 + REG_VALUE(v) + REG_VALUE(r) * 8);
+        return;
+    }
+#endif
+
 #ifndef TCC_TARGET_PE
     /* we use indirect access via got */
     if ((fr & VT_VALMASK) == VT_CONST && (fr & VT_SYM) &&
@@ -377,7 +843,7 @@ void load(TCCState *S, int r, SValue *sv)
 
     v = fr & VT_VALMASK;
     if (fr & VT_LVAL) {
-        int b, ll;
+        int ll;
         if (v == VT_LLOCAL) {
             v1.type.t = VT_PTR;
             v1.r = VT_LOCAL | VT_LVAL;
@@ -469,9 +935,13 @@ void load(TCCState *S, int r, SValue *sv)
                     gen_gotpcrel(S, r, sv->sym, fc);
                 }
 #endif
-            } else if (is64_type(ft)) {
+            } else if (is64_type(ft) && sv->c.i != (int)sv->c.i) {
                 orex(S, 1,r,0, 0xb8 + REG_VALUE(r)); /* mov $xx, r */
                 gen_le64(S, sv->c.i);
+            } else if (is64_type(ft) && fc < 0) {
+                orex(S, 1,r,0, 0xc7); /* mov $xx, r (sign extended) */
+                o(S, 0xc0 + REG_VALUE(r));
+                gen_le32(S, fc);
             } else {
                 orex(S, 0,r,0, 0xb8 + REG_VALUE(r)); /* mov $xx, r */
                 gen_le32(S, fc);
@@ -482,13 +952,10 @@ void load(TCCState *S, int r, SValue *sv)
         } else if (v == VT_CMP) {
 	    if (fc & 0x100)
 	      {
-                v = S->vtop->cmp_r;
                 fc &= ~0x100;
-	        /* This was a float compare.  If the parity bit is
-		   set the result was unordered, meaning false for everything
-		   except TOK_NE, and true for TOK_NE.  */
+	        /* This was a float compare: the result if unordered */
                 orex(S, 0, r, 0, 0xb0 + REG_VALUE(r)); /* mov $0/1,%al */
-                g(S, v ^ fc ^ (v == TOK_NE));
+                g(S, gen_sse_unordered(S->vtop->cmp_r, fc));
                 o(S, 0x037a + (REX_BASE(r) << 8));
               }
             orex(S, 0,r,0, 0x0f); /* setxx %br */
@@ -560,6 +1027,15 @@ void store(TCCState *S, int r, SValue *v)
     ft &= ~(VT_VOLATILE | VT_CONSTANT);
     bt = ft & VT_BTYPE;
 
+#ifdef CONFIG_TCC_REGVARS
+    if (fr == VT_REGVAR) {
+        orex(S, is64_type(bt), fc, r, 0x89);
+        o(S, 0xc0 + REG_VALUE(fc) + REG_VALUE(r) * 8); /* mov r, fc */
+        peep_store(S, r, v->r, fc, v->type.t);
+        return;
+    }
+#endif
+
 #ifndef TCC_TARGET_PE
     /* we need to access the variable via got */
     if (fr == VT_CONST
@@ -618,6 +1094,8 @@ void store(TCCState *S, int r, SValue *v)
             o(S, 0xc0 + fr + r * 8); /* mov r, fr */
         }
     }
+    if (v->r == (VT_LOCAL | VT_LVAL) && !pic)
+        peep_store(S, r, v->r, fc, v->type.t);
 }
 
 /* 'is_jmp' is '1' if it is a jump */
@@ -923,6 +1401,7 @@ void gfunc_prolog(TCCState *S, Sym *func_sym)
     Sym *sym;
     CType *type;
 
+    relax_start(S);
     S->x86_64_gen_func_ret_sub = 0;
     S->x86_64_gen_func_scratch = 32;
     S->x86_64_gen_func_alloca = 0;
@@ -1030,9 +1509,10 @@ void gfunc_epilog(TCCState *S)
     /* add the "func_scratch" area after each alloca seen */
     gsym_addr(S, S->x86_64_gen_func_alloca, -S->x86_64_gen_func_scratch);
 
-    cur_text_section->data_offset = saved_ind;
-    pe_add_unwind_data(S, S->ind, saved_ind, v);
-    S->ind = cur_text_section->data_offset;
+    S->ind = saved_ind;
+    gen_relax(S);
+    cur_text_section->data_offset = S->ind;
+    pe_add_unwind_data(S, S->x86_64_gen_func_sub_sp_offset, S->ind, v);
 }
 
 #else
@@ -1085,6 +1565,7 @@ static X86_64_Mode classify_x86_64_inner(CType *ty)
     case VT_BYTE:
     case VT_SHORT:
     case VT_LLONG:
+    case VT_QLONG:
     case VT_BOOL:
     case VT_PTR:
     case VT_FUNC:
@@ -1097,6 +1578,8 @@ static X86_64_Mode classify_x86_64_inner(CType *ty)
       
     case VT_STRUCT:
         f = ty->ref;
+        if (f->a.vector)
+            return x86_64_mode_sse;
 
         mode = x86_64_mode_none;
         for (f = f->next; f; f = f->next)
@@ -1154,7 +1637,11 @@ static X86_64_Mode classify_x86_64_arg(CType *ty, CType *ret, int *psize, int *p
                 break;
 
             case x86_64_mode_sse:
-                if (size > 8) {
+                if (size > 8 && IS_VECTOR(ty)) {
+                    /* one register for the whole vector */
+                    *reg_count = 1;
+                    ret_t = VT_STRUCT;
+                } else if (size > 8) {
                     *reg_count = 2;
                     ret_t = VT_QFLOAT;
                 } else {
@@ -1168,19 +1655,20 @@ static X86_64_Mode classify_x86_64_arg(CType *ty, CType *ret, int *psize, int *p
     }
     
     if (ret) {
-        ret->ref = NULL;
+        ret->ref = ret_t == VT_STRUCT ? ty->ref : NULL;
         ret->t = ret_t;
     }
     
     return mode;
 }
 
+/* This definition must be synced with lib/va_list.c */
+enum __va_arg_type {
+    __va_gen_reg, __va_float_reg, __va_stack
+};
+
 ST_FUNC int classify_x86_64_va_arg(CType *ty)
 {
-    /* This definition must be synced with stdarg.h */
-    enum __va_arg_type {
-        __va_gen_reg, __va_float_reg, __va_stack
-    };
     int size, align, reg_count;
     X86_64_Mode mode = classify_x86_64_arg(ty, NULL, &size, &align, &reg_count);
     switch (mode) {
@@ -1190,16 +1678,126 @@ ST_FUNC int classify_x86_64_va_arg(CType *ty)
     }
 }
 
+/* va_arg(ap, t): leave an lvalue of type 't' on the stack.  Values in
+   one slot of the register save area or in the overflow area are
+   fetched inline, the other ones (aggregates in two xmm registers or
+   in memory, long double) by __va_arg() of lib/va_list.c */
+ST_FUNC void gen_va_arg(TCCState *S, CType *t)
+{
+    int size, align, reg_count, cls, r0, r1, n, lim, off, j1, j2;
+
+    cls = classify_x86_64_va_arg(t);
+    classify_x86_64_arg(t, NULL, &size, &align, &reg_count);
+    S->vtop->type = S->char_pointer_type; /* &ap[0] */
+    if (cls == __va_stack || (cls == __va_float_reg && size > 8)) {
+        vpush_helper_func(S, TOK___va_arg);
+        vswap(S);
+        vpushi(S, cls);
+        vpushi(S, size);
+        vpushi(S, align);
+        gfunc_call(S, 4);
+        vpushi(S, 0);
+        S->vtop->r = TREG_RAX | VT_LVAL;
+        return;
+    }
+
+    r0 = gv(S, RC_INT);
+    r1 = get_reg(S, RC_INT);
+    if (cls == __va_gen_reg)
+        n = size, lim = 48 - size, off = 0; /* gp_offset */
+    else
+        n = 16, lim = 176 - 16, off = 4; /* fp_offset */
+
+    orex(S, 0, r0, r1, 0x8b); /* mov off(ap), r1d */
+    o(S, 0x40 | REG_VALUE(r1) << 3 | REG_VALUE(r0));
+    g(S, off);
+    orex(S, 0, r1, 0, 0x81); /* cmp $lim, r1d */
+    o(S, 0xf8 | REG_VALUE(r1));
+    gen_le32(S, lim);
+    o(S, 0x77), g(S, 0), j1 = S->ind; /* ja overflow */
+    orex(S, 0, r0, 0, 0x83); /* addl $n, off(ap) */
+    o(S, 0x40 | REG_VALUE(r0));
+    g(S, off), g(S, n);
+    orex(S, 1, r0, r1, 0x03); /* add reg_save_area(ap), r1 */
+    o(S, 0x40 | REG_VALUE(r1) << 3 | REG_VALUE(r0));
+    g(S, 16);
+    o(S, 0xeb), g(S, 0), j2 = S->ind; /* jmp done */
+    cur_text_section->data[j1 - 1] = S->ind - j1;
+    /* overflow: */
+    orex(S, 1, r0, r1, 0x8b); /* mov overflow_arg_area(ap), r1 */
+    o(S, 0x40 | REG_VALUE(r1) << 3 | REG_VALUE(r0));
+    g(S, 8);
+    if (align > 8) {
+        orex(S, 1, r1, 0, 0x83); /* add $align-1, r1 */
+        o(S, 0xc0 | REG_VALUE(r1));
+        g(S, align - 1);
+        orex(S, 1, r1, 0, 0x83); /* and $-align, r1 */
+        o(S, 0xe0 | REG_VALUE(r1));
+        g(S, -align);
+        orex(S, 1, r0, r1, 0x89); /* mov r1, overflow_arg_area(ap) */
+        o(S, 0x40 | REG_VALUE(r1) << 3 | REG_VALUE(r0));
+        g(S, 8);
+    }
+    orex(S, 1, r0, 0, 0x83); /* addq $size, overflow_arg_area(ap) */
+    o(S, 0x40 | REG_VALUE(r0));
+    g(S, 8), g(S, size);
+    cur_text_section->data[j2 - 1] = S->ind - j2;
+    /* done: */
+    S->vtop->r = r1 | VT_LVAL;
+}
+
+#ifdef CONFIG_TCC_TLS
+/* replace the address of the thread-local variable on top of the stack
+   by a register holding its address in the current thread.  Variables
+   defined in an executable are at a fixed offset from %fs:0
+   (local-exec), other ones get their offset from the GOT (initial-exec,
+   relaxed to local-exec by the linker when possible) */
+ST_FUNC void gen_tls_addr(TCCState *S)
+{
+    Sym *sym = S->vtop->sym;
+    ElfSym *esym = elfsym(S, sym);
+    int r = get_reg(S, RC_INT);
+
+    if (S->output_type == TCC_OUTPUT_EXE && esym && esym->st_shndx) {
+        o(S, 0x64); /* mov %fs:0, r */
+        orex(S, 1, 0, r, 0x8b);
+        o(S, 0x04 | REG_VALUE(r) << 3);
+        o(S, 0x25), gen_le32(S, 0);
+        orex(S, 1, r, 0, 0x81); /* add $sym@tpoff, r */
+        o(S, 0xc0 | REG_VALUE(r));
+        greloca(S, cur_text_section, sym, S->ind, R_X86_64_TPOFF32, 0);
+        gen_le32(S, 0);
+    } else {
+        orex(S, 1, 0, r, 0x8b); /* mov sym@gottpoff(%rip), r */
+        o(S, 0x05 | REG_VALUE(r) << 3);
+        greloca(S, cur_text_section, sym, S->ind, R_X86_64_GOTTPOFF, -4);
+        gen_le32(S, 0);
+        o(S, 0x64); /* add %fs:0, r */
+        orex(S, 1, 0, r, 0x03);
+        o(S, 0x04 | REG_VALUE(r) << 3);
+        o(S, 0x25), gen_le32(S, 0);
+    }
+    S->vtop->r = r;
+    S->vtop->sym = NULL;
+}
+#endif
+
 /* Return the number of registers needed to return the struct, or 0 if
-   returning via struct pointer. */
+   returning via struct pointer, or -1 for a vector in %xmm0 (see
+   arch_transfer_ret_regs()). */
 ST_FUNC int gfunc_sret(TCCState *S, CType *vt, int variadic, CType *ret, int *ret_align, int *regsize)
 {
     int size, align, reg_count;
     *ret_align = 1; // Never have to re-align return values for x86-64
     *regsize = 8;
-    return (classify_x86_64_arg(vt, ret, &size, &align, &reg_count) != x86_64_mode_memory);
+    if (classify_x86_64_arg(vt, ret, &size, &align, &reg_count) == x86_64_mode_memory)
+        return 0;
+    return (ret->t & VT_BTYPE) == VT_STRUCT ? -1 : 1;
 }
 
+static void gen_block_mov(TCCState *S, int store, int size, int r, int b, int c);
+static void gen_vec_mov(TCCState *S, int store, int x, SValue *sv);
+
 #define REGN 6
 static const uint8_t arg_regs[REGN] = {
     TREG_RDI, TREG_RSI, TREG_RDX, TREG_RCX, TREG_R8, TREG_R9
@@ -1213,6 +1811,102 @@ static int arg_prepare_reg(int idx) {
       return idx >= 0 && idx < REGN ? arg_regs[idx] : 0;
 }
 
+/* return true if the integer argument 'sv' can be loaded into its
+   register by load() alone, without using any other register */
+static int arg_is_direct(SValue *sv)
+{
+    int v = sv->r & VT_VALMASK;
+    if ((sv->r & (VT_MUSTCAST | VT_MUSTBOUND)) || (sv->type.t & VT_BITFIELD))
+        return 0;
+    if (v == VT_CONST || v == VT_LOCAL)
+        return 1;
+#ifdef CONFIG_TCC_REGVARS
+    if (v == VT_REGVAR)
+        return 1;
+#endif
+    return v < VT_CONST && !(sv->r & VT_LVAL) && (reg_classes[v] & RC_INT);
+}
+
+/* load the 'n' arguments on top of the value stack into the registers
+   dst[i] (for vtop[-i]), and move R10 and R11 to RDX and RCX if 'via'
+   has bit 2 and 3 set.  Registers are copied first, as one parallel
+   move, since none of the other loads reads a register. */
+static void gen_arg_moves(TCCState *S, int n, uint8_t *dst, int via)
+{
+    SValue mv[REGN];
+    uint8_t md[REGN], ms[REGN];
+    int i, j, m, v;
+
+    for (i = m = 0; i < n; i++) {
+        v = S->vtop[-i].r & VT_VALMASK;
+        if (v == VT_REGVAR)
+            v = S->vtop[-i].c.i;
+        if (v < VT_CONST) {
+            mv[m] = S->vtop[-i];
+            md[m] = dst[i];
+            ms[m++] = v;
+        }
+    }
+    for (i = 2; i < 4; i++)
+        if (via & (1 << i)) {
+            mv[m].type.t = VT_LLONG;
+            mv[m].r = ms[m] = arg_prepare_reg(i);
+            mv[m].c.i = 0;
+            md[m++] = arg_regs[i];
+        }
+
+    while (m) {
+        /* find a move whose destination is no longer needed */
+        for (i = 0; i < m; i++) {
+            for (j = 0; j < m; j++)
+                if (j != i && ms[j] == md[i])
+                    break;
+            if (j == m)
+                break;
+        }
+        if (i == m) {
+            /* only a cycle of plain registers is left: exchange the
+               first one into place */
+            i = 0;
+            orex(S, 1, ms[i], md[i], 0x87); /* xchg */
+            o(S, 0xc0 + REG_VALUE(ms[i]) + REG_VALUE(md[i]) * 8);
+            for (j = 1; j < m; j++)
+                if (ms[j] == md[i])
+                    mv[j].r = ms[j] = ms[i];
+        } else {
+            load(S, md[i], &mv[i]);
+        }
+        --m;
+        mv[i] = mv[m], md[i] = md[m], ms[i] = ms[m];
+    }
+
+    for (i = 0; i < n; i++) {
+        v = S->vtop[-i].r & VT_VALMASK;
+        if (v >= VT_CONST && v != VT_REGVAR)
+            load(S, dst[i], &S->vtop[-i]);
+    }
+}
+
+#ifdef CONFIG_TCC_REGVARS
+/* save (0x89) or restore (0x8b) the registers used for register
+   variables in the current function */
+static void gen_regvar_saves(TCCState *S, int opcode)
+{
+    int i;
+    for (i = 0; i < S->tccgen_regvar_nb; i++)
+        if (S->tccgen_regvar_saved & (1 << i))
+            gen_modrm64(S, opcode, regvar_regs[i], VT_LOCAL, NULL,
+                        S->x86_64_gen_func_regvar_loc + i * 8);
+}
+
+/* size of one of them */
+static int regvar_save_size(TCCState *S)
+{
+    int c = S->x86_64_gen_func_regvar_loc;
+    return (c == (char)c ? 4 : 7) + S->x86_64_gen_fp_omit;
+}
+#endif
+
 /* Generate function call. The function address is pushed first, then
    all the parameters in call order. This functions pops all the
    parameters and the function address. */
@@ -1223,9 +1917,11 @@ void gfunc_call(TCCState *S, int nb_args)
     int size, align, r, args_size, stack_adjust, i, reg_count, k;
     int nb_reg_args = 0;
     int nb_sse_args = 0;
-    int sse_reg, gen_reg;
+    int sse_reg, gen_reg, nb_direct, via;
+    uint8_t direct[REGN];
     char *onstack = tcc_malloc(S, (nb_args + 1) * sizeof (char));
 
+    S->x86_64_gen_fp_needed = 1; /* not a leaf function */
 #ifdef CONFIG_TCC_BCHECK
     if (S->do_bounds_check)
         gbound_args(S, nb_args);
@@ -1326,6 +2022,12 @@ void gfunc_call(TCCState *S, int nb_args)
 		o(S, 0x24);
 		break;
 
+	    case VT_QLONG:
+		r = gv(S, RC_INT);
+		orex(S, 0,S->vtop->r2,0,0x50 + REG_VALUE(S->vtop->r2)); /* push r2 */
+		orex(S, 0,r,0,0x50 + REG_VALUE(r)); /* push r */
+		break;
+
 	    default:
 		assert(mode == x86_64_mode_integer);
 		/* simple type */
@@ -1343,22 +2045,32 @@ void gfunc_call(TCCState *S, int nb_args)
 
     tcc_free(S, onstack);
 
-    /* XXX This should be superfluous.  */
-    save_regs(S, 0); /* save used temporary registers */
-
-    /* then, we prepare register passing arguments.
-       Note that we cannot set RDX and RCX in this loop because gv()
-       may break these temporary registers. Let's use R10 and R11
-       instead of them */
+    /* then, we prepare register passing arguments.  Simple integer
+       arguments are left on the value stack and loaded straight into
+       their registers once the others are done.  Note that we cannot
+       set RDX and RCX in this loop because gv() may break these
+       temporary registers. Let's use R10 and R11 instead of them */
     assert(gen_reg <= REGN);
     assert(sse_reg <= 8);
+    nb_direct = via = 0;
     for(i = 0; i < nb_args; i++) {
-        mode = classify_x86_64_arg(&S->vtop->type, &type, &size, &align, &reg_count);
-        if (size == 0) continue;
+        mode = classify_x86_64_arg(&S->vtop[-nb_direct].type, &type, &size, &align, &reg_count);
+        if (mode == x86_64_mode_integer) {
+            gen_reg -= reg_count;
+            if (reg_count == 1 && arg_is_direct(&S->vtop[-nb_direct])) {
+                S->vtop[-nb_direct].type = type;
+                direct[nb_direct++] = arg_regs[gen_reg];
+                continue;
+            }
+        }
+        vrotb(S, nb_direct + 1);
         /* Alter stack entry type so that gv() knows how to treat it */
         S->vtop->type = type;
         if (mode == x86_64_mode_sse) {
-            if (reg_count == 2) {
+            if ((type.t & VT_BTYPE) == VT_STRUCT) {
+                --sse_reg;
+                gen_vec_mov(S, 0, TREG_XMM0 + sse_reg, S->vtop);
+            } else if (reg_count == 2) {
                 sse_reg -= 2;
                 gv(S, RC_FRET); /* Use pair load into xmm0 & xmm1 */
                 if (sse_reg) { /* avoid redundant movaps %xmm0, %xmm0 */
@@ -1379,7 +2091,6 @@ void gfunc_call(TCCState *S, int nb_args)
             /* simple type */
             /* XXX: implicit cast ? */
             int d;
-            gen_reg -= reg_count;
             r = gv(S, RC_INT);
             d = arg_prepare_reg(gen_reg);
             orex(S, 1,d,r,0x89); /* mov */
@@ -1389,6 +2100,9 @@ void gfunc_call(TCCState *S, int nb_args)
                 orex(S, 1,d,S->vtop->r2,0x89); /* mov */
                 o(S, 0xc0 + REG_VALUE(S->vtop->r2) * 8 + REG_VALUE(d));
             }
+            for (d = gen_reg; d < gen_reg + reg_count; d++)
+                if (d == 2 || d == 3)
+                    via |= 1 << d;
         }
         S->vtop--;
     }
@@ -1399,21 +2113,33 @@ void gfunc_call(TCCState *S, int nb_args)
        call address itself is still there, and it might be in %eax
        (or edx/ecx) currently, which the below writes would clobber.
        So evict all remaining operands here.  */
-    save_regs(S, 0);
-
-    /* Copy R10 and R11 into RDX and RCX, respectively */
-    if (nb_reg_args > 2) {
-        o(S, 0xd2894c); /* mov %r10, %rdx */
-        if (nb_reg_args > 3) {
-            o(S, 0xd9894c); /* mov %r11, %rcx */
-        }
-    }
+    save_regs(S, nb_direct);
+    gen_arg_moves(S, nb_direct, direct, via);
+    S->vtop -= nb_direct;
 
     if (S->vtop->type.ref->f.func_type != FUNC_NEW) /* implies FUNC_OLD or FUNC_ELLIPSIS */
         oad(S, 0xb8, nb_sse_args < 8 ? nb_sse_args : 8); /* mov nb_sse_args, %eax */
-    gcall_or_jmp(S, 0);
-    if (args_size)
-        gadd_sp(S, args_size);
+    if (S->tccgen_tail_call && !args_size) {
+        /* return f(...): release our frame and jump to f, which
+           returns to our caller */
+        if ((S->vtop->r & (VT_VALMASK | VT_LVAL)) != VT_CONST) {
+            load(S, TREG_R11, S->vtop);
+            S->vtop->r = TREG_R11;
+        }
+#ifdef CONFIG_TCC_REGVARS
+        /* code placed after this point (loops, cold blocks) might
+           still take more of the registers */
+        S->tccgen_regvar_saved = (1 << S->tccgen_regvar_nb) - 1;
+        gen_regvar_saves(S, 0x8b); /* restore */
+#endif
+        o(S, 0xc9); /* leave */
+        gcall_or_jmp(S, 1);
+        S->tccgen_tail_call = 2;
+    } else {
+        gcall_or_jmp(S, 0);
+        if (args_size)
+            gadd_sp(S, args_size);
+    }
     S->vtop--;
 }
 
@@ -1434,12 +2160,16 @@ void gfunc_prolog(TCCState *S, Sym *func_sym)
     Sym *sym;
     CType *type;
 
+    relax_start(S);
     sym = func_type->ref;
     addr = PTR_SIZE * 2;
     S->loc = 0;
     S->ind += FUNC_PROLOG_SIZE;
     S->x86_64_gen_func_sub_sp_offset = S->ind;
     S->x86_64_gen_func_ret_sub = 0;
+    S->x86_64_gen_nb_fp_ref = S->x86_64_gen_fp_needed = 0;
+    S->x86_64_gen_fp_omit = S->omit_frame_pointer && peep_wanted(S)
+        && !S->tccgen_func_var && !S->nocode_wanted;
     ret_mode = classify_x86_64_arg(&S->tccgen_func_vt, NULL, &size, &align, &reg_count);
 
     if (S->tccgen_func_var) {
@@ -1530,6 +2260,14 @@ void gfunc_prolog(TCCState *S, Sym *func_sym)
             if (sse_param_index + reg_count <= 8) {
                 /* save arguments passed by register */
                 S->loc -= reg_count * 8;
+                if (size > 8 && reg_count == 1) {
+                    /* vector */
+                    S->loc = (S->loc - 8) & -16;
+                    gen_block_mov(S, 1, 16, TREG_XMM0 + sse_param_index++,
+                                  VT_LOCAL, S->loc);
+                    param_addr = S->loc;
+                    break;
+                }
                 param_addr = S->loc;
                 for (i = 0; i < reg_count; ++i) {
                     o(S, 0xd60f66); /* movq */
@@ -1572,6 +2310,17 @@ void gfunc_prolog(TCCState *S, Sym *func_sym)
                  VT_LOCAL | VT_LVAL, param_addr);
     }
 
+#ifdef CONFIG_TCC_REGVARS
+    /* room to save the registers which may hold register variables,
+       filled by gfunc_epilog once we know which ones were used */
+    if (S->tccgen_regvar_nb) {
+        S->loc -= S->tccgen_regvar_nb * 8;
+        S->x86_64_gen_func_regvar_loc = S->loc;
+        S->x86_64_gen_func_regvar_ind = S->ind;
+        S->ind += S->tccgen_regvar_nb * regvar_save_size(S);
+    }
+#endif
+
 #ifdef CONFIG_TCC_BCHECK
     if (S->do_bounds_check)
         gen_bounds_prolog(S);
@@ -1581,13 +2330,26 @@ void gfunc_prolog(TCCState *S, Sym *func_sym)
 /* generate function epilog */
 void gfunc_epilog(TCCState *S)
 {
-    int v, saved_ind;
+    int v, saved_ind, frame;
 
 #ifdef CONFIG_TCC_BCHECK
     if (S->do_bounds_check)
         gen_bounds_epilog(S);
 #endif
-    o(S, 0xc9); /* leave */
+    v = S->x86_64_gen_nb_fp_ref;
+#ifdef CONFIG_TCC_REGVARS
+    gen_regvar_saves(S, 0x8b); /* restore */
+#endif
+    /* a leaf function whose locals fit in the red zone needs no frame,
+       unless inline asm refers to the locals through %rbp.  Each 'disp(%rsp)'
+       is one byte longer, so it is done only if the code does not grow
+       (counting the register saves, written below). */
+    frame = !S->x86_64_gen_fp_omit || S->x86_64_gen_fp_needed
+        || S->loc < FP_LOCALS - FP_RED_ZONE
+        || 2 * S->x86_64_gen_nb_fp_ref - v > FUNC_PROLOG_SIZE + 1 /* leave */
+        || S->x86_64_gen_relax_asm != S->tccasm_nb_inline;
+    if (frame)
+        o(S, 0xc9); /* leave */
     if (S->x86_64_gen_func_ret_sub == 0) {
         o(S, 0xc3); /* ret */
     } else {
@@ -1599,23 +2361,80 @@ void gfunc_epilog(TCCState *S)
     v = (-S->loc + 15) & -16;
     saved_ind = S->ind;
     S->ind = S->x86_64_gen_func_sub_sp_offset - FUNC_PROLOG_SIZE;
-    o(S, 0xe5894855);  /* push %rbp, mov %rsp, %rbp */
-    o(S, 0xec8148);  /* sub rsp, stacksize */
-    gen_le32(S, v);
+    if (frame) {
+        o(S, 0xe5894855);  /* push %rbp, mov %rsp, %rbp */
+        o(S, 0xec8148);  /* sub rsp, stacksize */
+        gen_le32(S, v);
+    } else {
+        relax_add(S, S->ind, RELAX_HOLE, FUNC_PROLOG_SIZE);
+        gen_fill_nops(S, FUNC_PROLOG_SIZE);
+    }
+#ifdef CONFIG_TCC_REGVARS
+    if (S->tccgen_regvar_nb) {
+        int end = S->x86_64_gen_func_regvar_ind
+            + S->tccgen_regvar_nb * regvar_save_size(S);
+        S->ind = S->x86_64_gen_func_regvar_ind;
+        gen_regvar_saves(S, 0x89); /* save */
+        if (end > S->ind)
+            relax_add(S, S->ind, RELAX_HOLE, end - S->ind);
+        if (end - S->ind > 2) {
+            /* jump over the unused part */
+            o(S, 0xeb);
+            g(S, end - S->ind - 1);
+        }
+        gen_fill_nops(S, end - S->ind);
+    }
+#endif
     S->ind = saved_ind;
+    gen_frame_refs(S, frame);
+    gen_relax(S);
 }
 
 #endif /* not PE */
 
 ST_FUNC void gen_fill_nops(TCCState *S, int bytes)
 {
-    while (bytes--)
-      g(S, 0x90);
+    /* the recommended nops of 1 to 9 bytes */
+    static const unsigned char nops[] = {
+        0x90,
+        0x66, 0x90,
+        0x0f, 0x1f, 0x00,
+        0x0f, 0x1f, 0x40, 0x00,
+        0x0f, 0x1f, 0x44, 0x00, 0x00,
+        0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00,
+        0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00,
+        0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    int n, i;
+
+    for (; bytes > 0; bytes -= n) {
+        n = bytes < 9 ? bytes : 9;
+        for (i = 0; i < n; i++)
+            g(S, nops[n * (n - 1) / 2 + i]);
+    }
+}
+
+/* pad to a multiple of 'align'.  As gen_relax() may shrink the code
+   before, reserve room for up to align - 1 nops, and such that the
+   padding is also right if the function is not relaxed at all. */
+ST_FUNC void gen_align_code(TCCState *S, int align)
+{
+    int n = -S->ind & (align - 1);
+
+    if (n != align - 1)
+        n += align;
+    /* the entry is the last one, no jump was recorded further */
+    relax_add(S, S->ind, RELAX_ALIGN, n);
+    S->x86_64_gen_relax[S->x86_64_gen_nb_relax - 1].target = align;
+    gen_fill_nops(S, n);
 }
 
 /* generate a jump to a label */
 int gjmp(TCCState *S, int t)
 {
+    t = peep_thread_jumps(S, t, -1);
+    relax_add(S, S->ind, RELAX_JMP, 5);
     return gjmp2(S, 0xe9, t);
 }
 
@@ -1623,11 +2442,14 @@ int gjmp(TCCState *S, int t)
 void gjmp_addr(TCCState *S, int a)
 {
     int r;
+    peep_thread_jumps(S, 0, a);
     r = a - S->ind - 2;
     if (r == (char)r) {
+        relax_add(S, S->ind, RELAX_JMP8, 2);
         g(S, 0xeb);
         g(S, r);
     } else {
+        relax_add(S, S->ind, RELAX_JMP, 5);
         oad(S, 0xe9, a - S->ind - 5);
     }
 }
@@ -1651,27 +2473,90 @@ ST_FUNC int gjmp_cond(TCCState *S, int op, int t)
         if (op & 0x100)
 	  {
 	    /* This was a float compare.  If the parity flag is set
-	       the result was unordered.  For anything except != this
-	       means false and we don't jump (anding both conditions).
-	       For != this means true (oring both).
-	       Take care about inverting the test.  We need to jump
-	       to our target if the result was unordered and test wasn't NE,
-	       otherwise if unordered we don't want to jump.  */
-            int v = S->vtop->cmp_r;
+	       the result was unordered: jump to our target if the
+	       test 'op' is true then, otherwise skip it.  */
             op &= ~0x100;
-            if (op ^ v ^ (v != TOK_NE))
+            if (!gen_sse_unordered(S->vtop->cmp_r, op)) {
               o(S, 0x067a);  /* jp +6 */
-	    else
+              relax_add(S, S->ind, RELAX_JCC_JP, 6);
+            } else
 	      {
+                relax_add(S, S->ind, RELAX_JCC, 6);
 	        g(S, 0x0f);
 		t = gjmp2(S, 0x8a, t); /* jp t */
+                relax_add(S, S->ind, RELAX_JCC, 6);
 	      }
-	  }
+	  } else
+            relax_add(S, S->ind, RELAX_JCC, 6);
         g(S, 0x0f);
         t = gjmp2(S, op - 16, t);
         return t;
 }
 
+/* replace vtop[-1] (the value if false) and vtop (if true), both in
+   registers, by the one selected by the flags of 'cond', with cmov */
+ST_FUNC void gen_select(TCCState *S, SValue *cond)
+{
+    int op = cond->cmp_op, ll = is64_type(S->vtop->type.t), n, u;
+    int d = S->vtop[-1].r, r = S->vtop->r;
+
+    n = 1;
+    if (op & 0x100) {
+        /* float compare: unordered operands (parity set) give true
+           only for !=, see load() */
+        op &= ~0x100;
+        u = cond->cmp_r;
+        if ((op != u) == (u == TOK_NE))
+            d = r, r = S->vtop[-1].r, op ^= 1;
+        n = 2;
+    }
+    while (n--) {
+        orex(S, ll, r, d, 0x0f);
+        o(S, (op - 0x50) | (0xc0 + REG_VALUE(r) + REG_VALUE(d) * 8) << 8); /* cmovxx r, d */
+        op = 0x9a; /* cmovp */
+    }
+    S->vtop--;
+    S->vtop->r = d;
+}
+
+/* r *= c using lea (r,r,2/4/8) for factors 3, 5 and 9 and a shift */
+static int gen_mul_lea(TCCState *S, int ll, int r, int c)
+{
+    int f[2], n = 0, k = 0, i;
+
+    if (c <= 0)
+        return 0;
+    while (!(c & 1))
+        c >>= 1, k++;
+    while (c > 1 && n < 2) {
+        if (c % 9 == 0)
+            f[n++] = 3, c /= 9;
+        else if (c % 5 == 0)
+            f[n++] = 2, c /= 5;
+        else if (c % 3 == 0)
+            f[n++] = 1, c /= 3;
+        else
+            break;
+    }
+    if (c != 1)
+        return 0;
+    for (i = 0; i < n; i++) {
+        if (ll || REX_BASE(r))
+            o(S, 0x40 | ll << 3 | REX_BASE(r) * 7);
+        o(S, 0x8d); /* lea (r,r,1<<f),r */
+        o(S, (REG_VALUE(r) == 5 ? 0x44 : 0x04) | REG_VALUE(r) << 3 |
+          (f[i] << 6 | REG_VALUE(r) * 9) << 8);
+        if (REG_VALUE(r) == 5) /* base %rbp/%r13 needs a displacement */
+            g(S, 0);
+    }
+    if (k) {
+        orex(S, ll, r, 0, 0xc1); /* shl $k, r */
+        o(S, 0xe0 | REG_VALUE(r));
+        g(S, k);
+    }
+    return 1;
+}
+
 /* generate an integer binary operation */
 void gen_opi(TCCState *S, int op)
 {
@@ -1733,11 +2618,27 @@ void gen_opi(TCCState *S, int op)
         opc = 1;
         goto gen_op8;
     case '*':
-        gv2(S, RC_INT, RC_INT);
-        r = S->vtop[-1].r;
-        fr = S->vtop[0].r;
-        orex(S, ll, fr, r, 0xaf0f); /* imul fr, r */
-        o(S, 0xc0 + REG_VALUE(fr) + REG_VALUE(r) * 8);
+        if (cc && (!ll || (int)S->vtop->c.i == S->vtop->c.i)) {
+            /* constant case */
+            vswap(S);
+            r = gv(S, RC_INT);
+            vswap(S);
+            c = S->vtop->c.i;
+            if (!gen_mul_lea(S, ll, r, c)) {
+                orex(S, ll, r, r, c == (char)c ? 0x6b : 0x69);
+                o(S, 0xc0 | REG_VALUE(r) * 9); /* imul $c, r, r */
+                if (c == (char)c)
+                    g(S, c);
+                else
+                    gen_le32(S, c);
+            }
+        } else {
+            gv2(S, RC_INT, RC_INT);
+            r = S->vtop[-1].r;
+            fr = S->vtop[0].r;
+            orex(S, ll, fr, r, 0xaf0f); /* imul fr, r */
+            o(S, 0xc0 + REG_VALUE(fr) + REG_VALUE(r) * 8);
+        }
         S->vtop--;
         break;
     case TOK_SHL:
@@ -1767,6 +2668,21 @@ void gen_opi(TCCState *S, int op)
         }
         S->vtop--;
         break;
+    case TOK_UMULL:
+    case TOK_UMULH:
+    case TOK_SMULH:
+        /* high part of the product ends up in rdx */
+        gv2(S, RC_RAX, RC_RCX);
+        fr = S->vtop[0].r;
+        S->vtop--;
+        save_reg(S, TREG_RDX);
+        orex(S, ll, fr, 0, 0xf7); /* mul/imul fr */
+        o(S, (op == TOK_SMULH ? 0xe8 : 0xe0) + REG_VALUE(fr));
+        if (op == TOK_UMULL)
+            S->vtop->r2 = TREG_RDX; /* full 128 bit product in rdx:rax */
+        else
+            S->vtop->r = TREG_RDX;
+        break;
     case TOK_UDIV:
     case TOK_UMOD:
         uu = 1;
@@ -1810,12 +2726,203 @@ void vpush_const(TCCState *S, int t, int v)
     S->vtop->r |= VT_LVAL;
 }
 
+/* ------------------------------------------------------------------------- */
+/* small struct copies and clears without calling memmove/memset */
+
+/* load (store: save) 'size' bytes at [b + c] to r, b being a register
+   or VT_LOCAL for the frame */
+static void gen_block_mov(TCCState *S, int store, int size, int r, int b, int c)
+{
+    int local = b == VT_LOCAL;
+    int rex = REX_BASE(r) << 2 | (local ? 0 : REX_BASE(b));
+
+    b = REG_VALUE(b);
+    if (size == 2)
+        g(S, 0x66);
+    if (size == 8)
+        rex |= 8;
+    if (rex || (size == 1 && r >= TREG_RSP))
+        g(S, 0x40 | rex);
+    if (size == 16)
+        o(S, 0x100f + store * 0x100); /* movups */
+    else
+        g(S, (size == 1 ? 0x8a : 0x8b) - store * 2); /* mov */
+    r = REG_VALUE(r) << 3;
+    if (local) {
+        gen_modrm_local(S, r, c);
+    } else if (c == 0) {
+        g(S, r | b);
+        if (b == TREG_RSP)
+            g(S, 0x24);
+    } else {
+        g(S, (c == (char)c ? 0x40 : 0x80) | r | b);
+        if (b == TREG_RSP)
+            g(S, 0x24);
+        if (c == (char)c)
+            g(S, c);
+        else
+            gen_le32(S, c);
+    }
+}
+
+/* copy (clear if n == 1) 'size' bytes to the address at vtop[1 - n]
+   from the one at vtop, in 16 byte chunks through a xmm register and
+   the rest through an integer register */
+static void gen_block(TCCState *S, int size, int n)
+{
+    int b[2], c[2], i, x, r, sz, off;
+
+    save_regs_keep(S, n);
+    for (i = 0; i < n; i++)
+        b[i] = (S->vtop[i - n + 1].r & (VT_VALMASK | VT_LVAL | VT_SYM))
+               == VT_LOCAL;
+    if (n == 2 && !b[0] && !b[1])
+        gv2(S, RC_INT, RC_INT);
+    else for (i = 0; i < n; i++) {
+        if (!b[i]) {
+            if (i == 0 && n == 2)
+                vswap(S);
+            gv(S, RC_INT);
+            if (i == 0 && n == 2)
+                vswap(S);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        SValue *sv = &S->vtop[i - n + 1];
+        c[i] = b[i] ? sv->c.i : 0;
+        b[i] = b[i] ? VT_LOCAL : sv->r;
+    }
+    x = size >= 16 ? get_reg(S, RC_FLOAT) : 0;
+    r = size & 15 ? get_reg(S, RC_INT) : 0;
+    if (n == 1) {
+        if (size >= 16)
+            o(S, 0xef0f66), o(S, 0xc0 | REG_VALUE(x) * 9); /* pxor x, x */
+        if (size & 15)
+            orex(S, 0, r, r, 0x31), o(S, 0xc0 | REG_VALUE(r) * 9); /* xor r, r */
+    }
+    for (off = 0, sz = 16; off < size; off += sz) {
+        while (size - off < sz)
+            sz >>= 1;
+        if (n == 2)
+            gen_block_mov(S, 0, sz, sz == 16 ? x : r, b[1], c[1] + off);
+        gen_block_mov(S, 1, sz, sz == 16 ? x : r, b[0], c[0] + off);
+    }
+    S->vtop -= n;
+}
+
+/* copy 'size' bytes from the address at vtop to the one at vtop[-1] */
+ST_FUNC void gen_struct_copy(TCCState *S, int size)
+{
+    gen_block(S, size, 2);
+}
+
+/* clear 'size' bytes at the address at vtop */
+ST_FUNC void gen_struct_clear(TCCState *S, int size)
+{
+    gen_block(S, size, 1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* GCC vector operations, with SSE2 for 16 byte vectors */
+
+/* load (store: save) the vector lvalue 'sv' to (from) xmm register 'x' */
+static void gen_vec_mov(TCCState *S, int store, int x, SValue *sv)
+{
+    int r;
+
+    if ((sv->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == (VT_LOCAL | VT_LVAL)) {
+        gen_block_mov(S, store, 16, x, VT_LOCAL, sv->c.i);
+    } else {
+        vpushv(S, sv);
+        S->vtop->type.t = VT_PTR;
+        gaddrof(S);
+        r = gv(S, RC_INT);
+        gen_block_mov(S, store, 16, x, r, 0);
+        vpop(S);
+    }
+}
+
+/* 16 byte vectors are returned in %xmm0 */
+ST_FUNC void arch_transfer_ret_regs(TCCState *S, int aftercall)
+{
+    gen_vec_mov(S, aftercall, TREG_XMM0, S->vtop);
+}
+
+/* a = a op b for the vectors 'a' and 'b', result to 'd(%rbp)'.
+   Return 0 if SSE2 has no instruction for it. */
+ST_FUNC int gen_opv(TCCState *S, int op, SValue *a, SValue *b, int d)
+{
+    static const unsigned char padd[4] = { 0xfc, 0xfd, 0xfe, 0xd4 };
+    static const unsigned char psub[4] = { 0xf8, 0xf9, 0xfa, 0xfb };
+    int t = VECTOR_ELEM(&a->type)->t, bt = t & VT_BTYPE;
+    int l = bt == VT_BYTE ? 0 : bt == VT_SHORT ? 1 : bt == VT_LLONG ? 3 : 2;
+    int opc, pred = -1, swap = 0, inv = 0;
+    SValue *tmp;
+
+    if (a->type.ref->c != 16 || S->nosse)
+        return 0;
+    if (is_float(bt)) {
+        switch (op) {
+        case '+': opc = 0x58; break;
+        case '-': opc = 0x5c; break;
+        case '*': opc = 0x59; break;
+        case '/': opc = 0x5e; break;
+        case TOK_EQ: pred = 0; break;
+        case TOK_NE: pred = 4; break;
+        case TOK_GT: swap = 1; /* fall through */
+        case TOK_LT: pred = 1; break;
+        case TOK_GE: swap = 1; /* fall through */
+        case TOK_LE: pred = 2; break;
+        default: return 0;
+        }
+        if (pred >= 0)
+            opc = 0xc2; /* cmpps */
+        opc = opc << 8 | 0x0f;
+        if (bt == VT_DOUBLE)
+            opc = opc << 8 | 0x66;
+    } else {
+        switch (op) {
+        case '+': opc = padd[l]; break;
+        case '-': opc = psub[l]; break;
+        case '*': opc = 0xd5; if (l != 1) return 0; break; /* pmullw */
+        case '&': opc = 0xdb; break;
+        case '|': opc = 0xeb; break;
+        case '^': opc = 0xef; break;
+        case TOK_NE: inv = 1; /* fall through */
+        case TOK_EQ: opc = 0x74 + l; break; /* pcmpeq */
+        case TOK_LE: inv = 1; /* fall through */
+        case TOK_GT: opc = 0x64 + l; break; /* pcmpgt */
+        case TOK_GE: inv = 1; /* fall through */
+        case TOK_LT: opc = 0x64 + l; swap = 1; break;
+        default: return 0;
+        }
+        if ((opc < 0x78 && l == 3) || (opc < 0x68 && (t & VT_UNSIGNED)))
+            return 0;
+        opc = opc << 16 | 0x0f66;
+    }
+    save_regs(S, 0);
+    if (swap)
+        tmp = a, a = b, b = tmp;
+    gen_vec_mov(S, 0, TREG_XMM0, a);
+    gen_vec_mov(S, 0, TREG_XMM1, b);
+    o(S, opc);
+    o(S, 0xc1); /* op %xmm1, %xmm0 */
+    if (pred >= 0)
+        g(S, pred);
+    if (inv) {
+        o(S, 0xc9760f66); /* pcmpeqd %xmm1, %xmm1 */
+        o(S, 0xc1ef0f66); /* pxor %xmm1, %xmm0 */
+    }
+    gen_block_mov(S, 1, 16, TREG_XMM0, VT_LOCAL, d);
+    return 1;
+}
+
 /* generate a floating point operation 'v = t1 op t2' instruction. The
    two operands are guaranteed to have the same floating point type */
 /* XXX: need to use ST1 too */
 void gen_opf(TCCState *S, int op)
 {
-    int a, ft, fc, swapped, r;
+    int a, fc, swapped, r;
     int bt = S->vtop->type.t & VT_BTYPE;
     int float_type = bt == VT_LDOUBLE ? RC_ST0 : RC_FLOAT;
 
@@ -1915,119 +3022,37 @@ void gen_opf(TCCState *S, int op)
                     a++;
                 break;
             }
-            ft = S->vtop->type.t;
             fc = S->vtop->c.i;
             o(S, 0xde); /* fxxxp %st, %st(1) */
             o(S, 0xc1 + (a << 3));
             S->vtop--;
         }
     } else {
-        if (op >= TOK_ULT && op <= TOK_GT) {
-            /* if saved lvalue, then we must reload it */
-            r = S->vtop->r;
-            fc = S->vtop->c.i;
-            if ((r & VT_VALMASK) == VT_LLOCAL) {
-                SValue v1;
-                r = get_reg(S, RC_INT);
-                v1.type.t = VT_PTR;
-                v1.r = VT_LOCAL | VT_LVAL;
-                v1.c.i = fc;
-                load(S, r, &v1);
-                fc = 0;
-                S->vtop->r = r = r | VT_LVAL;
-            }
-
-            if (op == TOK_EQ || op == TOK_NE) {
-                swapped = 0;
-            } else {
-                if (op == TOK_LE || op == TOK_LT)
-                    swapped = !swapped;
-                if (op == TOK_LE || op == TOK_GE) {
-                    op = 0x93; /* setae */
-                } else {
-                    op = 0x97; /* seta */
-                }
-            }
-
-            if (swapped) {
-                gv(S, RC_FLOAT);
-                vswap(S);
-            }
-            assert(!(S->vtop[-1].r & VT_LVAL));
-            
-            if ((S->vtop->type.t & VT_BTYPE) == VT_DOUBLE)
-                o(S, 0x66);
-            if (op == TOK_EQ || op == TOK_NE)
-                o(S, 0x2e0f); /* ucomisd */
-            else
-                o(S, 0x2f0f); /* comisd */
-
-            if (S->vtop->r & VT_LVAL) {
-                gen_modrm(S, S->vtop[-1].r, r, S->vtop->sym, fc);
-            } else {
-                o(S, 0xc0 + REG_VALUE(S->vtop[0].r) + REG_VALUE(S->vtop[-1].r)*8);
-            }
-
-            S->vtop--;
-            vset_VT_CMP(S, op | 0x100);
-            S->vtop->cmp_r = op;
-        } else {
-            assert((S->vtop->type.t & VT_BTYPE) != VT_LDOUBLE);
-            switch(op) {
-            default:
-            case '+':
-                a = 0;
-                break;
-            case '-':
-                a = 4;
-                break;
-            case '*':
-                a = 1;
-                break;
-            case '/':
-                a = 6;
-                break;
-            }
-            ft = S->vtop->type.t;
-            fc = S->vtop->c.i;
-            assert((ft & VT_BTYPE) != VT_LDOUBLE);
-            
-            r = S->vtop->r;
-            /* if saved lvalue, then we must reload it */
-            if ((S->vtop->r & VT_VALMASK) == VT_LLOCAL) {
-                SValue v1;
-                r = get_reg(S, RC_INT);
-                v1.type.t = VT_PTR;
-                v1.r = VT_LOCAL | VT_LVAL;
-                v1.c.i = fc;
-                load(S, r, &v1);
-                fc = 0;
-                S->vtop->r = r = r | VT_LVAL;
-            }
-            
-            assert(!(S->vtop[-1].r & VT_LVAL));
-            if (swapped) {
-                assert(S->vtop->r & VT_LVAL);
-                gv(S, RC_FLOAT);
-                vswap(S);
-            }
-            
-            if ((ft & VT_BTYPE) == VT_DOUBLE) {
-                o(S, 0xf2);
-            } else {
-                o(S, 0xf3);
-            }
-            o(S, 0x0f);
-            o(S, 0x58 + a);
-            
-            if (S->vtop->r & VT_LVAL) {
-                gen_modrm(S, S->vtop[-1].r, r, S->vtop->sym, fc);
-            } else {
-                o(S, 0xc0 + REG_VALUE(S->vtop[0].r) + REG_VALUE(S->vtop[-1].r)*8);
-            }
-
-            S->vtop--;
+        /* if saved lvalue, then we must reload it */
+        r = S->vtop->r;
+        fc = S->vtop->c.i;
+        if ((r & VT_VALMASK) == VT_LLOCAL) {
+            SValue v1;
+            r = get_reg(S, RC_INT);
+            v1.type.t = VT_PTR;
+            v1.r = VT_LOCAL | VT_LVAL;
+            v1.c.i = fc;
+            load(S, r, &v1);
+            fc = 0;
+            S->vtop->r = r | VT_LVAL;
         }
+        if (op == TOK_EQ || op == TOK_NE) {
+            swapped = 0;
+        } else if (op == TOK_LE || op == TOK_LT) {
+            swapped = !swapped;
+            op ^= TOK_LT ^ TOK_GT; /* a < b is b > a */
+        }
+        if (swapped) {
+            gv(S, RC_FLOAT);
+            vswap(S);
+        }
+        assert(!(S->vtop[-1].r & VT_LVAL));
+        gen_sse_opf(S, op, S->vtop->r, fc);
     }
 }
 
@@ -2190,6 +3215,149 @@ ST_FUNC void gen_cvt_csti(TCCState *S, int t)
         );
 }
 
+/* __builtin_popcount, ctz, clz, ffs or bswap of vtop in place, see
+   builtin_bitop() */
+ST_FUNC int gen_bitop(TCCState *S, int op)
+{
+    int bt = S->vtop->type.t & VT_BTYPE, ll = bt == VT_LLONG, r, r2;
+
+    if (op == TOK_builtin_popcount && !S->popcnt)
+        return 0;
+    r = gv(S, RC_INT);
+    switch (op) {
+    case TOK_builtin_popcount:
+        o(S, 0xf3);
+        orex(S, ll, r, r, 0xb80f); /* popcnt %r, %r */
+        o(S, 0xc0 | REG_VALUE(r) << 3 | REG_VALUE(r));
+        break;
+    case TOK_builtin_ctz:
+        orex(S, ll, r, r, 0xbc0f); /* bsf %r, %r */
+        o(S, 0xc0 | REG_VALUE(r) << 3 | REG_VALUE(r));
+        break;
+    case TOK_builtin_clz:
+        if (S->lzcnt)
+            o(S, 0xf3); /* lzcnt %r, %r */
+        orex(S, ll, r, r, 0xbd0f); /* bsr %r, %r */
+        o(S, 0xc0 | REG_VALUE(r) << 3 | REG_VALUE(r));
+        if (!S->lzcnt) {
+            orex(S, 0, r, 0, 0x83); /* xor $31/63, %r */
+            o(S, 0xf0 | REG_VALUE(r));
+            g(S, ll ? 63 : 31);
+        }
+        break;
+    case TOK_builtin_ffs:
+        r2 = get_reg(S, RC_INT);
+        orex(S, 0, r2, 0, 0xb8 + REG_VALUE(r2)); /* mov $-1, %r2 */
+        gen_le32(S, -1);
+        orex(S, ll, r, r, 0xbc0f); /* bsf %r, %r */
+        o(S, 0xc0 | REG_VALUE(r) << 3 | REG_VALUE(r));
+        orex(S, 0, r2, r, 0x440f); /* cmovz %r2, %r */
+        o(S, 0xc0 | REG_VALUE(r) << 3 | REG_VALUE(r2));
+        orex(S, 0, r, 0, 0xff); /* inc %r */
+        o(S, 0xc0 | REG_VALUE(r));
+        break;
+    default:
+        orex(S, ll, r, 0, 0xc80f + (REG_VALUE(r) << 8)); /* bswap %r */
+        if (bt == VT_SHORT) {
+            orex(S, 0, r, 0, 0xc1); /* shr $16, %r */
+            o(S, 0xe8 | REG_VALUE(r));
+            g(S, 16);
+        }
+        break;
+    }
+    return 1;
+}
+
+/* 'b' (xchg, xadd or cmpxchg) of %r with the 'size' bytes at (%rp) */
+static void gen_atomic_rm(TCCState *S, int size, int lock, int b, int r, int rp)
+{
+    if (lock)
+        o(S, 0xf0);
+    if (size == 2)
+        o(S, 0x66);
+    orex(S, size == 8, rp, r, b);
+    o(S, REG_VALUE(r) << 3 | REG_VALUE(rp));
+}
+
+/* inline __atomic_xxx, see parse_atomic().  Plain loads and stores
+   are enough for all orders but a seq_cst store */
+ST_FUNC void gen_atomic(TCCState *S, int op, int size, int mo)
+{
+    int w = size > 1, r, rp, loop;
+
+    switch (op) {
+    case TOK___atomic_load:
+        indir(S);
+        gv(S, RC_INT);
+        return;
+    case TOK___atomic_store:
+        if (mo != 5) {
+            vswap(S);
+            indir(S);
+            vswap(S);
+            vstore(S);
+            vpop(S);
+            return;
+        }
+        /* fall through */
+    case TOK___atomic_exchange:
+        gv2(S, RC_INT, RC_INT);
+        rp = S->vtop[-1].r, r = S->vtop->r;
+        gen_atomic_rm(S, size, 0, 0x86 | w, r, rp); /* xchg %r, (%rp) */
+        break;
+    case TOK___atomic_fetch_add:
+    case TOK___atomic_fetch_sub:
+        gv2(S, RC_INT, RC_INT);
+        rp = S->vtop[-1].r, r = S->vtop->r;
+        if (op == TOK___atomic_fetch_sub) {
+            orex(S, size == 8, r, 0, 0xf7); /* neg %r */
+            o(S, 0xd8 | REG_VALUE(r));
+        }
+        gen_atomic_rm(S, size, 1, 0xc00f | w << 8, r, rp); /* lock xadd */
+        break;
+    case TOK___atomic_compare_exchange:
+        /* [p e d] -> [old ok].  Load all (bound checks may call
+           functions), then move them to their registers */
+        for (r = 0; r < 6; r++) {
+            vrotb(S, 3);
+            gv(S, r < 3 ? RC_INT : r == 3 ? RC_RCX : r == 4 ? RC_RAX : RC_RDX);
+        }
+        /* lock cmpxchg %rdx, (%rcx) */
+        gen_atomic_rm(S, size, 1, 0xb00f | w << 8, TREG_RDX, TREG_RCX);
+        S->vtop -= 1;
+        S->vtop[-1].r = TREG_RAX;
+        S->vtop->type.t = VT_INT;
+        vset_VT_CMP(S, TOK_EQ);
+        return;
+    default:
+        /* fetch_or/xor/and: cmpxchg loop with the old value in %rax */
+        gv2(S, RC_RCX, RC_RDX);
+        get_reg(S, RC_RAX);
+        get_reg(S, RC_R11);
+        /* movzbl/movzwl/mov (%rcx), %eax */
+        orex(S, size == 8, TREG_RCX, TREG_RAX,
+             size > 2 ? 0x8b : 0xb60f | (size == 2) << 8);
+        o(S, 0x01);
+        loop = S->ind;
+        orex(S, 1, TREG_R11, TREG_RAX, 0x89); /* mov %rax, %r11 */
+        o(S, 0xc3);
+        orex(S, 1, TREG_R11, TREG_RDX, /* or/xor/and %rdx, %r11 */
+             op == TOK___atomic_fetch_or ? 0x09 :
+             op == TOK___atomic_fetch_xor ? 0x31 : 0x21);
+        o(S, 0xd3);
+        /* lock cmpxchg %r11, (%rcx) */
+        gen_atomic_rm(S, size, 1, 0xb00f | w << 8, TREG_R11, TREG_RCX);
+        o(S, 0x75); /* jne loop */
+        g(S, loop - S->ind - 1);
+        r = TREG_RAX;
+        break;
+    }
+    S->vtop[-1].r = r;
+    --S->vtop;
+    if (op == TOK___atomic_store)
+        vpop(S);
+}
+
 /* increment tcov counter */
 ST_FUNC void gen_increment_tcov (TCCState *S, SValue *sv)
 {
@@ -2206,8 +3374,32 @@ void ggoto(TCCState *S)
     S->vtop--;
 }
 
+/* jump through the switch table 'table' of 32-bit offsets relative to
+   its start, indexed by vtop */
+ST_FUNC void gen_jmptable(TCCState *S, Sym *table)
+{
+    int r = gv(S, RC_INT);
+    /* its entries are fixed up by gen_relax() */
+    S->x86_64_gen_relax_tab = tcc_realloc(S, S->x86_64_gen_relax_tab,
+        (S->x86_64_gen_nb_relax_tab + 1) * sizeof (int));
+    S->x86_64_gen_relax_tab[S->x86_64_gen_nb_relax_tab++] = table->c;
+    o(S, 0x1d8d4c); /* lea table(%rip),%r11 */
+    gen_addrpc32(S, VT_SYM, table, 0);
+    /* movslq (%r11,%r,4),%r */
+    o(S, 0x49 | REX_BASE(r) << 2 | REX_BASE(r) << 1);
+    o(S, 0x63);
+    o(S, 0x04 | REG_VALUE(r) << 3);
+    o(S, 0x83 | REG_VALUE(r) << 3);
+    orex(S, 1, r, TREG_R11, 0x01); /* add %r11,%r */
+    o(S, 0xc0 | REG_VALUE(TREG_R11) << 3 | REG_VALUE(r));
+    orex(S, 0, r, 0, 0xff); /* jmp *%r */
+    o(S, 0xe0 | REG_VALUE(r));
+    S->vtop--;
+}
+
 /* Save the stack pointer onto the stack and return the location of its address */
 ST_FUNC void gen_vla_sp_save(TCCState *S, int addr) {
+    S->x86_64_gen_fp_needed = 1;
     /* mov %rsp,addr(%rbp)*/
     gen_modrm64(S, 0x89, TREG_RSP, VT_LOCAL, NULL, addr);
 }
@@ -2229,6 +3421,7 @@ ST_FUNC void gen_vla_result(TCCState *S, int addr) {
 ST_FUNC void gen_vla_alloc(TCCState *S, CType *type, int align) {
     int use_call = 0;
 
+    S->x86_64_gen_fp_needed = 1;
 #if defined(CONFIG_TCC_BCHECK)
     use_call = S->do_bounds_check;
 #endif
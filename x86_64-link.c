@@ -5,10 +5,12 @@
 /* relocation type for 32 bit data relocation */
 #define R_DATA_32   R_X86_64_32S
 #define R_DATA_PTR  R_X86_64_64
+#define R_DATA_PC32 R_X86_64_PC32
 #define R_JMP_SLOT  R_X86_64_JUMP_SLOT
 #define R_GLOB_DAT  R_X86_64_GLOB_DAT
 #define R_COPY      R_X86_64_COPY
 #define R_RELATIVE  R_X86_64_RELATIVE
+#define R_TPOFF     R_X86_64_TPOFF64
 
 #define R_NUM       R_X86_64_NUM
 
@@ -69,6 +71,10 @@ int gotplt_entry_type (int reloc_type)
         case R_X86_64_JUMP_SLOT:
         case R_X86_64_COPY:
         case R_X86_64_RELATIVE:
+        case R_X86_64_TLSGD:
+        case R_X86_64_TLSLD:
+        case R_X86_64_DTPOFF32:
+        case R_X86_64_TPOFF32:
             return NO_GOTPLT_ENTRY;
 
 	/* The following relocs wouldn't normally need GOT or PLT
@@ -82,7 +88,7 @@ int gotplt_entry_type (int reloc_type)
             return AUTO_GOTPLT_ENTRY;
 
         case R_X86_64_GOTTPOFF:
-            return BUILD_GOT_ONLY;
+            return TLS_GOT_ENTRY;
 
         case R_X86_64_GOT32:
         case R_X86_64_GOT64:
@@ -91,10 +97,6 @@ int gotplt_entry_type (int reloc_type)
         case R_X86_64_GOTOFF64:
         case R_X86_64_GOTPCREL:
         case R_X86_64_GOTPCRELX:
-        case R_X86_64_TLSGD:
-        case R_X86_64_TLSLD:
-        case R_X86_64_DTPOFF32:
-        case R_X86_64_TPOFF32:
         case R_X86_64_REX_GOTPCRELX:
         case R_X86_64_PLT32:
         case R_X86_64_PLTOFF64:
@@ -182,6 +184,16 @@ ST_FUNC void relocate_plt(TCCState *S)
 #endif
 #endif
 
+/* offset of a thread-local variable from the thread pointer %fs:0,
+   which points right after the TLS block of the executable */
+static int32_t tpoff(TCCState *S, addr_t val)
+{
+    if (S->output_type != TCC_OUTPUT_EXE)
+        tcc_error(S, "local-exec TLS relocation in a shared object");
+    return val - S->tls_addr
+        - ((S->tls_size + S->tls_align - 1) & -(addr_t)S->tls_align);
+}
+
 void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t addr, addr_t val)
 {
     int sym_index, esym_index;
@@ -286,7 +298,20 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t a
             add64le(ptr, S->got->sh_addr - addr + rel->r_addend);
             break;
         case R_X86_64_GOTTPOFF:
-            add32le(ptr, val - S->got->sh_addr);
+            if (get_sym_attr(S, sym_index, 0)->got_offset) {
+                add32le(ptr, S->got->sh_addr - addr +
+                             get_sym_attr(S, sym_index, 0)->got_offset - 4);
+            } else if ((ptr[-3] & 0xfb) == 0x48
+                       && (ptr[-2] == 0x8b || ptr[-2] == 0x03)
+                       && (ptr[-1] & 0xc7) == 0x05) {
+                /* variable of the executable, relax to local-exec:
+                   mov/add x@gottpoff(%rip),reg -> mov/add $x@tpoff,reg */
+                ptr[-3] = 0x48 | (ptr[-3] >> 2 & 1);
+                ptr[-2] = ptr[-2] == 0x8b ? 0xc7 : 0x81;
+                ptr[-1] = 0xc0 | (ptr[-1] >> 3 & 7);
+                write32le(ptr, tpoff(S, val - rel->r_addend));
+            } else
+                tcc_error(S, "unexpected R_X86_64_GOTTPOFF pattern");
             break;
         case R_X86_64_GOT32:
             /* we load the got offset */
@@ -314,15 +339,11 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t a
 
                 if (memcmp (ptr-4, expect, sizeof(expect)) == 0) {
                     ElfW(Sym) *sym;
-                    Section *sec;
-                    int32_t x;
 
                     memcpy(ptr-4, replace, sizeof(replace));
                     rel[1].r_info = ELFW(R_INFO)(0, R_X86_64_NONE);
                     sym = &((ElfW(Sym) *)symtab_section->data)[sym_index];
-                    sec = S->sections[sym->st_shndx];
-                    x = sym->st_value - sec->sh_addr - sec->data_offset;
-                    add32le(ptr + 8, x);
+                    add32le(ptr + 8, tpoff(S, sym->st_value));
                 }
                 else
                     tcc_error(S, "unexpected R_X86_64_TLSGD pattern");
@@ -348,18 +369,9 @@ void relocate(TCCState *S, ElfW_Rel *rel, int type, unsigned char *ptr, addr_t a
                     tcc_error(S, "unexpected R_X86_64_TLSLD pattern");
             }
             break;
-        case R_X86_64_DTPOFF32:
+        case R_X86_64_DTPOFF32: /* local-dynamic is relaxed, see above */
         case R_X86_64_TPOFF32:
-            {
-                ElfW(Sym) *sym;
-                Section *sec;
-                int32_t x;
-
-                sym = &((ElfW(Sym) *)symtab_section->data)[sym_index];
-                sec = S->sections[sym->st_shndx];
-                x = val - sec->sh_addr - sec->data_offset;
-                add32le(ptr, x);
-            }
+            add32le(ptr, tpoff(S, val));
             break;
         case R_X86_64_NONE:
             break;